@@ -0,0 +1,215 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include "AisIndex.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define AIS_INDEX_MIN_HASH (1024)
+
+void AisIndex::Clear() {
+  m_entries.clear();
+  m_free.clear();
+  m_hash.assign(AIS_INDEX_MIN_HASH, -1);
+  for (int i = 0; i < AIS_INDEX_CELLS; i++) {
+    m_cell[i] = -1;
+  }
+  for (int i = 0; i < AIS_INDEX_SECONDS; i++) {
+    m_second[i] = -1;
+  }
+  m_expired = 0;
+  m_size = 0;
+}
+
+int AisIndex::LatLonCell(int lat_cell, int lon_cell) {
+  unsigned int h = (unsigned int)lat_cell * 73856093u ^ (unsigned int)lon_cell * 19349663u;
+  return (int)(h % AIS_INDEX_CELLS);
+}
+
+static int SecondOf(time_t t) { return (int)(((t % AIS_INDEX_SECONDS) + AIS_INDEX_SECONDS) % AIS_INDEX_SECONDS); }
+
+void AisIndex::Insert(int *head, Link Entry::*link, int e) {
+  (m_entries[e].*link).prev = -1;
+  (m_entries[e].*link).next = *head;
+  if (*head >= 0) {
+    (m_entries[*head].*link).prev = e;
+  }
+  *head = e;
+}
+
+void AisIndex::Unlink(int *head, Link Entry::*link, int e) {
+  Link *l = &(m_entries[e].*link);
+
+  if (l->prev >= 0) {
+    (m_entries[l->prev].*link).next = l->next;
+  } else {
+    *head = l->next;
+  }
+  if (l->next >= 0) {
+    (m_entries[l->next].*link).prev = l->prev;
+  }
+}
+
+void AisIndex::Grow() {
+  m_hash.assign(m_hash.size() * 2, -1);
+  for (size_t e = 0; e < m_entries.size(); e++) {
+    if (m_entries[e].mmsi) {
+      int h = HashOf(m_entries[e].mmsi);
+      m_entries[e].hash_next = m_hash[h];
+      m_hash[h] = (int)e;
+    }
+  }
+}
+
+void AisIndex::Update(long mmsi, double lat, double lon, time_t now) {
+  int h = HashOf(mmsi);
+  int e = m_hash[h];
+  int cell = LatLonCell(CellOf(lat), CellOf(lon));
+
+  while (e >= 0 && m_entries[e].mmsi != mmsi) {
+    e = m_entries[e].hash_next;
+  }
+
+  if (e >= 0) {
+    Entry *entry = &m_entries[e];
+    if (entry->cell != cell) {
+      Unlink(&m_cell[entry->cell], &Entry::cell_link, e);
+      Insert(&m_cell[cell], &Entry::cell_link, e);
+      entry->cell = cell;
+    }
+    if (entry->time != now) {
+      Unlink(&m_second[SecondOf(entry->time)], &Entry::time_link, e);
+      Insert(&m_second[SecondOf(now)], &Entry::time_link, e);
+      entry->time = now;
+    }
+    entry->lat = lat;
+    entry->lon = lon;
+    return;
+  }
+
+  if (m_size >= m_hash.size()) {
+    Grow();
+    h = HashOf(mmsi);
+  }
+  if (m_free.empty()) {
+    e = (int)m_entries.size();
+    m_entries.push_back(Entry());
+  } else {
+    e = m_free.back();
+    m_free.pop_back();
+  }
+  Entry *entry = &m_entries[e];
+  entry->mmsi = mmsi;
+  entry->time = now;
+  entry->lat = lat;
+  entry->lon = lon;
+  entry->cell = cell;
+  entry->hash_next = m_hash[h];
+  m_hash[h] = e;
+  Insert(&m_cell[cell], &Entry::cell_link, e);
+  Insert(&m_second[SecondOf(now)], &Entry::time_link, e);
+  m_size++;
+}
+
+void AisIndex::Remove(int e) {
+  Entry *entry = &m_entries[e];
+  int *p = &m_hash[HashOf(entry->mmsi)];
+
+  while (*p != e) {
+    p = &m_entries[*p].hash_next;
+  }
+  *p = entry->hash_next;
+  Unlink(&m_cell[entry->cell], &Entry::cell_link, e);
+  Unlink(&m_second[SecondOf(entry->time)], &Entry::time_link, e);
+  entry->mmsi = 0;
+  m_free.push_back(e);
+  m_size--;
+}
+
+void AisIndex::Expire(time_t now, int max_age) {
+  time_t cutoff = now - max_age;  // entries updated before this are too old
+  time_t t = m_expired;
+
+  if (cutoff - t > AIS_INDEX_SECONDS) {
+    t = cutoff - AIS_INDEX_SECONDS;  // every bucket is looked at once
+  }
+  for (; t < cutoff; t++) {
+    // A bucket can also hold entries that are AIS_INDEX_SECONDS newer, or from before the clock was set back
+    int e = m_second[SecondOf(t)];
+    while (e >= 0) {
+      int next = m_entries[e].time_link.next;
+      if (m_entries[e].time < cutoff) {
+        Remove(e);
+      }
+      e = next;
+    }
+  }
+  if (cutoff > m_expired) {
+    m_expired = cutoff;
+  }
+}
+
+bool AisIndex::FindNear(double lat, double lon, double dlat, double dlon) const {
+  if (m_size == 0) {
+    return false;
+  }
+
+  int lat1 = CellOf(lat - dlat);
+  int lat2 = CellOf(lat + dlat);
+  int lon1 = CellOf(lon - dlon);
+  int lon2 = CellOf(lon + dlon);
+
+  if ((double)(lat2 - lat1 + 1) * (lon2 - lon1 + 1) > AIS_INDEX_CELLS / 8) {
+    // A very large area, look at all targets
+    for (size_t e = 0; e < m_entries.size(); e++) {
+      const Entry *entry = &m_entries[e];
+      if (entry->mmsi && lat + dlat > entry->lat && lat - dlat < entry->lat && lon + dlon > entry->lon && lon - dlon < entry->lon) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  for (int y = lat1; y <= lat2; y++) {
+    for (int x = lon1; x <= lon2; x++) {
+      for (int e = m_cell[LatLonCell(y, x)]; e >= 0; e = m_entries[e].cell_link.next) {
+        const Entry *entry = &m_entries[e];
+        if (lat + dlat > entry->lat && lat - dlat < entry->lat && lon + dlon > entry->lon && lon - dlon < entry->lon) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,113 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _AISINDEX_H_
+#define _AISINDEX_H_
+
+#include <time.h>
+#include <vector>
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/*
+ * The AIS targets near own ship, so ARPA can tell whether a target it tracks is also
+ * seen by AIS without looking at every AIS target.
+ *
+ * Each target is in three lists at once: a hash chain by MMSI, so an update finds its
+ * target directly; a grid cell of AIS_INDEX_CELL degrees, so a query only looks at the
+ * cells around a position; and a bucket per second of its last update, so expiring the
+ * old targets only looks at the buckets that have become too old. All of these cost
+ * O(1) per AIS message.
+ */
+
+#define AIS_INDEX_CELL (1. / 60.)  // one minute of latitude, a nautical mile
+#define AIS_INDEX_CELLS (4096)     // grid cells are hashed into this many lists
+#define AIS_INDEX_SECONDS (256)    // expiry buckets of one second, more than any max_age
+
+class AisIndex {
+ public:
+  AisIndex() { Clear(); }
+
+  void Clear();
+
+  // Store the position of mmsi, or move it there.
+  void Update(long mmsi, double lat, double lon, time_t now);
+
+  // Forget the targets that have not been updated for more than max_age seconds,
+  // max_age < AIS_INDEX_SECONDS.
+  void Expire(time_t now, int max_age);
+
+  size_t Size() const { return m_size; }
+
+  // Is there a target with lat - dlat < target lat < lat + dlat and the same for lon?
+  bool FindNear(double lat, double lon, double dlat, double dlon) const;
+
+ private:
+  struct Link {
+    int next;
+    int prev;
+  };
+
+  struct Entry {
+    long mmsi;  // 0 when the entry is free
+    time_t time;
+    double lat;
+    double lon;
+    int hash_next;  // next entry in the same MMSI hash chain
+    int cell;       // index into m_cell
+    Link cell_link;
+    Link time_link;
+  };
+
+  static int LatLonCell(int lat_cell, int lon_cell);
+  static int CellOf(double degrees) { return (int)floor(degrees / AIS_INDEX_CELL); }
+  int HashOf(long mmsi) const { return (int)((unsigned long)mmsi * 2654435761UL % m_hash.size()); }
+
+  void Insert(int *head, Link Entry::*link, int e);
+  void Unlink(int *head, Link Entry::*link, int e);
+  void Remove(int e);
+  void Grow();
+
+  vector<Entry> m_entries;
+  vector<int> m_free;  // free indexes in m_entries
+  vector<int> m_hash;  // first entry of each MMSI hash chain, or -1
+  int m_cell[AIS_INDEX_CELLS];
+  int m_second[AIS_INDEX_SECONDS];
+  time_t m_expired;  // the entries before this time have been removed
+  size_t m_size;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif
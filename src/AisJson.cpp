@@ -0,0 +1,272 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include "AisJson.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define AIS_JSON_MAX_DIGITS (15)  // a double holds any integer of this many digits exactly
+
+enum AisJsonKey { AIS_JSON_OTHER, AIS_JSON_MMSI, AIS_JSON_LAT, AIS_JSON_LON };
+
+// A control character or the end of the text; bytes of UTF-8 text are not
+template <typename C>
+static bool IsControl(C c) {
+  return (unsigned long)c < (unsigned long)' ';
+}
+
+template <typename C>
+static void SkipSpace(const C **p) {
+  while (**p == ' ' || **p == '\t' || **p == '\n' || **p == '\r') {
+    (*p)++;
+  }
+}
+
+template <typename C>
+static bool Match(const C *p, const char *s) {
+  while (*s) {
+    if (*p++ != (C)*s++) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// A string key without escapes; which of the keys we want it is
+template <typename C>
+static bool ParseKey(const C **p, AisJsonKey *key) {
+  const C *s = *p + 1;
+  const C *e = s;
+
+  while (*e != '"') {
+    if (*e == '\\' || IsControl(*e)) {
+      return false;
+    }
+    e++;
+  }
+  *key = AIS_JSON_OTHER;
+  if (e - s == 4 && Match(s, "mmsi")) {
+    *key = AIS_JSON_MMSI;
+  } else if (e - s == 3 && Match(s, "lat")) {
+    *key = AIS_JSON_LAT;
+  } else if (e - s == 3 && Match(s, "lon")) {
+    *key = AIS_JSON_LON;
+  }
+  *p = e + 1;
+  return true;
+}
+
+template <typename C>
+static bool SkipString(const C **p) {
+  const C *s = *p + 1;
+
+  while (*s != '"') {
+    if (IsControl(*s)) {
+      return false;  // includes the end of the text
+    }
+    if (*s == '\\') {
+      s++;
+      if (IsControl(*s)) {
+        return false;
+      }
+    }
+    s++;
+  }
+  *p = s + 1;
+  return true;
+}
+
+// A JSON number, converted exactly: at most AIS_JSON_MAX_DIGITS significant digits and
+// a power of ten that is itself exact in a double, so one multiplication or division rounds
+// just like strtod. is_integer tells whether it had neither a fraction nor an exponent.
+template <typename C>
+static bool ParseNumber(const C **p, double *value, bool *is_integer) {
+  static const double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  const C *s = *p;
+  bool negative = false;
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+
+  if (*s == '-') {
+    negative = true;
+    s++;
+  }
+  if (*s < '0' || *s > '9') {
+    return false;
+  }
+  *is_integer = true;
+  for (; *s >= '0' && *s <= '9'; s++) {
+    if (mantissa || *s != '0') {
+      if (++digits > AIS_JSON_MAX_DIGITS) {
+        return false;
+      }
+    }
+    mantissa = mantissa * 10 + (*s - '0');
+  }
+  if (*s == '.') {
+    *is_integer = false;
+    s++;
+    if (*s < '0' || *s > '9') {
+      return false;
+    }
+    for (; *s >= '0' && *s <= '9'; s++) {
+      if (mantissa || *s != '0') {
+        if (++digits > AIS_JSON_MAX_DIGITS) {
+          return false;
+        }
+      }
+      mantissa = mantissa * 10 + (*s - '0');
+      exponent--;
+    }
+  }
+  if (*s == 'e' || *s == 'E') {
+    *is_integer = false;
+    s++;
+    int sign = 1;
+    int e = 0;
+    if (*s == '-' || *s == '+') {
+      sign = *s == '-' ? -1 : 1;
+      s++;
+    }
+    if (*s < '0' || *s > '9') {
+      return false;
+    }
+    for (; *s >= '0' && *s <= '9'; s++) {
+      e = e * 10 + (*s - '0');
+      if (e > 1000) {
+        return false;
+      }
+    }
+    exponent += sign * e;
+  }
+  if (exponent < -(int)ARRAY_SIZE(powers) + 1 || exponent > (int)ARRAY_SIZE(powers) - 1) {
+    return false;
+  }
+
+  double v = (double)mantissa;
+  if (exponent < 0) {
+    v /= powers[-exponent];
+  } else {
+    v *= powers[exponent];
+  }
+  *value = negative ? -v : v;
+  *p = s;
+  return true;
+}
+
+template <typename C>
+static bool Parse(const C *p, long *mmsi, double *lat, double *lon) {
+  *mmsi = 999;
+  *lat = 90.;
+  *lon = 90.;
+
+  SkipSpace(&p);
+  if (*p++ != '{') {
+    return false;
+  }
+  SkipSpace(&p);
+  if (*p == '}') {
+    p++;
+  } else {
+    for (;;) {
+      AisJsonKey key;
+      if (*p != '"' || !ParseKey(&p, &key)) {
+        return false;
+      }
+      SkipSpace(&p);
+      if (*p++ != ':') {
+        return false;
+      }
+      SkipSpace(&p);
+
+      double value;
+      bool is_integer;
+      if (*p == '"') {
+        // wxJSONReader code read lat and lon as strings, so they may well be sent as strings
+        const C *s = p + 1;
+        if (key != AIS_JSON_OTHER && key != AIS_JSON_MMSI) {
+          if (!ParseNumber(&s, &value, &is_integer) || *s != '"') {
+            return false;
+          }
+          *(key == AIS_JSON_LAT ? lat : lon) = value;
+        } else if (key == AIS_JSON_MMSI) {
+          return false;
+        }
+        if (!SkipString(&p)) {
+          return false;
+        }
+      } else if (*p == '-' || (*p >= '0' && *p <= '9')) {
+        if (!ParseNumber(&p, &value, &is_integer)) {
+          return false;
+        }
+        if (key == AIS_JSON_MMSI) {
+          if (!is_integer || value < 0. || value > 999999999.) {
+            return false;
+          }
+          *mmsi = (long)value;
+        } else if (key == AIS_JSON_LAT) {
+          *lat = value;
+        } else if (key == AIS_JSON_LON) {
+          *lon = value;
+        }
+      } else if (Match(p, "true") && key == AIS_JSON_OTHER) {
+        p += 4;
+      } else if (Match(p, "false") && key == AIS_JSON_OTHER) {
+        p += 5;
+      } else if (Match(p, "null") && key == AIS_JSON_OTHER) {
+        p += 4;
+      } else {
+        return false;  // an object or array, or something that is not JSON
+      }
+
+      SkipSpace(&p);
+      if (*p == '}') {
+        p++;
+        break;
+      }
+      if (*p++ != ',') {
+        return false;
+      }
+      SkipSpace(&p);
+    }
+  }
+  SkipSpace(&p);
+  return *p == 0;
+}
+
+bool ParseAisJson(const char *json, long *mmsi, double *lat, double *lon) { return Parse(json, mmsi, lat, lon); }
+
+bool ParseAisJson(const wchar_t *json, long *mmsi, double *lat, double *lon) { return Parse(json, mmsi, lat, lon); }
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,56 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _AISJSON_H_
+#define _AISJSON_H_
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/*
+ * Reads the MMSI and position from the JSON of an "AIS" plugin message, without building a
+ * wxJSONValue tree and without allocating memory.
+ *
+ * OpenCPN sends a flat object of numbers, strings and booleans. Anything else, such as a
+ * nested value, a key with escapes, or a number that can not be converted exactly without
+ * strtod, makes it return false; the caller should then fall back to wxJSONReader.
+ * Just like the wxJSONReader code, a missing mmsi is 999 and a missing lat or lon is 90.
+ * Numbers are read the same in every locale.
+ */
+
+extern bool ParseAisJson(const char *json, long *mmsi, double *lat, double *lon);
+extern bool ParseAisJson(const wchar_t *json, long *mmsi, double *lat, double *lon);
+
+PLUGIN_END_NAMESPACE
+
+#endif
@@ -0,0 +1,217 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include "ArpaNmea.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+static const double POWERS_OF_TEN[] = {1., 10., 100., 1000., 10000., 100000., 1000000.};
+static const char HEX[] = "0123456789ABCDEF";
+
+#define NMEA_MAX_FIXED (2000000000.)  // larger values, after scaling by the decimals, are cut off
+
+void NmeaBuilder::Start(const char *address) {
+  m_length = 0;
+  while (*address) {
+    Put(*address++);
+  }
+}
+
+void NmeaBuilder::Field(const char *s) {
+  Put(',');
+  while (*s) {
+    Put(*s++);
+  }
+}
+
+void NmeaBuilder::Field(char c) {
+  Put(',');
+  Put(c);
+}
+
+void NmeaBuilder::EmptyField() { Put(','); }
+
+void NmeaBuilder::PutUnsigned(unsigned long v, int digits) {
+  char tmp[12];
+  int n = 0;
+
+  do {
+    tmp[n++] = (char)('0' + v % 10);
+    v /= 10;
+  } while (v > 0 && n < (int)sizeof(tmp));
+  while (n < digits) {
+    tmp[n++] = '0';
+  }
+  while (n > 0) {
+    Put(tmp[--n]);
+  }
+}
+
+void NmeaBuilder::FieldInt(int v, int digits) {
+  Put(',');
+  if (v < 0) {
+    Put('-');
+    v = -v;
+  }
+  PutUnsigned((unsigned long)v, digits);
+}
+
+void NmeaBuilder::FieldFixed(double v, int decimals) {
+  Put(',');
+  if (wxIsNaN(v)) {
+    return;
+  }
+  double scale = POWERS_OF_TEN[decimals];
+  double scaled = floor(fabs(v) * scale + 0.5);
+  if (scaled > NMEA_MAX_FIXED) {
+    scaled = NMEA_MAX_FIXED;
+  }
+  unsigned long n = (unsigned long)scaled;
+  unsigned long whole = n / (unsigned long)scale;
+
+  if (v < 0 && n > 0) {
+    Put('-');
+  }
+  PutUnsigned(whole, 1);
+  if (decimals > 0) {
+    Put('.');
+    PutUnsigned(n - whole * (unsigned long)scale, decimals);
+  }
+}
+
+void NmeaBuilder::FieldLatLon(double v, bool longitude) {
+  // in 1/10000 minutes, 180 degrees is 108000000
+  unsigned long n = (unsigned long)floor(fabs(v) * 60. * 10000. + 0.5);
+
+  Put(',');
+  PutUnsigned(n / 600000, longitude ? 3 : 2);
+  n %= 600000;
+  PutUnsigned(n / 10000, 2);
+  Put('.');
+  PutUnsigned(n % 10000, 4);
+  if (longitude) {
+    Field(v < 0 ? 'W' : 'E');
+  } else {
+    Field(v < 0 ? 'S' : 'N');
+  }
+}
+
+void NmeaBuilder::FieldTime(long ms) {
+  unsigned long cs = (unsigned long)(ms / 10);  // hundreds of a second
+
+  Put(',');
+  PutUnsigned(cs / 360000 % 24, 2);
+  PutUnsigned(cs / 6000 % 60, 2);
+  PutUnsigned(cs / 100 % 60, 2);
+  Put('.');
+  PutUnsigned(cs % 100, 2);
+}
+
+const char *NmeaBuilder::Finish() {
+  UINT8 checksum = 0;
+
+  for (size_t i = 1; i < m_length; i++) {  // between the $ and the *
+    checksum ^= (UINT8)m_buf[i];
+  }
+  m_buf[m_length++] = '*';
+  m_buf[m_length++] = HEX[checksum >> 4];
+  m_buf[m_length++] = HEX[checksum & 15];
+  m_buf[m_length++] = '\r';
+  m_buf[m_length++] = '\n';
+  m_buf[m_length] = 0;
+  return m_buf;
+}
+
+// The target name, "ARPA" or "MARPA" with the id right aligned in four characters
+static void PutName(NmeaBuilder *b, const ArpaReport &r) {
+  char name[16];
+  char *p = name;
+  const char *prefix = r.automatic ? "ARPA" : "MARPA";
+  char digits[12];
+  int n = 0;
+  unsigned int id = (unsigned int)(r.target_id < 0 ? 0 : r.target_id);
+
+  while (*prefix) {
+    *p++ = *prefix++;
+  }
+  do {
+    digits[n++] = (char)('0' + id % 10);
+    id /= 10;
+  } while (id > 0 && n < 10);
+  for (int i = n; i < 4; i++) {
+    *p++ = ' ';
+  }
+  while (n > 0) {
+    *p++ = digits[--n];
+  }
+  *p = 0;
+  b->Field(name);
+}
+
+const char *FormatTTM(NmeaBuilder *b, const ArpaReport &r) {
+  b->Start("$RATTM");
+  b->FieldInt(r.target_id, 2);        // 1 target number
+  b->FieldFixed(r.distance_nm, 3);    // 2 target distance
+  b->FieldFixed(r.bearing, 1);        // 3 bearing from own ship
+  b->EmptyField();                    // 4 bearing unit, T = true, R = relative
+  b->FieldFixed(r.speed_kn, 2);       // 5 target speed
+  b->FieldFixed(r.course, 1);         // 6 target course
+  b->Field('T');                      // 7 course unit
+  if (r.has_cpa) {
+    b->FieldFixed(r.cpa_nm, 2);       // 8 CPA
+    b->FieldFixed(r.tcpa_min, 1);     // 9 TCPA in minutes
+  } else {
+    b->EmptyField();
+    b->EmptyField();
+  }
+  b->Field('N');                      // 10 speed and distance unit, knots and nautical miles
+  PutName(b, r);                      // 11 target name
+  b->Field(r.status);                 // 12 target status
+  b->EmptyField();                    // 13 reference target
+  b->FieldTime(r.time_of_day_ms);     // 14 UTC
+  b->Field(r.automatic ? 'A' : 'M');  // 15 acquisition type
+  return b->Finish();
+}
+
+const char *FormatTLL(NmeaBuilder *b, const ArpaReport &r) {
+  b->Start("$RATLL");
+  b->FieldInt(r.target_id, 2);     // 1 target number
+  b->FieldLatLon(r.lat, false);    // 2, 3 latitude
+  b->FieldLatLon(r.lon, true);     // 4, 5 longitude
+  PutName(b, r);                   // 6 target name
+  b->FieldTime(r.time_of_day_ms);  // 7 UTC
+  b->Field(r.status);              // 8 target status
+  b->EmptyField();                 // 9 reference target
+  return b->Finish();
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,100 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _ARPA_NMEA_H_
+#define _ARPA_NMEA_H_
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/*
+ * Builds the NMEA 0183 sentences that pass ARPA targets to OpenCPN in a fixed buffer,
+ * with its own number formatting, so that reporting a target doesn't allocate or go
+ * through printf.
+ */
+
+#define NMEA_MAX_SENTENCE (100)  // more than the 82 of the standard, the target names are free
+
+// What is reported of a target
+struct ArpaReport {
+  int target_id;
+  bool automatic;      // ARPA, else MARPA; only used in the name
+  char status;         // 'Q' acquiring, 'T' tracking or 'L' lost
+  double distance_nm;  // from own ship
+  double bearing;      // degrees
+  double speed_kn;
+  double course;  // degrees true
+  bool has_cpa;
+  double cpa_nm;
+  double tcpa_min;  // negative when the target moves away
+  double lat;
+  double lon;
+  long time_of_day_ms;  // UTC
+};
+
+class NmeaBuilder {
+ public:
+  NmeaBuilder() { m_length = 0; }
+
+  void Start(const char *address);  // e.g. "$RATTM"
+  void Field(const char *s);
+  void Field(char c);
+  void EmptyField();
+  void FieldInt(int v, int digits);            // at least digits long, zero padded
+  void FieldFixed(double v, int decimals);     // empty when v is not a number
+  void FieldLatLon(double v, bool longitude);  // two fields: [d]ddmm.mmmm and the hemisphere
+  void FieldTime(long time_of_day_ms);         // hhmmss.ss
+  const char *Finish();                        // adds the checksum and CR LF, returns the sentence
+  size_t Length() const { return m_length; }
+
+ private:
+  void Put(char c) {
+    if (m_length < NMEA_MAX_SENTENCE - 5) {  // keep room for *hh\r\n
+      m_buf[m_length++] = c;
+    }
+  }
+  void PutUnsigned(unsigned long v, int digits);
+
+  char m_buf[NMEA_MAX_SENTENCE + 1];
+  size_t m_length;
+};
+
+// Target tracked message, range and bearing of the target
+const char *FormatTTM(NmeaBuilder *b, const ArpaReport &r);
+
+// Target latitude and longitude
+const char *FormatTLL(NmeaBuilder *b, const ArpaReport &r);
+
+PLUGIN_END_NAMESPACE
+
+#endif
@@ -0,0 +1,208 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _CONTOURTRACER_H_
+#define _CONTOURTRACER_H_
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+// Bits in RadarInfo::m_history lines used by ARPA
+#define HISTORY_UNCLAIMED (128)  // return above threshold that no target has claimed this sweep
+#define HISTORY_RETURN (64)      // return above threshold, also when claimed by a target
+
+/*
+ * Pixel predicate for the tracer: is the given bit set in the history at (angle, r)?
+ * The bit is a template parameter so testing it costs no branch per pixel.
+ * Line is any struct with a `UINT8 line[RETURNS_PER_LINE]` member.
+ */
+template <typename Line, UINT8 bit>
+class HistoryPixel {
+ public:
+  HistoryPixel(const Line *history) : m_history(history) {}
+
+  bool operator()(int angle, int r) const {
+    if (r <= 1 || r >= RETURNS_PER_LINE - 1) {  //  avoid range ring
+      return false;
+    }
+    // LINES_PER_ROTATION is a power of two, so this also wraps negative angles
+    return (m_history[angle & (LINES_PER_ROTATION - 1)].line[r] & bit) != 0;
+  }
+
+ private:
+  const Line *m_history;
+};
+
+/*
+ * Output policies for the tracer. Step() is called for every next point on the contour;
+ * when it returns false the trace stops.
+ */
+
+// Only counts the contour, up to a limit.
+class ContourCount {
+ public:
+  ContourCount(int limit) : m_limit(limit), m_count(0) {}
+
+  void Start(int angle, int r) {}
+  bool Step(int angle, int r) {
+    if (m_count >= m_limit) {
+      return false;
+    }
+    m_count++;
+    return true;
+  }
+
+  int m_limit;
+  int m_count;
+};
+
+// Counts up to a limit and keeps the bounding box of the points seen.
+class ContourBounds : public ContourCount {
+ public:
+  ContourBounds(int limit) : ContourCount(limit) {}
+
+  void Start(int angle, int r) {
+    m_min_angle = m_max_angle = angle;
+    m_min_r = m_max_r = r;
+  }
+  bool Step(int angle, int r) {
+    if (!ContourCount::Step(angle, r)) {
+      return false;
+    }
+    Extend(angle, r);
+    return true;
+  }
+  void Extend(int angle, int r) {
+    if (angle > m_max_angle) m_max_angle = angle;
+    if (angle < m_min_angle) m_min_angle = angle;
+    if (r > m_max_r) m_max_r = r;
+    if (r < m_min_r) m_min_r = r;
+  }
+
+  int m_min_angle, m_max_angle;  // m_min_angle may be negative when the contour crosses north
+  int m_min_r, m_max_r;
+};
+
+// Stores the whole contour in the caller's array of `max_length` points (anything with
+// `angle` and `r` members). A longer contour is cut short with a jump back to the start.
+template <typename Point>
+class ContourRecorder : public ContourBounds {
+ public:
+  ContourRecorder(Point *contour, int max_length) : ContourBounds(max_length - 1), m_contour(contour) {}
+
+  void Start(int angle, int r) {
+    ContourBounds::Start(angle, r);
+    m_start_angle = angle;
+    m_start_r = r;
+  }
+  bool Step(int angle, int r) {
+    bool more = true;
+
+    if (m_count == m_limit - 1) {
+      angle = m_start_angle;  // shortcut to the beginning for drawing the contour
+      r = m_start_r;
+      more = false;
+    }
+    m_contour[m_count].angle = angle;
+    m_contour[m_count].r = r;
+    m_count++;
+    Extend(angle, r);
+    return more;
+  }
+
+ private:
+  Point *m_contour;
+  int m_start_angle, m_start_r;
+};
+
+enum ContourResult {
+  CONTOUR_CLOSED,         // back at the start point
+  CONTOUR_STOPPED,        // the output policy stopped the trace
+  CONTOUR_NOT_ON_EDGE,    // the start point has no empty neighbour
+  CONTOUR_NO_NEXT_POINT,  // the start point is a single pixel
+};
+
+/*
+ * Follow the contour of a blob clockwise, starting at (angle, r) which must be set and
+ * on the edge of the blob. The tracer always turns left if it can.
+ */
+template <typename Pixel, typename Output>
+ContourResult TraceContour(const Pixel &pix, int angle, int r, Output &out) {
+  // the 4 possible translations to move from a point on the contour to the next
+  static const int transl_angle[4] = {0, 1, 0, -1};
+  static const int transl_r[4] = {1, 0, -1, 0};
+  int start_angle = angle;
+  int start_r = r;
+  int index;
+
+  out.Start(angle, r);
+
+  // first find the orientation of border point p
+  for (index = 0; index < 4; index++) {
+    if (!pix(angle + transl_angle[index], r + transl_r[index])) {
+      break;
+    }
+  }
+  if (index == 4) {
+    return CONTOUR_NOT_ON_EDGE;
+  }
+  index = (index + 1) & 3;  // determines starting direction
+
+  do {
+    // try all translations to find the next point, starting with the "left most" one
+    // relative to the previous one
+    int i;
+
+    index += 3;
+    for (i = 0; i < 4; i++, index++) {
+      index &= 3;
+      if (pix(angle + transl_angle[index], r + transl_r[index])) {
+        break;
+      }
+    }
+    if (i == 4) {
+      return CONTOUR_NO_NEXT_POINT;
+    }
+    angle += transl_angle[index];
+    r += transl_r[index];
+    if (!out.Step(angle, r)) {
+      return CONTOUR_STOPPED;
+    }
+  } while (angle != start_angle || r != start_r);
+
+  return CONTOUR_CLOSED;
+}
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _CONTOURTRACER_H_ */
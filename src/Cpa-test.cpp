@@ -0,0 +1,168 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include <wx/stopwatch.h>
+
+#include "Cpa.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define BENCH_ROUNDS (2000)
+#define BENCH_LANES (1000)
+
+#define ASSERT_VALUE(name, actual, expected)                                                       \
+  if (fabs((actual) - (expected)) > 0.001) {                                                       \
+    cout << "ERROR: " name " is not expected value " << (expected) << " but " << (actual) << "\n"; \
+    ret = 1;                                                                                       \
+  }
+
+// CPA and TCPA the way they are in the books, to check the batch against
+static void Reference(double n, double e, double vn, double ve, double *cpa, double *tcpa) {
+  double v2 = vn * vn + ve * ve;
+  double t = 0.;
+
+  if (v2 > 1e-4) {
+    t = -(n * vn + e * ve) / v2;
+  }
+  *cpa = sqrt((n + vn * t) * (n + vn * t) + (e + ve * t) * (e + ve * t));
+  *tcpa = t;
+}
+
+int main() {
+  CpaBatch batch;
+  double cpa;
+  double tcpa;
+  int ret = 0;
+
+  for (int i = 0; i < 4; i++) {
+    batch.AddLane();
+  }
+
+  // 1: a mile north, coming straight at us at 5 m/s
+  batch.Queue(0, 1852., 0., -5., 0.);
+  // 2: north west, going east, while we go north at the same speed: collision in 100 s
+  batch.Queue(1, 1000., -1000., 0., 10.);
+  // 3: alongside us at our speed, never any closer
+  batch.Queue(2, 0., 200., 10., 0.);
+  batch.Run(10., 0., 1000.);
+
+  if (!batch.Get(0, 1000., &cpa, &tcpa) || batch.Get(3, 1000., &cpa, &tcpa)) {
+    cout << "ERROR: Lanes with a CPA are not the ones that ran\n";
+    ret = 1;
+  }
+  batch.Get(0, 1000., &cpa, &tcpa);
+  ASSERT_VALUE("head on CPA", cpa, 0.);
+  ASSERT_VALUE("head on TCPA", tcpa, 1852. / 15.);
+  batch.Get(1, 1000., &cpa, &tcpa);
+  ASSERT_VALUE("crossing CPA", cpa, 0.);
+  ASSERT_VALUE("crossing TCPA", tcpa, 100.);
+  batch.Get(2, 1000., &cpa, &tcpa);
+  ASSERT_VALUE("alongside CPA", cpa, 200.);
+  ASSERT_VALUE("alongside TCPA", tcpa, 0.);
+
+  // TCPA counts down without running again
+  batch.Get(1, 1030., &cpa, &tcpa);
+  ASSERT_VALUE("crossing TCPA later", tcpa, 70.);
+  if (batch.CountDangerous(1030., 100., 90.) != 1 || batch.CountDangerous(1000., 100., 150.) != 2) {
+    cout << "ERROR: Wrong number of dangerous targets\n";
+    ret = 1;
+  }
+
+  // When we stop, all lanes are done again from their last position
+  batch.Run(0., 0., 1040.);
+  batch.Get(2, 1040., &cpa, &tcpa);
+  ASSERT_VALUE("alongside CPA when stopped", cpa, 200.);
+  batch.Get(1, 1040., &cpa, &tcpa);
+  ASSERT_VALUE("crossing CPA when stopped", cpa, 1000.);
+  ASSERT_VALUE("crossing TCPA when stopped", tcpa, 60.);
+
+  batch.ResetLane(1);
+  if (batch.Get(1, 1040., &cpa, &tcpa)) {
+    cout << "ERROR: Lane still has a CPA after a reset\n";
+    ret = 1;
+  }
+
+  // 4: keeping station 50 m off our stopped ship is dangerous for as long as it stays there
+  batch.Queue(3, 0., 50., 0., 0.);
+  batch.Run(0., 0., 1050.);
+  batch.Get(3, 1100., &cpa, &tcpa);
+  ASSERT_VALUE("keeping station CPA", cpa, 50.);
+  ASSERT_VALUE("keeping station TCPA", tcpa, 0.);
+  if (batch.CountDangerous(1100., 100., 90.) != 1) {
+    cout << "ERROR: Target keeping station within the CPA limit is not dangerous\n";
+    ret = 1;
+  }
+
+  // Many targets against the reference, and the time it takes when all of them were refreshed
+  CpaBatch many;
+  vector<double> target(4 * BENCH_LANES);
+  srand(1);
+  for (int i = 0; i < BENCH_LANES; i++) {
+    many.AddLane();
+    for (int j = 0; j < 4; j++) {
+      target[i * 4 + j] = (j < 2) ? rand() % 20000 - 10000. : (rand() % 2000 - 1000.) / 100.;
+    }
+  }
+  wxStopWatch sw;
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    for (int i = 0; i < BENCH_LANES; i++) {
+      many.Queue(i, target[i * 4], target[i * 4 + 1], target[i * 4 + 2], target[i * 4 + 3]);
+    }
+    many.Run(3., 4., round);
+  }
+  double ns = sw.Time() * 1e6 / ((double)BENCH_ROUNDS * BENCH_LANES);
+
+  double diff = 0.;
+  for (int i = 0; i < BENCH_LANES; i++) {
+    double ref_cpa;
+    double ref_tcpa;
+    Reference(target[i * 4], target[i * 4 + 1], target[i * 4 + 2] - 3., target[i * 4 + 3] - 4., &ref_cpa, &ref_tcpa);
+    many.Get(i, BENCH_ROUNDS - 1, &cpa, &tcpa);
+    diff = MAX(diff, MAX(fabs(cpa - ref_cpa), fabs(tcpa - ref_tcpa)));
+  }
+  cout << "INFO: CPA of " << BENCH_LANES << " targets in " << ns << " ns per target, difference " << diff << "\n";
+  if (diff > 1e-6) {
+    cout << "ERROR: Batch differs from the reference\n";
+    ret = 1;
+  }
+
+  if (ret == 0) {
+    cout << "INFO: TEST PASSED\n";
+  } else {
+    cout << "ERROR: TEST FAILED\n";
+  }
+  return ret;
+}
+
+PLUGIN_END_NAMESPACE
+
+int main() { return br24::main(); }
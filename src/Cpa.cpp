@@ -0,0 +1,143 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include "Cpa.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define CPA_MIN_SPEED2 (1e-4)       // (m/s)^2, below this the targets don't move relative to each other
+#define CPA_OWN_SPEED_CHANGE (0.1)  // m/s, change of own ship speed that makes all lanes run again
+
+int CpaBatch::AddLane() {
+  int lane = (int)m_north.size();
+
+  m_north.push_back(0.);
+  m_east.push_back(0.);
+  m_v_north.push_back(0.);
+  m_v_east.push_back(0.);
+  m_time.push_back(0.);
+  m_cpa.push_back(0.);
+  m_tcpa.push_back(0.);
+  m_valid.push_back(0);
+  m_moving.push_back(0);
+  m_queued.push_back(0);
+  return lane;
+}
+
+void CpaBatch::ResetLane(int lane) {
+  m_valid[lane] = 0;
+  m_queued[lane] = 0;
+}
+
+void CpaBatch::Queue(int lane, double north, double east, double v_north, double v_east) {
+  m_north[lane] = north;
+  m_east[lane] = east;
+  m_v_north[lane] = v_north;
+  m_v_east[lane] = v_east;
+  m_queued[lane] = 1;
+}
+
+void CpaBatch::Run(double own_v_north, double own_v_east, double now) {
+  size_t n = Size();
+  bool all = fabs(own_v_north - m_own_v_north) > CPA_OWN_SPEED_CHANGE || fabs(own_v_east - m_own_v_east) > CPA_OWN_SPEED_CHANGE;
+
+  if (all) {
+    m_own_v_north = own_v_north;
+    m_own_v_east = own_v_east;
+  }
+  if (n == 0) {
+    return;
+  }
+
+  const double* pn = &m_north[0];
+  const double* pe = &m_east[0];
+  const double* vn = &m_v_north[0];
+  const double* ve = &m_v_east[0];
+  double* time = &m_time[0];
+  double* cpa = &m_cpa[0];
+  double* tcpa = &m_tcpa[0];
+  UINT8* valid = &m_valid[0];
+  UINT8* moves = &m_moving[0];
+  UINT8* queued = &m_queued[0];
+
+  // Every lane is computed and the result is only stored for the ones that need it,
+  // so the loop has no branches.
+  for (size_t k = 0; k < n; k++) {
+    double rvn = vn[k] - m_own_v_north;  // speed relative to own ship
+    double rve = ve[k] - m_own_v_east;
+    double v2 = rvn * rvn + rve * rve;
+    bool moving = v2 > CPA_MIN_SPEED2;
+    double t = -(pn[k] * rvn + pe[k] * rve) / (moving ? v2 : 1.);
+    t = moving ? t : 0.;
+    double cn = pn[k] + rvn * t;
+    double ce = pe[k] + rve * t;
+    double d = sqrt(cn * cn + ce * ce);
+    bool q = queued[k] != 0;
+    bool update = q || (all && valid[k] != 0);
+
+    cpa[k] = update ? d : cpa[k];
+    tcpa[k] = update ? t : tcpa[k];
+    time[k] = q ? now : time[k];
+    valid[k] = update ? 1 : valid[k];
+    moves[k] = update ? (UINT8)moving : moves[k];
+    queued[k] = 0;
+  }
+}
+
+void CpaBatch::Invalidate() {
+  for (size_t k = 0; k < Size(); k++) {
+    m_valid[k] = 0;
+    m_queued[k] = 0;
+  }
+}
+
+bool CpaBatch::Get(int lane, double now, double* cpa, double* tcpa) const {
+  if (!m_valid[lane]) {
+    return false;
+  }
+  *cpa = m_cpa[lane];
+  *tcpa = m_moving[lane] ? m_tcpa[lane] - (now - m_time[lane]) : 0.;
+  return true;
+}
+
+int CpaBatch::CountDangerous(double now, double max_cpa, double max_tcpa) const {
+  size_t n = Size();
+  int count = 0;
+
+  for (size_t k = 0; k < n; k++) {
+    double t = m_moving[k] ? m_tcpa[k] - (now - m_time[k]) : 0.;  // keeping station: as close as it gets, now
+    count += (m_valid[k] != 0 && m_cpa[k] <= max_cpa && t >= 0. && t <= max_tcpa) ? 1 : 0;
+  }
+  return count;
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,91 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _BR24CPA_H_
+#define _BR24CPA_H_
+
+#include <vector>
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/*
+ * Closest point of approach of the ARPA targets, for all targets of a radar in a structure
+ * of arrays with one lane per target, the same lanes as KalmanBatch.
+ *
+ * A refreshed target queues its position relative to own ship and its speed over ground.
+ * Run() computes CPA and TCPA of the queued lanes in one loop that the compiler can
+ * vectorise. The others keep their result, unless own ship's speed changed, then they are
+ * all done again. TCPA is counted from the time of the run that computed it, so it goes
+ * down between refreshes without computing anything. A target that does not move relative
+ * to own ship has its CPA now, so its TCPA stays 0.
+ */
+class CpaBatch {
+ public:
+  CpaBatch() {
+    m_own_v_north = 0.;
+    m_own_v_east = 0.;
+  }
+
+  int AddLane();  // returns the new lane
+  size_t Size() const { return m_north.size(); }
+  void ResetLane(int lane);  // the lane has no CPA until it is queued and run again
+
+  // north and east in meters from own ship, v_north and v_east in m/s over ground
+  void Queue(int lane, double north, double east, double v_north, double v_east);
+  void Run(double own_v_north, double own_v_east, double now);  // now in seconds
+  void Invalidate();  // forget all results, when the speed of own ship is not known
+
+  // CPA in meters and TCPA in seconds at time now, false if the lane has no CPA
+  bool Get(int lane, double now, double* cpa, double* tcpa) const;
+
+  // The number of lanes that come closer than max_cpa within max_tcpa seconds from now
+  int CountDangerous(double now, double max_cpa, double max_tcpa) const;
+
+ private:
+  vector<double> m_north;  // position relative to own ship and speed over ground at m_time
+  vector<double> m_east;
+  vector<double> m_v_north;
+  vector<double> m_v_east;
+  vector<double> m_time;
+  vector<double> m_cpa;
+  vector<double> m_tcpa;  // relative to m_time
+  vector<UINT8> m_valid;  // m_cpa and m_tcpa have been computed
+  vector<UINT8> m_moving;  // the target moves relative to own ship, else m_tcpa is always 0
+  vector<UINT8> m_queued;
+  double m_own_v_north;  // own ship speed of the last run
+  double m_own_v_east;
+};
+
+PLUGIN_END_NAMESPACE
+#endif
@@ -47,73 +47,80 @@ GuardZone::GuardZone(br24radar_pi* pi, RadarInfo* ri, int zone) {
   m_arpa_on = 0;
   m_alarm_on = 0;
   m_show_time = 0;
-  CLEAR_STRUCT(arpa_update_time);
+  m_span_range = 0;  // spans are built by the first spoke
   ResetBogeys();
 }
 
-void GuardZone::ProcessSpoke(SpokeBearing angle, UINT8* data, UINT8* hist, size_t len, int range) {
+// Work out once which returns of each spoke are in the zone, instead of doing so for every spoke
+void GuardZone::BuildSpans(int range) {
   size_t range_start = m_inner_range * RETURNS_PER_LINE / range;  // Convert from meters to 0..511
-  size_t range_end = m_outer_range * RETURNS_PER_LINE / range;    // Convert from meters to 0..511
-  bool in_guard_zone = false;
-
-  switch (m_type) {
-    case GZ_ARC:
-      if ((angle >= m_start_bearing && angle < m_end_bearing) ||
-          (m_start_bearing >= m_end_bearing && (angle >= m_start_bearing || angle < m_end_bearing))) {
-        if (range_start < RETURNS_PER_LINE) {
-          if (range_end > RETURNS_PER_LINE) {
-            range_end = RETURNS_PER_LINE;
-          }
-          for (size_t r = range_start; r <= range_end; r++) {
-            if (data[r] >= m_pi->m_settings.threshold_blue) {
-              m_running_count++;
-            }
+  size_t range_end = m_outer_range * RETURNS_PER_LINE / range + 1;
+  if (range_start > RETURNS_PER_LINE) {
+    range_start = RETURNS_PER_LINE;
+  }
+  if (range_end > RETURNS_PER_LINE) {
+    range_end = RETURNS_PER_LINE;
+  }
+
+  for (SpokeBearing angle = 0; angle < LINES_PER_ROTATION; angle++) {
+    GuardSpan& span = m_span[angle];
+    bool in_zone;
+
+    switch (m_type) {
+      case GZ_ARC:
+        in_zone = (angle >= m_start_bearing && angle < m_end_bearing) ||
+                  (m_start_bearing >= m_end_bearing && (angle >= m_start_bearing || angle < m_end_bearing));
+        break;
+      case GZ_CIRCLE:
+        in_zone = range_start < RETURNS_PER_LINE;
+        break;
+      default:
+        in_zone = false;
+        break;
+    }
+    span.start = in_zone ? range_start : GUARD_SPAN_NONE;
+    span.end = in_zone ? range_end : GUARD_SPAN_NONE;
+  }
+
+  m_span_type = m_type;
+  m_span_start_bearing = m_start_bearing;
+  m_span_end_bearing = m_end_bearing;
+  m_span_inner_range = m_inner_range;
+  m_span_outer_range = m_outer_range;
+  m_span_range = range;
+  LOG_GUARD(wxT("%s spans rebuilt for range=%d guardzone=%d..%d"), m_log_name.c_str(), range, (int)range_start, (int)range_end);
+}
+
+void GuardZone::ProcessSpoke(SpokeBearing angle, UINT8* data, const uint64_t* strong, int range) {
+  if (range != m_span_range || m_type != m_span_type || m_start_bearing != m_span_start_bearing ||
+      m_end_bearing != m_span_end_bearing || m_inner_range != m_span_inner_range || m_outer_range != m_span_outer_range) {
+    BuildSpans(range);
+  }
+
+  const GuardSpan& span = m_span[angle];
+  bool in_guard_zone = span.start != GUARD_SPAN_NONE;
+
+  if (in_guard_zone) {
+    m_running_count += CountStrong(strong, span.start, span.end);
 #ifdef TEST_GUARD_ZONE_LOCATION
-            // Zap guard zone computation location to green so this is visible on screen
-            else {
-              data[r] = m_pi->m_settings.threshold_green;
-            }
-#endif
-          }
-        }
-        in_guard_zone = true;
+    // Zap guard zone computation location to green so this is visible on screen
+    for (size_t r = span.start; r < span.end; r++) {
+      if (data[r] < m_pi->m_settings.threshold_blue) {
+        data[r] = m_pi->m_settings.threshold_green;
       }
-      break;
-
-    case GZ_CIRCLE:
-      if (range_start < RETURNS_PER_LINE) {
-        if (range_end > RETURNS_PER_LINE) {
-          range_end = RETURNS_PER_LINE;
-        }
-
-        for (size_t r = range_start; r <= range_end; r++) {
-          if (data[r] >= m_pi->m_settings.threshold_blue) {
-            m_running_count++;
-          }
-#ifdef TEST_GUARD_ZONE_LOCATION
-          // Zap guard zone computation location to green so this is visible on screen
-          else {
-            data[r] = m_pi->m_settings.threshold_green;
-          }
+    }
 #endif
-        }
-        if (angle > m_last_angle) {
-          in_guard_zone = true;
-        }
-      }
-      break;
-
-    default:
-      in_guard_zone = false;
-      break;
+    if (m_type == GZ_CIRCLE && angle <= m_last_angle) {
+      in_guard_zone = false;  // a full circle is done when the spokes start again
+    }
   }
 
   if (m_last_in_guard_zone && !in_guard_zone) {
     // last bearing that could add to m_running_count, so store as bogey_count;
     m_bogey_count = m_running_count;
     m_running_count = 0;
-    LOG_GUARD(wxT("%s angle=%d last_angle=%d range=%d guardzone=%d..%d (%d - %d) bogey_count=%d"), m_log_name.c_str(), angle,
-              m_last_angle, range, range_start, range_end, m_inner_range, m_outer_range, m_bogey_count);
+    LOG_GUARD(wxT("%s angle=%d last_angle=%d range=%d guardzone=%d - %d bogey_count=%d"), m_log_name.c_str(), angle, m_last_angle,
+              range, m_inner_range, m_outer_range, m_bogey_count);
 
     // When debugging with a static ship it is hard to find moving targets, so move
     // the guard zone instead. This slowly rotates the guard zone.
@@ -129,11 +136,11 @@ void GuardZone::ProcessSpoke(SpokeBearing angle, UINT8* data, UINT8* hist, size_
   m_last_angle = angle;
 }
 
-// Search guard zone for ARPA targets
-void GuardZone::SearchTargets() {
+// Acquire the new blobs inside the guard zone as ARPA targets
+void GuardZone::SearchTargets(const vector<SweepBlob>& blobs) {
   Position own_pos;
 
-  if (!m_arpa_on) {
+  if (!m_arpa_on || blobs.empty()) {
     return;
   }
   if (m_ri->m_arpa->GetTargetCount() >= MAX_NUMBER_OF_TARGETS - 2) {
@@ -149,8 +156,8 @@ void GuardZone::SearchTargets() {
   if (m_ri->m_range_meters == 0) {
     return;
   }
-  size_t range_start = m_inner_range * RETURNS_PER_LINE / m_ri->m_range_meters;  // Convert from meters to 0..511
-  size_t range_end = m_outer_range * RETURNS_PER_LINE / m_ri->m_range_meters;    // Convert from meters to 0..511
+  int range_start = m_inner_range * RETURNS_PER_LINE / m_ri->m_range_meters;  // Convert from meters to 0..511
+  int range_end = m_outer_range * RETURNS_PER_LINE / m_ri->m_range_meters;    // Convert from meters to 0..511
 
   SpokeBearing hdt = SCALE_DEGREES_TO_RAW2048(m_pi->GetHeadingTrue());
   SpokeBearing start_bearing = m_start_bearing + hdt;
@@ -165,48 +172,26 @@ void GuardZone::SearchTargets() {
     end_bearing = LINES_PER_ROTATION;
   }
 
-  if (range_start < RETURNS_PER_LINE) {
-    if (range_end > RETURNS_PER_LINE) {
-      range_end = RETURNS_PER_LINE;
+  for (size_t i = 0; i < blobs.size(); i++) {
+    const SweepBlob* blob = &blobs[i];
+
+    // A blob is in the zone when its centroid is
+    int r = (int)blob->centroid_r;
+    if (r < range_start || r >= range_end) {
+      continue;
     }
-    if (range_end < range_start) return;
-
-    for (int angle = start_bearing; angle < end_bearing; angle += 2) {
-      // check if this angle has been updated by the beam since last time
-      // and if possible targets have been refreshed
-
-      wxLongLong time1 = m_ri->m_history[MOD_ROTATION2048(angle)].time;
-      // next one must be timed later than the pass 2 in refresh, otherwise target may be found multiple times
-      wxLongLong time2 = m_ri->m_history[MOD_ROTATION2048(angle + 3 * SCAN_MARGIN)].time;
-
-      // check if target has been refreshed since last time
-      // and if the beam has passed the target location with SCAN_MARGIN spokes
-      if ((time1 > (arpa_update_time[MOD_ROTATION2048(angle)] + SCAN_MARGIN2) &&
-           time2 >= time1)) {  // the beam sould have passed our "angle" AND a point SCANMARGIN further
-                               // set new refresh time
-        arpa_update_time[MOD_ROTATION2048(angle)] = time1;
-        for (int rrr = (int)range_start; rrr < (int)range_end; rrr++) {
-          if (m_ri->m_arpa->GetTargetCount() >= MAX_NUMBER_OF_TARGETS - 1) {
-            LOG_INFO(wxT("BR24radar_pi: No more scanning for ARPA targets in loop, maximum number of targets reached"));
-            return;
-          }
-          if (m_ri->m_arpa->MultiPix(angle, rrr)) {
-            bool next_r = false;
-            if (next_r) continue;
-            // pixel found that does not belong to a known target
-            Polar pol;
-            pol.angle = angle;
-            pol.r = rrr;
-
-            Position x = Polar2Pos(pol, own_pos, m_ri->m_range_meters);
-            int target_i = m_ri->m_arpa->AcquireNewARPATarget(pol, 0);
-            if (target_i == -1) break;
-          }
-        }
-      }
+    int angle = (int)blob->centroid_angle;
+    if (angle < start_bearing) {
+      angle += LINES_PER_ROTATION;
+    }
+    if (angle >= end_bearing) {
+      continue;
+    }
+
+    if (m_ri->m_arpa->AcquireBlob(*blob) < 0) {
+      return;
     }
   }
-  return;
 }
 
 PLUGIN_END_NAMESPACE
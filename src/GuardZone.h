@@ -32,10 +32,14 @@
 #ifndef _GUARDZONE_H_
 #define _GUARDZONE_H_
 
+#include "SpokeKernels.h"
+#include "SweepLabeller.h"
 #include "br24radar_pi.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
+#define GUARD_SPAN_NONE (0xffff)
+
 class GuardZone {
  public:
   GuardZoneType m_type;
@@ -46,7 +50,6 @@ class GuardZone {
   int m_alarm_on;
   int m_arpa_on;
   time_t m_show_time;
-  wxLongLong arpa_update_time[LINES_PER_ROTATION];
 
   void ResetBogeys() {
     m_bogey_count = -1;
@@ -87,12 +90,13 @@ class GuardZone {
   };
 
   /*
-   * Check if data is in this GuardZone, if so update bogeyCount
+   * Check if data is in this GuardZone, if so update bogeyCount. strong has the returns of data
+   * that are at least threshold_blue, packed by the StrongKernel of the radar.
    */
-  void ProcessSpoke(SpokeBearing angle, UINT8 *data, UINT8 *hist, size_t len, int range);
+  void ProcessSpoke(SpokeBearing angle, UINT8 *data, const uint64_t *strong, int range);
 
   // Find targets inside the zone
-  void SearchTargets();
+  void SearchTargets(const vector<SweepBlob> &blobs);
 
   int GetBogeyCount() {
     if (m_bogey_count > -1) {
@@ -115,6 +119,20 @@ class GuardZone {
   int m_bogey_count;    // complete cycle
   int m_running_count;  // current swipe
 
+  // The returns [start, end) of each spoke that are in the zone, for the geometry and range in m_span_...
+  struct GuardSpan {
+    uint16_t start;  // GUARD_SPAN_NONE if the spoke is not in the zone
+    uint16_t end;
+  };
+  GuardSpan m_span[LINES_PER_ROTATION];
+  GuardZoneType m_span_type;
+  SpokeBearing m_span_start_bearing;
+  SpokeBearing m_span_end_bearing;
+  int m_span_inner_range;
+  int m_span_outer_range;
+  int m_span_range;
+
+  void BuildSpans(int range);
   void UpdateSettings();
 };
 
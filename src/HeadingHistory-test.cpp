@@ -0,0 +1,118 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#include <wx/stopwatch.h>
+
+#include "HeadingHistory.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define BENCH_LOOKUPS (1000000)
+
+#define ASSERT_HEADING(name, history, time, expected)                                          \
+  {                                                                                            \
+    double hdt = -1.;                                                                          \
+    if (!(history).HeadingAt((time), &hdt) || fabs(hdt - (expected)) > 0.001) {                \
+      cout << "ERROR: " name " is not expected value " << (expected) << " but " << hdt << "\n"; \
+      ret = 1;                                                                                 \
+    }                                                                                          \
+  }
+
+int main() {
+  int ret = 0;
+  HeadingHistory history;
+  double hdt;
+
+  if (history.HeadingAt(0., &hdt)) {
+    cout << "ERROR: Empty history has a heading\n";
+    ret = 1;
+  }
+
+  // One sample: that is the heading at all times
+  history.Add(1000., 10.);
+  ASSERT_HEADING("single sample before", history, 500., 10.);
+  ASSERT_HEADING("single sample after", history, 1500., 10.);
+
+  // A turn to starboard through north, one sample per second
+  history.Add(2000., 350.);
+  history.Add(3000., 355.);
+  history.Add(4000., 5.);
+  ASSERT_HEADING("between samples", history, 2500., 352.5);
+  ASSERT_HEADING("between samples through north", history, 3500., 0.);
+  ASSERT_HEADING("on a sample", history, 3000., 355.);
+  ASSERT_HEADING("older than all samples", history, 0., 10.);
+
+  // After the last sample the turn goes on, but for at most one sample interval
+  ASSERT_HEADING("extrapolated", history, 4500., 10.);
+  ASSERT_HEADING("extrapolated for one interval", history, 6000., 15.);
+
+  // A jump is not continued, nor a turn between samples that are too far apart
+  history.Add(5000., 90.);
+  ASSERT_HEADING("after a jump", history, 5500., 90.);
+  history.Add(10000., 100.);
+  ASSERT_HEADING("after a gap", history, 10500., 100.);
+
+  // The clock going back gives a sample at the time of the last one
+  history.Add(11000., 100.);
+  history.Add(10900., 120.);
+  ASSERT_HEADING("clock went back", history, 10950., 100.);
+  ASSERT_HEADING("clock went back later", history, 11000., 120.);
+
+  // Many samples from the radar itself, the history only goes back half the ring
+  HeadingHistory radar;
+  for (int i = 0; i < 10 * HEADING_HISTORY_SIZE; i++) {
+    radar.Add(i * 100., i * 0.1);
+  }
+  double last = (10 * HEADING_HISTORY_SIZE - 1) * 0.1;
+  ASSERT_HEADING("radar interpolated", radar, (10 * HEADING_HISTORY_SIZE - 3) * 100. + 50., last - 0.15);
+  ASSERT_HEADING("radar extrapolated", radar, (10 * HEADING_HISTORY_SIZE - 1) * 100. + 50., last + 0.05);
+
+  wxStopWatch sw;
+  double sum = 0.;
+  double start = (10 * HEADING_HISTORY_SIZE - 2) * 100.;
+  for (int i = 0; i < BENCH_LOOKUPS; i++) {
+    radar.HeadingAt(start + (i & 255), &hdt);
+    sum += hdt;
+  }
+  double ns = sw.Time() * 1e6 / BENCH_LOOKUPS;
+  cout << "INFO: Heading lookup in " << ns << " ns (" << sum / BENCH_LOOKUPS << ")\n";
+
+  if (ret == 0) {
+    cout << "INFO: TEST PASSED\n";
+  } else {
+    cout << "ERROR: TEST FAILED\n";
+  }
+  return ret;
+}
+
+PLUGIN_END_NAMESPACE
+
+int main() { return br24::main(); }
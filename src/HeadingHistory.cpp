@@ -0,0 +1,127 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#include "HeadingHistory.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+// Difference b - a between two headings, in (-180, 180]
+static double HeadingDelta(double a, double b) {
+  double d = fmod(b - a, 360.);
+  if (d > 180.) {
+    d -= 360.;
+  } else if (d <= -180.) {
+    d += 360.;
+  }
+  return d;
+}
+
+void HeadingHistory::Add(double time, double hdt) {
+  size_t head = m_head;  // we are the only writer
+
+  if (head > 0) {
+    // A sample is never changed once it is published, so a clock that goes back
+    // gives a sample at the same time instead.
+    const Sample &last = m_sample[(head - 1) & HEADING_HISTORY_MASK];
+    if (last.hdt == hdt && last.time >= time) {
+      return;
+    }
+    time = MAX(time, last.time);
+  }
+  m_sample[head & HEADING_HISTORY_MASK].time = time;
+  m_sample[head & HEADING_HISTORY_MASK].hdt = hdt;
+  HEADING_HISTORY_STORE(&m_head, head + 1);
+}
+
+bool HeadingHistory::HeadingAt(double time, double *hdt) const {
+  for (;;) {
+    size_t head = HEADING_HISTORY_LOAD(&m_head);
+    if (head == 0) {
+      return false;
+    }
+    double result;
+    bool ok = Compute(head, time, &result);
+
+    // Compute() reads at most half the ring back from head, so those samples can only have
+    // been overwritten when the writer added nearly half a ring since.
+    size_t now = HEADING_HISTORY_LOAD(&m_head);
+    if (now - head < HEADING_HISTORY_SIZE / 2 - 1) {
+      if (ok) {
+        result = fmod(result, 360.);
+        if (result < 0.) {
+          result += 360.;
+        }
+        *hdt = result;
+      }
+      return ok;
+    }
+  }
+}
+
+bool HeadingHistory::Compute(size_t head, double time, double *hdt) const {
+  size_t oldest = head > HEADING_HISTORY_SIZE / 2 ? head - HEADING_HISTORY_SIZE / 2 : 0;
+  const Sample &last = m_sample[(head - 1) & HEADING_HISTORY_MASK];
+
+  if (time >= last.time) {
+    // After the last sample, continue the turn of the last samples
+    *hdt = last.hdt;
+    for (size_t i = head - 1; i > oldest; i--) {
+      const Sample &s = m_sample[(i - 1) & HEADING_HISTORY_MASK];
+      double dt = last.time - s.time;
+      if (dt > HEADING_HISTORY_MAX_GAP) {
+        break;
+      }
+      if (dt >= HEADING_HISTORY_RATE_SPAN) {
+        double rate = HeadingDelta(s.hdt, last.hdt) / dt;
+        if (fabs(rate) <= HEADING_HISTORY_MAX_RATE) {
+          *hdt += rate * MIN(time - last.time, dt);
+        }
+        break;
+      }
+    }
+    return true;
+  }
+
+  // Before the last sample, interpolate between the samples around time
+  const Sample *next = &last;
+  for (size_t i = head - 1; i > oldest; i--) {
+    const Sample &s = m_sample[(i - 1) & HEADING_HISTORY_MASK];
+    if (s.time <= time) {
+      *hdt = s.hdt + HeadingDelta(s.hdt, next->hdt) * (time - s.time) / (next->time - s.time);
+      return true;
+    }
+    next = &s;
+  }
+  *hdt = next->hdt;  // older than all samples we look at
+  return true;
+}
+
+PLUGIN_END_NAMESPACE
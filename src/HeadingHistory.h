@@ -0,0 +1,93 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef _HEADINGHISTORY_H_
+#define _HEADINGHISTORY_H_
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/*
+ * The headings that own ship had over the last seconds, each with the time it was received.
+ *
+ * The heading arrives about once per second from NMEA or OpenCPN, or once per radar frame
+ * from the radar itself, while the spokes come in at 2000 or more per second. Instead of
+ * taking the plugin lock for every spoke to read the last heading, the receive thread asks
+ * HeadingAt() for the heading at the time of the spoke. It interpolates between the samples
+ * around that time, and when the spoke is newer than the last sample it continues the turn
+ * of the last samples for at most one sample interval, so the image doesn't jump when the
+ * next sample comes in.
+ *
+ * Add() must only be called by one thread at a time (br24radar_pi holds m_exclusive).
+ * HeadingAt() takes no lock: a reader reads the head index, the entries and the head index
+ * again, and tries again when the writer may have overwritten the entries it read.
+ */
+
+#if defined(__GNUC__)
+#define HEADING_HISTORY_LOAD(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define HEADING_HISTORY_STORE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#else
+// MSVC gives volatile accesses acquire/release semantics
+#define HEADING_HISTORY_LOAD(p) (*(volatile size_t *)(p))
+#define HEADING_HISTORY_STORE(p, v) (*(volatile size_t *)(p) = (v))
+#endif
+
+#define HEADING_HISTORY_SIZE (64)  // Must be a power of 2
+#define HEADING_HISTORY_MASK (HEADING_HISTORY_SIZE - 1)
+#define HEADING_HISTORY_RATE_SPAN (250.)  // ms, compute the rate of turn over at least this time
+#define HEADING_HISTORY_MAX_GAP (3000.)   // ms, don't extrapolate from samples further apart than this
+#define HEADING_HISTORY_MAX_RATE (0.03)   // degrees per ms, faster turns are taken as a jump
+
+class HeadingHistory {
+ public:
+  HeadingHistory() { m_head = 0; }
+
+  void Add(double time, double hdt);  // time in ms as wxGetUTCTimeMillis, hdt in degrees
+
+  // Heading true at time (ms) in [0, 360), false when there is no heading
+  bool HeadingAt(double time, double *hdt) const;
+
+ private:
+  struct Sample {
+    double time;
+    double hdt;
+  };
+
+  bool Compute(size_t head, double time, double *hdt) const;
+
+  Sample m_sample[HEADING_HISTORY_SIZE];
+  size_t m_head;  // number of samples added, m_sample[(m_head - 1) & MASK] is the last
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _HEADINGHISTORY_H_ */
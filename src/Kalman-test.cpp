@@ -29,10 +29,90 @@
  ***************************************************************************
  */
 
+#include <wx/stopwatch.h>
+
 #include "Kalman.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
+#define BENCH_ROUNDS (2000000)
+#define BENCH_LANES (1000)
+
+static double NanosPer(wxStopWatch &sw, long count) { return sw.Time() * 1e6 / count; }
+
+// Compare the covariance update P = A * P * AT + W * Q * WT and the gain computation done the
+// way the Matrix code used to (a temporary for every operation, forced here with Eval), as
+// one fused expression, and for many targets in a KalmanBatch. Returns the largest difference.
+static double Benchmark(KalmanFilter *f) {
+  Matrix<double, 4> p_old;
+  Matrix<double, 4> p_new;
+  Matrix<double, 4, 2> k_old;
+  Matrix<double, 4, 2> k_new;
+  double diff = 0.;
+
+  f->H(0, 0) = -0.5;
+  f->H(0, 1) = 0.25;
+  f->H(1, 0) = 0.8;
+  f->H(1, 1) = 0.6;
+  f->HT = f->H.Transpose();
+  f->A(0, 2) = 2.5;
+  f->A(1, 3) = 2.5;
+  f->AT = f->A.Transpose();
+
+  p_old = f->P;
+  wxStopWatch sw;
+  for (int i = 0; i < BENCH_ROUNDS; i++) {
+    p_old = ((f->A * p_old).Eval() * f->AT).Eval() + ((f->W * f->Q).Eval() * f->WT).Eval();
+    p_old = p_old * 0.5;  // keep it from growing
+  }
+  double old_p_ns = NanosPer(sw, BENCH_ROUNDS);
+
+  p_new = f->P;
+  sw.Start();
+  for (int i = 0; i < BENCH_ROUNDS; i++) {
+    p_new = f->A * p_new * f->AT + f->W * f->Q * f->WT;
+    p_new = p_new * 0.5;
+  }
+  double new_p_ns = NanosPer(sw, BENCH_ROUNDS);
+
+  sw.Start();
+  for (int i = 0; i < BENCH_ROUNDS; i++) {
+    k_old = (p_old * f->HT).Eval() * ((((f->H * p_old).Eval() * f->HT).Eval() + f->R).Eval().Inverse());
+    p_old(0, 0) += 1e-9;
+  }
+  double old_k_ns = NanosPer(sw, BENCH_ROUNDS);
+
+  sw.Start();
+  for (int i = 0; i < BENCH_ROUNDS; i++) {
+    k_new = p_new * f->HT * ((f->H * p_new * f->HT + f->R).Inverse());
+    p_new(0, 0) += 1e-9;
+  }
+  double new_k_ns = NanosPer(sw, BENCH_ROUNDS);
+
+  for (int e = 0; e < 16; e++) diff = MAX(diff, fabs(p_old.flatten[e] - p_new.flatten[e]));
+  for (int e = 0; e < 8; e++) diff = MAX(diff, fabs(k_old.flatten[e] - k_new.flatten[e]));
+
+  KalmanBatch batch;
+  LocalPosition x = {0., 0., 1., 1., 0.};
+  for (int i = 0; i < BENCH_LANES; i++) {
+    batch.AddFilter();
+  }
+  int batch_rounds = BENCH_ROUNDS / BENCH_LANES * 10;
+  sw.Start();
+  for (int i = 0; i < batch_rounds; i++) {
+    for (int lane = 0; lane < BENCH_LANES; lane++) {
+      batch.Predict(lane, &x, 0.001);
+      batch.QueueUpdate_P(lane);
+    }
+    batch.Run();
+  }
+  double batch_p_ns = NanosPer(sw, (long)batch_rounds * BENCH_LANES);
+
+  cout << "INFO: Update_P     old " << old_p_ns << " ns, fused " << new_p_ns << " ns, batch " << batch_p_ns << " ns per target\n";
+  cout << "INFO: Kalman gain  old " << old_k_ns << " ns, fused " << new_k_ns << " ns\n";
+  return diff;
+}
+
 int main() {
   int ret = 0;
   KalmanFilter *filter = new KalmanFilter();
@@ -101,6 +181,64 @@ int main() {
   ASSERT_VALUE("lon", x_local.lon, 5);
   ASSERT_VALUE("stddev", x_local.sd_speed_m_s, 2.03224);
 
+  // The batched filter must come to the same result, also with other filters around it
+  KalmanBatch batch;
+  LocalPosition x_batch;
+  int lane = -1;
+
+  for (int i = 0; i < 5; i++) {
+    int l = batch.AddFilter();
+    if (i == 2) lane = l;
+  }
+
+  pol.time = 1000;
+  expected.time = 6000;
+  x_batch.lat = 50;
+  x_batch.lon = -5;
+  x_batch.dlat_dt = 5;
+  x_batch.dlon_dt = 2;
+  x_batch.sd_speed_m_s = 0.2;
+
+  batch.QueueMeasurement(lane, &pol, &x_batch, &expected, 4000);
+  batch.Run();
+  batch.GetMeasurement(lane, &x_batch);
+  batch.Predict(lane, &x_batch, (expected.time - pol.time).GetLo() / 1000.);
+
+  cout << "INFO: The batch predicted location is: lat=" << x_batch.lat << " lon=" << x_batch.lon << "\n";
+
+  ASSERT_VALUE("batch lat", x_batch.lat, x_local.lat);
+  ASSERT_VALUE("batch lon", x_batch.lon, x_local.lon);
+  ASSERT_VALUE("batch stddev", x_batch.sd_speed_m_s, x_local.sd_speed_m_s);
+
+  // A few sweeps of Update_P and measurements, against a single filter
+  for (int sweep = 0; sweep < 10; sweep++) {
+    double dt = 2.5;
+
+    filter->Predict(&x_local, dt);
+    batch.Predict(lane, &x_batch, dt);
+    filter->Update_P();
+    batch.QueueUpdate_P(lane);
+    expected.angle = 100 + sweep;
+    expected.r = 300;
+    pol.angle = expected.angle + (sweep % 3) - 1;
+    pol.r = expected.r + 1;
+    filter->SetMeasurement(&pol, &x_local, &expected, 4000);
+    batch.QueueMeasurement(lane, &pol, &x_batch, &expected, 4000);
+    batch.Run();
+    batch.GetMeasurement(lane, &x_batch);
+  }
+  ASSERT_VALUE("sweep lat", x_batch.lat, x_local.lat);
+  ASSERT_VALUE("sweep lon", x_batch.lon, x_local.lon);
+  ASSERT_VALUE("sweep dlat_dt", x_batch.dlat_dt, x_local.dlat_dt);
+  ASSERT_VALUE("sweep dlon_dt", x_batch.dlon_dt, x_local.dlon_dt);
+  ASSERT_VALUE("sweep stddev", x_batch.sd_speed_m_s, x_local.sd_speed_m_s);
+
+  double diff = Benchmark(filter);
+  if (diff > 1e-9) {
+    cout << "ERROR: Fused matrix expressions differ from the old ones by " << diff << "\n";
+    ret = 1;
+  }
+
   if (ret == 0) {
     cout << "INFO: TEST PASSED\n";
   } else {
@@ -182,4 +182,220 @@ void KalmanFilter::SetMeasurement(Polar* pol, LocalPosition* x, Polar* expected,
   return;
 }
 
+int KalmanBatch::AddFilter() {
+  int lane = (int)m_dt.size();
+
+  for (int e = 0; e < 16; e++) {
+    m_p[e].push_back(0.);
+  }
+  for (int i = 0; i < 4; i++) {
+    m_x[i].push_back(0.);
+    m_h[i].push_back(0.);
+  }
+  m_z[0].push_back(0.);
+  m_z[1].push_back(0.);
+  m_dt.push_back(0.);
+  m_update_p.push_back(0);
+  m_measure.push_back(0);
+  ResetFilter(lane);
+  return lane;
+}
+
+void KalmanBatch::ResetFilter(int lane) {
+  // same initial values as KalmanFilter::ResetFilter
+  for (int e = 0; e < 16; e++) {
+    m_p[e][lane] = 0.;
+  }
+  m_p[0 * 4 + 0][lane] = 20.;
+  m_p[2 * 4 + 2][lane] = 4.;
+  m_p[3 * 4 + 3][lane] = 4.;
+  m_dt[lane] = 0.;
+  m_update_p[lane] = 0;
+  m_measure[lane] = 0;
+}
+
+void KalmanBatch::Predict(int lane, LocalPosition* xx, double delta_time) {
+  m_dt[lane] = delta_time;
+  xx->lat += delta_time * xx->dlat_dt;
+  xx->lon += delta_time * xx->dlon_dt;
+  xx->sd_speed_m_s = sqrt((m_p[2 * 4 + 2][lane] + m_p[3 * 4 + 3][lane]) / 2.);  // rough approximation of standard dev of speed
+}
+
+void KalmanBatch::QueueUpdate_P(int lane) {
+  m_update_p[lane] = 1;
+  m_queued = true;
+}
+
+void KalmanBatch::QueueMeasurement(int lane, Polar* pol, LocalPosition* x, Polar* expected, int range) {
+  double q_sum = SQUARED(x->lon) + SQUARED(x->lat);
+  double c = 2048. / (2. * PI);
+  m_h[0][lane] = -c * x->lon / q_sum;
+  m_h[1][lane] = c * x->lat / q_sum;
+  q_sum = sqrt(q_sum);
+  m_h[2][lane] = x->lat / q_sum * 512. / (double)range;
+  m_h[3][lane] = x->lon / q_sum * 512. / (double)range;
+
+  double z = (double)(pol->angle - expected->angle);  // Z is  difference between measured and expected
+  if (z > LINES_PER_ROTATION / 2) {
+    z -= LINES_PER_ROTATION;
+  }
+  if (z < -LINES_PER_ROTATION / 2) {
+    z += LINES_PER_ROTATION;
+  }
+  m_z[0][lane] = z;
+  m_z[1][lane] = (double)(pol->r - expected->r);
+
+  m_x[0][lane] = x->lat;
+  m_x[1][lane] = x->lon;
+  m_x[2][lane] = x->dlat_dt;
+  m_x[3][lane] = x->dlon_dt;
+  m_measure[lane] = 1;
+  m_queued = true;
+}
+
+void KalmanBatch::GetMeasurement(int lane, LocalPosition* x) {
+  x->lat = m_x[0][lane];
+  x->lon = m_x[1][lane];
+  x->dlat_dt = m_x[2][lane];
+  x->dlon_dt = m_x[3][lane];
+  x->sd_speed_m_s = sqrt((m_p[2 * 4 + 2][lane] + m_p[3 * 4 + 3][lane]) / 2.);  // rough approximation of standard dev of speed
+}
+
+void KalmanBatch::Run() {
+  if (!m_queued) {
+    return;
+  }
+  // Update_P comes first, as a measurement needs the a priori P
+  RunUpdate_P();
+  RunMeasurement();
+  m_queued = false;
+}
+
+// P = A * P * AT + W * Q * WT for the queued lanes. A is the identity matrix plus the
+// delta time in (0, 2) and (1, 3), W * Q * WT only has NOISE in (2, 2) and (3, 3).
+// Every lane is computed and the result is only stored for the queued ones, so the
+// loop has no branches and the compiler can vectorise it.
+void KalmanBatch::RunUpdate_P() {
+  size_t n = Size();
+  double* p[16];
+  const double* dt = &m_dt[0];
+  const UINT8* queued = &m_update_p[0];
+
+  for (int e = 0; e < 16; e++) {
+    p[e] = &m_p[e][0];
+  }
+  for (size_t k = 0; k < n; k++) {
+    double d = dt[k];
+    bool q = queued[k] != 0;
+    double p00 = p[0][k], p01 = p[1][k], p02 = p[2][k], p03 = p[3][k];
+    double p10 = p[4][k], p11 = p[5][k], p12 = p[6][k], p13 = p[7][k];
+    double p20 = p[8][k], p21 = p[9][k], p22 = p[10][k], p23 = p[11][k];
+    double p30 = p[12][k], p31 = p[13][k], p32 = p[14][k], p33 = p[15][k];
+
+    // A * P: rows 0 and 1 get dt times rows 2 and 3
+    double a00 = p00 + d * p20, a01 = p01 + d * p21, a02 = p02 + d * p22, a03 = p03 + d * p23;
+    double a10 = p10 + d * p30, a11 = p11 + d * p31, a12 = p12 + d * p32, a13 = p13 + d * p33;
+
+    // (A * P) * AT: columns 0 and 1 get dt times columns 2 and 3
+    p[0][k] = q ? a00 + a02 * d : p00;
+    p[1][k] = q ? a01 + a03 * d : p01;
+    p[2][k] = q ? a02 : p02;
+    p[3][k] = q ? a03 : p03;
+    p[4][k] = q ? a10 + a12 * d : p10;
+    p[5][k] = q ? a11 + a13 * d : p11;
+    p[6][k] = q ? a12 : p12;
+    p[7][k] = q ? a13 : p13;
+    p[8][k] = q ? p20 + p22 * d : p20;
+    p[9][k] = q ? p21 + p23 * d : p21;
+    p[10][k] = q ? p22 + NOISE : p22;
+    p[11][k] = q ? p23 : p23;
+    p[12][k] = q ? p30 + p32 * d : p30;
+    p[13][k] = q ? p31 + p33 * d : p31;
+    p[14][k] = q ? p32 : p32;
+    p[15][k] = q ? p33 + NOISE : p33;
+  }
+  for (size_t k = 0; k < n; k++) {
+    m_update_p[k] = 0;
+  }
+}
+
+// The measurement update of KalmanFilter::SetMeasurement for the queued lanes. Only the
+// first two columns of H are non zero, which leaves out most of the multiplications.
+void KalmanBatch::RunMeasurement() {
+  size_t n = Size();
+  double* p[16];
+  double* x[4];
+  const double* h[4];
+  const double* z0 = &m_z[0][0];
+  const double* z1 = &m_z[1][0];
+  const UINT8* queued = &m_measure[0];
+
+  for (int e = 0; e < 16; e++) {
+    p[e] = &m_p[e][0];
+  }
+  for (int i = 0; i < 4; i++) {
+    x[i] = &m_x[i][0];
+    h[i] = &m_h[i][0];
+  }
+  for (size_t k = 0; k < n; k++) {
+    bool q = queued[k] != 0;
+    double h00 = h[0][k], h01 = h[1][k], h10 = h[2][k], h11 = h[3][k];
+    double p00 = p[0][k], p01 = p[1][k], p02 = p[2][k], p03 = p[3][k];
+    double p10 = p[4][k], p11 = p[5][k], p12 = p[6][k], p13 = p[7][k];
+    double p20 = p[8][k], p21 = p[9][k], p22 = p[10][k], p23 = p[11][k];
+    double p30 = p[12][k], p31 = p[13][k], p32 = p[14][k], p33 = p[15][k];
+
+    // H * P * HT + R
+    double hp00 = h00 * p00 + h01 * p10, hp01 = h00 * p01 + h01 * p11;
+    double hp10 = h10 * p00 + h11 * p10, hp11 = h10 * p01 + h11 * p11;
+    double s00 = hp00 * h00 + hp01 * h01 + 100.0;  // R, variance in the angle
+    double s01 = hp00 * h10 + hp01 * h11;
+    double s10 = hp10 * h00 + hp11 * h01;
+    double s11 = hp10 * h10 + hp11 * h11 + 25.;  // R, variance in radius
+    double det = s00 * s11 - s01 * s10;
+    double i00 = s11 / det;
+    double i11 = s00 / det;
+    double i01 = -s01 / det;
+    double i10 = -s10 / det;
+
+    // Kalman gain K = P * HT * inverse, the apostriori position and the new P = (I - K * H) * P,
+    // where K * H is zero in columns 2 and 3
+    double pht00 = p00 * h00 + p01 * h01, pht01 = p00 * h10 + p01 * h11;
+    double k00 = pht00 * i00 + pht01 * i10, k01 = pht00 * i01 + pht01 * i11;
+    double m00 = 1. - (k00 * h00 + k01 * h10), m01 = 0. - (k00 * h01 + k01 * h11);
+    x[0][k] = q ? x[0][k] + (k00 * z0[k] + k01 * z1[k]) : x[0][k];
+    double pht10 = p10 * h00 + p11 * h01, pht11 = p10 * h10 + p11 * h11;
+    double k10 = pht10 * i00 + pht11 * i10, k11 = pht10 * i01 + pht11 * i11;
+    double m10 = 0. - (k10 * h00 + k11 * h10), m11 = 1. - (k10 * h01 + k11 * h11);
+    x[1][k] = q ? x[1][k] + (k10 * z0[k] + k11 * z1[k]) : x[1][k];
+    double pht20 = p20 * h00 + p21 * h01, pht21 = p20 * h10 + p21 * h11;
+    double k20 = pht20 * i00 + pht21 * i10, k21 = pht20 * i01 + pht21 * i11;
+    double m20 = 0. - (k20 * h00 + k21 * h10), m21 = 0. - (k20 * h01 + k21 * h11);
+    x[2][k] = q ? x[2][k] + (k20 * z0[k] + k21 * z1[k]) : x[2][k];
+    double pht30 = p30 * h00 + p31 * h01, pht31 = p30 * h10 + p31 * h11;
+    double k30 = pht30 * i00 + pht31 * i10, k31 = pht30 * i01 + pht31 * i11;
+    double m30 = 0. - (k30 * h00 + k31 * h10), m31 = 0. - (k30 * h01 + k31 * h11);
+    x[3][k] = q ? x[3][k] + (k30 * z0[k] + k31 * z1[k]) : x[3][k];
+    p[0][k] = q ? m00 * p00 + m01 * p10 : p00;
+    p[1][k] = q ? m00 * p01 + m01 * p11 : p01;
+    p[2][k] = q ? m00 * p02 + m01 * p12 : p02;
+    p[3][k] = q ? m00 * p03 + m01 * p13 : p03;
+    p[4][k] = q ? m10 * p00 + m11 * p10 : p10;
+    p[5][k] = q ? m10 * p01 + m11 * p11 : p11;
+    p[6][k] = q ? m10 * p02 + m11 * p12 : p12;
+    p[7][k] = q ? m10 * p03 + m11 * p13 : p13;
+    p[8][k] = q ? m20 * p00 + m21 * p10 + p20 : p20;
+    p[9][k] = q ? m20 * p01 + m21 * p11 + p21 : p21;
+    p[10][k] = q ? m20 * p02 + m21 * p12 + p22 : p22;
+    p[11][k] = q ? m20 * p03 + m21 * p13 + p23 : p23;
+    p[12][k] = q ? m30 * p00 + m31 * p10 + p30 : p30;
+    p[13][k] = q ? m30 * p01 + m31 * p11 + p31 : p31;
+    p[14][k] = q ? m30 * p02 + m31 * p12 + p32 : p32;
+    p[15][k] = q ? m30 * p03 + m31 * p13 + p33 : p33;
+  }
+  for (size_t k = 0; k < n; k++) {
+    m_measure[k] = 0;
+  }
+}
+
 PLUGIN_END_NAMESPACE
@@ -33,6 +33,8 @@
 #ifndef _BR24KALMAN_H_
 #define _BR24KALMAN_H_
 
+#include <vector>
+
 #include "Matrix.h"
 
 PLUGIN_BEGIN_NAMESPACE
@@ -85,5 +87,41 @@ class KalmanFilter {
   Matrix<double, 4> I;
 };
 
+/*
+ * The Kalman filters of all targets of a radar, with their state in a structure of arrays:
+ * element (i, j) of the covariance of filter `lane` is m_p[i * 4 + j][lane].
+ *
+ * Predict runs right away, as the target search needs its result. The covariance update and
+ * the measurement are queued, and Run() does them for all filters at once in fixed size
+ * loops over the lanes that the compiler can vectorise. The results are the same as those
+ * of KalmanFilter.
+ */
+class KalmanBatch {
+ public:
+  KalmanBatch() { m_queued = false; }
+
+  int AddFilter();  // returns the lane of a new filter
+  size_t Size() const { return m_dt.size(); }
+  void ResetFilter(int lane);
+  void Predict(int lane, LocalPosition* x, double delta_time);
+  void QueueUpdate_P(int lane);
+  void QueueMeasurement(int lane, Polar* p, LocalPosition* x, Polar* expected, int range);
+  void Run();
+  void GetMeasurement(int lane, LocalPosition* x);  // position after the measurement done by Run()
+
+ private:
+  vector<double> m_p[16];     // estimate error covariance P
+  vector<double> m_dt;        // delta time of the last Predict, the A matrix
+  vector<UINT8> m_update_p;   // Update_P is queued
+  vector<UINT8> m_measure;    // a measurement is queued
+  vector<double> m_x[4];      // lat, lon, dlat_dt, dlon_dt for the measurement, then its result
+  vector<double> m_z[2];      // measured minus expected angle and r
+  vector<double> m_h[4];      // non zero part of the observation matrix: H(0, 0), H(0, 1), H(1, 0), H(1, 1)
+  bool m_queued;
+
+  void RunUpdate_P();
+  void RunMeasurement();
+};
+
 PLUGIN_END_NAMESPACE
 #endif
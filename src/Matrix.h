@@ -26,15 +26,28 @@
 #ifndef _MATRIX_H_
 #define _MATRIX_H_
 
+#include <cassert>
 #include <cstdlib>
 #include <iostream>
 #include "pi_common.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
+// Bounds checking of every element access is costly in the Kalman filter, so it is only
+// done when MATRIX_BOUNDS_CHECK is defined.
+#ifdef MATRIX_BOUNDS_CHECK
+#define MATRIX_ASSERT(x) assert(x)
+#else
+#define MATRIX_ASSERT(x)
+#endif
+
+template <typename Ty, int N, int M, typename E>
+struct MatrixExpr;
+
 template <typename Ty, int N, int M = N>
 struct Matrix {
   typedef Ty value_type;
+  enum { ROWS = N, COLS = M };
 
   union {
     struct {
@@ -47,17 +60,31 @@ struct Matrix {
 
   // Access with bounds checking
   Ty& operator()(const int r, const int c) {
-    assert(r >= 0 && r < N);
-    assert(c >= 0 && c < M);
+    MATRIX_ASSERT(r >= 0 && r < N);
+    MATRIX_ASSERT(c >= 0 && c < M);
     return element[r][c];
   }
 
   const Ty operator()(const int r, const int c) const {
-    assert(r >= 0 && r < N);
-    assert(c >= 0 && c < M);
+    MATRIX_ASSERT(r >= 0 && r < N);
+    MATRIX_ASSERT(c >= 0 && c < M);
     return element[r][c];
   }
 
+  // Evaluate an expression such as A * P * AT + W * Q * WT in one loop. The result goes
+  // to a local first, as the expression may refer to this matrix (P = A * P * AT).
+  template <typename E>
+  Matrix& operator=(const MatrixExpr<Ty, N, M, E>& expr) {
+    Matrix<Ty, N, M> result;
+    for (int r = 0; r < N; ++r) {
+      for (int c = 0; c < M; ++c) {
+        result.element[r][c] = expr.e(r, c);
+      }
+    }
+    *this = result;
+    return *this;
+  }
+
   // Return matrix transpose
   Matrix<Ty, M, N> Transpose() const {
     Matrix<Ty, M, N> result;
@@ -128,25 +155,210 @@ Matrix<Ty, N, M> Matrix<Ty, N, M>::Inverse() {
 }
 
 ///
-//  Matrix operations
+//  Lazy matrix expressions
 ///
-// Matrix product
-template <typename Ty, int N, int M, int P>
-Matrix<Ty, N, P> operator*(const Matrix<Ty, N, M>& a, const Matrix<Ty, M, P>& b) {
-  Matrix<Ty, N, P> result;
-
-  for (int r = 0; r < N; ++r) {
-    for (int c = 0; c < P; ++c) {
-      Ty accum = Ty(0);
-      for (int i = 0; i < M; ++i) {
-        accum += a.element[r][i] * b.element[i][c];
+// The sum, difference and product of matrices don't compute anything; they return a
+// MatrixExpr that knows how to compute a single element. Only assigning it to a Matrix
+// (or calling Eval) runs the loop, so a chain of operations needs no temporary matrices.
+// The leaves keep references to the matrices, so an expression must be used in the
+// statement that creates it.
+namespace detail {
+
+template <typename Ty, int N, int M>
+struct leaf {
+  const Matrix<Ty, N, M>& m;
+  leaf(const Matrix<Ty, N, M>& matrix) : m(matrix) {}
+  Ty operator()(int r, int c) const { return m.element[r][c]; }
+};
+
+// Row r of a times column c of b, over an inner size of K. The sizes used by the Kalman
+// filter (2 and 4) are written out.
+template <typename Ty, int K>
+struct dot {
+  template <typename A, typename B>
+  static Ty sum(const A& a, const B& b, int r, int c) {
+    Ty accum = Ty(0);
+    for (int i = 0; i < K; ++i) {
+      accum += a(r, i) * b(i, c);
+    }
+    return accum;
+  }
+};
+
+template <typename Ty>
+struct dot<Ty, 1> {
+  template <typename A, typename B>
+  static Ty sum(const A& a, const B& b, int r, int c) {
+    return a(r, 0) * b(0, c);
+  }
+};
+
+template <typename Ty>
+struct dot<Ty, 2> {
+  template <typename A, typename B>
+  static Ty sum(const A& a, const B& b, int r, int c) {
+    return a(r, 0) * b(0, c) + a(r, 1) * b(1, c);
+  }
+};
+
+template <typename Ty>
+struct dot<Ty, 4> {
+  template <typename A, typename B>
+  static Ty sum(const A& a, const B& b, int r, int c) {
+    return a(r, 0) * b(0, c) + a(r, 1) * b(1, c) + a(r, 2) * b(2, c) + a(r, 3) * b(3, c);
+  }
+};
+
+// A subexpression, referenced like a leaf references its matrix. The nodes of the statement are
+// temporaries that live until its end, so nothing needs to be copied.
+template <typename Ty, typename E>
+struct branch {
+  const E& e;
+  branch(const E& expr) : e(expr) {}
+  Ty operator()(int r, int c) const { return e(r, c); }
+};
+
+// An expression that is evaluated once, in place, into a local matrix. Used for the operands of
+// a product that are expressions themselves: a lazy product reads every element of its operands
+// K times, so in A * P * AT the product A * P would otherwise be computed again for each element
+// of the result.
+template <typename Ty, int N, int M>
+struct evaluated {
+  Matrix<Ty, N, M> m;
+  template <typename E>
+  evaluated(const MatrixExpr<Ty, N, M, E>& expr) {
+    for (int r = 0; r < N; ++r) {
+      for (int c = 0; c < M; ++c) {
+        m.element[r][c] = expr.e(r, c);
       }
-      result.element[r][c] = accum;
     }
   }
-  return result;
+  Ty operator()(int r, int c) const { return m.element[r][c]; }
+};
+
+template <typename Ty, int K, typename A, typename B>
+struct product {
+  A a;
+  B b;
+  template <typename L, typename R>
+  product(const L& left, const R& right) : a(left), b(right) {}
+  Ty operator()(int r, int c) const { return dot<Ty, K>::sum(a, b, r, c); }
+};
+
+template <typename Ty, typename A, typename B>
+struct sum {
+  A a;
+  B b;
+  sum(const A& left, const B& right) : a(left), b(right) {}
+  Ty operator()(int r, int c) const { return a(r, c) + b(r, c); }
+};
+
+template <typename Ty, typename A, typename B>
+struct difference {
+  A a;
+  B b;
+  difference(const A& left, const B& right) : a(left), b(right) {}
+  Ty operator()(int r, int c) const { return a(r, c) - b(r, c); }
+};
+
+// What a Matrix or a MatrixExpr looks like inside an expression
+template <typename T>
+struct operand;
+
+template <typename Ty, int N, int M>
+struct operand<Matrix<Ty, N, M> > {
+  typedef Ty value_type;
+  typedef leaf<Ty, N, M> node;
+  enum { ROWS = N, COLS = M };
+  static node get(const Matrix<Ty, N, M>& m) { return node(m); }
+};
+
+template <typename Ty, int N, int M, typename E>
+struct operand<MatrixExpr<Ty, N, M, E> > {
+  typedef Ty value_type;
+  typedef branch<Ty, E> node;
+  enum { ROWS = N, COLS = M };
+  static node get(const MatrixExpr<Ty, N, M, E>& x) { return node(x.e); }
+};
+
+// What a Matrix or a MatrixExpr looks like as the operand of a product. The node is built
+// by the product itself, so an evaluated operand is written straight into the product.
+template <typename T>
+struct factor;
+
+template <typename Ty, int N, int M>
+struct factor<Matrix<Ty, N, M> > {
+  typedef Ty value_type;
+  typedef leaf<Ty, N, M> node;
+  enum { ROWS = N, COLS = M };
+};
+
+template <typename Ty, int N, int M, typename E>
+struct factor<MatrixExpr<Ty, N, M, E> > {
+  typedef Ty value_type;
+  typedef evaluated<Ty, N, M> node;
+  enum { ROWS = N, COLS = M };
+};
+
+}  // detail
+
+template <typename Ty, int N, int M, typename E>
+struct MatrixExpr {
+  E e;
+  MatrixExpr(const E& expr) : e(expr) {}
+  template <typename A, typename B>
+  MatrixExpr(const A& a, const B& b) : e(a, b) {}
+
+  Ty operator()(const int r, const int c) const { return e(r, c); }
+
+  Matrix<Ty, N, M> Eval() const {
+    Matrix<Ty, N, M> result;
+    result = *this;
+    return result;
+  }
+  operator Matrix<Ty, N, M>() const { return Eval(); }
+
+  Matrix<Ty, M, N> Transpose() const { return Eval().Transpose(); }
+  Matrix<Ty, N, M> Inverse() const { return Eval().Inverse(); }
+};
+
+///
+//  Matrix operations
+///
+// Matrix product
+template <typename A, typename B>
+MatrixExpr<typename detail::factor<A>::value_type, detail::factor<A>::ROWS, detail::factor<B>::COLS,
+           detail::product<typename detail::factor<A>::value_type, detail::factor<A>::COLS, typename detail::factor<A>::node,
+                           typename detail::factor<B>::node> >
+operator*(const A& a, const B& b) {
+  typedef detail::factor<A> left;
+  typedef detail::factor<B> right;
+  typedef detail::product<typename left::value_type, left::COLS, typename left::node, typename right::node> node;
+  typedef char inner_sizes_must_match[(int)left::COLS == (int)right::ROWS ? 1 : -1];
+  (void)sizeof(inner_sizes_must_match);
+
+  return MatrixExpr<typename left::value_type, left::ROWS, right::COLS, node>(a, b);
 }
 
+#define MATRIX_WITH_MATRIX_OPERATOR(op_symbol, op_node)                                                                          \
+  template <typename A, typename B>                                                                                              \
+  MatrixExpr<typename detail::operand<A>::value_type, detail::operand<A>::ROWS, detail::operand<A>::COLS,                      \
+             detail::op_node<typename detail::operand<A>::value_type, typename detail::operand<A>::node,                       \
+                             typename detail::operand<B>::node> >                                                              \
+  operator op_symbol(const A& a, const B& b) {                                                                                   \
+    typedef detail::operand<A> left;                                                                                             \
+    typedef detail::operand<B> right;                                                                                            \
+    typedef detail::op_node<typename left::value_type, typename left::node, typename right::node> node;                         \
+    typedef char sizes_must_match[(int)left::ROWS == (int)right::ROWS && (int)left::COLS == (int)right::COLS ? 1 : -1];         \
+    (void)sizeof(sizes_must_match);                                                                                              \
+                                                                                                                                 \
+    return MatrixExpr<typename left::value_type, left::ROWS, left::COLS, node>(node(left::get(a), right::get(b)));              \
+  }
+
+MATRIX_WITH_MATRIX_OPERATOR(+, sum);
+MATRIX_WITH_MATRIX_OPERATOR(-, difference);
+#undef MATRIX_WITH_MATRIX_OPERATOR
+
 // Unary negation
 template <typename Ty, int N, int M>
 Matrix<Ty, N, M> operator-(const Matrix<Ty, N, M>& a) {
@@ -155,18 +367,6 @@ Matrix<Ty, N, M> operator-(const Matrix<Ty, N, M>& a) {
   return result;
 }
 
-#define MATRIX_WITH_MATRIX_OPERATOR(op_symbol, op)                                            \
-  template <typename Ty, int N, int M>                                                        \
-  Matrix<Ty, N, M> operator op_symbol(const Matrix<Ty, N, M>& a, const Matrix<Ty, N, M>& b) { \
-    Matrix<Ty, N, M> result;                                                                  \
-    for (int e = 0; e < N * M; ++e) result.flatten[e] = a.flatten[e] op b.flatten[e];         \
-    return result;                                                                            \
-  }
-
-MATRIX_WITH_MATRIX_OPERATOR(+, +);
-MATRIX_WITH_MATRIX_OPERATOR(-, -);
-#undef MATRIX_WITH_MATRIX_OPERATOR
-
 #define MATRIX_WITH_SCALAR_OPERATOR(op_symbol, op)                              \
   template <typename Ty, int N, int M>                                          \
   Matrix<Ty, N, M> operator op_symbol(const Matrix<Ty, N, M>& a, Ty scalar) {   \
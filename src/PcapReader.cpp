@@ -0,0 +1,417 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include "PcapReader.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define PCAP_MAGIC_US (0xa1b2c3d4)
+#define PCAP_MAGIC_NS (0xa1b23c4d)
+#define PCAPNG_SECTION_HEADER (0x0a0d0d0a)
+#define PCAPNG_BYTE_ORDER_MAGIC (0x1a2b3c4d)
+#define PCAPNG_INTERFACE_DESCRIPTION (1)
+#define PCAPNG_SIMPLE_PACKET (3)
+#define PCAPNG_ENHANCED_PACKET (6)
+#define PCAPNG_OPTION_TSRESOL (9)
+
+#define LINKTYPE_NULL (0)
+#define LINKTYPE_ETHERNET (1)
+#define LINKTYPE_RAW (101)
+#define LINKTYPE_LINUX_SLL (113)
+#define LINKTYPE_IPV4 (228)
+
+#define ETHERTYPE_IPV4 (0x0800)
+#define ETHERTYPE_VLAN (0x8100)
+#define IPPROTO_UDP_ (17)
+
+#define PAD32(x) (((x) + 3) & ~3)
+
+PcapReader::PcapReader() {
+  m_file = 0;
+  m_record = (UINT8 *)malloc(PCAP_MAX_RECORD);
+  m_fragments = (Fragments *)malloc(PCAP_REASSEMBLY_SLOTS * sizeof(Fragments));
+  Close();
+}
+
+PcapReader::~PcapReader() {
+  Close();
+  free(m_record);
+  free(m_fragments);
+}
+
+bool PcapReader::Open(const char *filename) {
+  Close();
+  if (!m_record || !m_fragments) {
+    return false;
+  }
+  // gzopen() reads uncompressed files transparently
+  m_file = gzopen(filename, "rb");
+  if (!m_file) {
+    return false;
+  }
+  if (!ReadFileHeader()) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void PcapReader::Close() {
+  if (m_file) {
+    gzclose(m_file);
+    m_file = 0;
+  }
+  m_ng = false;
+  m_swapped = false;
+  m_interfaces = 0;
+  m_last_time_us = 0;
+  m_next_slot = 0;
+  if (m_fragments) {
+    for (int i = 0; i < PCAP_REASSEMBLY_SLOTS; i++) {
+      m_fragments[i].in_use = false;
+    }
+  }
+}
+
+bool PcapReader::Read(void *buf, size_t len) { return gzread(m_file, buf, (unsigned)len) == (int)len; }
+
+bool PcapReader::Skip(size_t len) { return len == 0 || gzseek(m_file, (z_off_t)len, SEEK_CUR) >= 0; }
+
+uint16_t PcapReader::Get16(const UINT8 *p) { return m_swapped ? (p[0] << 8) | p[1] : p[0] | (p[1] << 8); }
+
+uint32_t PcapReader::Get32(const UINT8 *p) {
+  return m_swapped ? ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]
+                   : p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool PcapReader::ReadFileHeader() {
+  UINT8 hdr[24];
+
+  if (!Read(hdr, 12)) {
+    return false;
+  }
+
+  m_swapped = false;
+  uint32_t magic = Get32(hdr);
+
+  if (magic == PCAPNG_SECTION_HEADER) {
+    // The block length can only be interpreted once we know the byte order
+    m_ng = true;
+    m_swapped = Get32(hdr + 8) != PCAPNG_BYTE_ORDER_MAGIC;
+    if (Get32(hdr + 8) != PCAPNG_BYTE_ORDER_MAGIC) {
+      return false;
+    }
+    uint32_t block_len = Get32(hdr + 4);
+    return block_len >= 12 && Skip(block_len - 12);
+  }
+
+  if (!Read(hdr + 12, sizeof(hdr) - 12)) {
+    return false;
+  }
+  if (magic != PCAP_MAGIC_US && magic != PCAP_MAGIC_NS) {
+    m_swapped = true;
+    magic = Get32(hdr);
+    if (magic != PCAP_MAGIC_US && magic != PCAP_MAGIC_NS) {
+      return false;
+    }
+  }
+  m_ng = false;
+  m_interfaces = 1;
+  m_link_type[0] = (int)Get32(hdr + 20);
+  m_ticks_per_second[0] = (magic == PCAP_MAGIC_NS) ? 1000000000 : 1000000;
+  return true;
+}
+
+// Read one classic pcap record into m_record
+bool PcapReader::ReadRecord(int64_t *time_us, int *link_type, int *len) {
+  UINT8 hdr[16];
+
+  if (!Read(hdr, sizeof(hdr))) {
+    return false;
+  }
+  uint32_t captured = Get32(hdr + 8);
+  if (captured > PCAP_MAX_RECORD) {
+    return false;
+  }
+  if (!Read(m_record, captured)) {
+    return false;
+  }
+  *time_us = (int64_t)Get32(hdr) * 1000000 + (int64_t)Get32(hdr + 4) * 1000000 / m_ticks_per_second[0];
+  *link_type = m_link_type[0];
+  *len = (int)captured;
+  return true;
+}
+
+bool PcapReader::ReadInterface(const UINT8 *body, size_t len) {
+  if (len < 8 || m_interfaces >= PCAP_MAX_INTERFACES) {
+    return true;  // Ignore, packets on this interface will be skipped
+  }
+  int i = m_interfaces++;
+  m_link_type[i] = Get16(body);
+  m_ticks_per_second[i] = 1000000;
+
+  size_t off = 8;
+  while (off + 4 <= len) {
+    uint16_t code = Get16(body + off);
+    uint16_t option_len = Get16(body + off + 2);
+    if (code == 0) {
+      break;
+    }
+    if (code == PCAPNG_OPTION_TSRESOL && option_len == 1 && off + 5 <= len) {
+      UINT8 v = body[off + 4];
+      int64_t ticks = 1;
+      for (int n = 0; n < (v & 0x7f) && ticks < INT64_C(1000000000000); n++) {
+        ticks *= (v & 0x80) ? 2 : 10;
+      }
+      m_ticks_per_second[i] = ticks;
+    }
+    off += 4 + PAD32(option_len);
+  }
+  return true;
+}
+
+// Read pcapng blocks until we find one that contains a packet, and leave the packet in m_record
+bool PcapReader::ReadBlock(int64_t *time_us, int *link_type, int *len) {
+  UINT8 hdr[8];
+
+  while (Read(hdr, sizeof(hdr))) {
+    uint32_t type = Get32(hdr);
+    uint32_t block_len = Get32(hdr + 4);
+
+    if (type == PCAPNG_SECTION_HEADER) {
+      // A new section may switch byte order and always resets the interfaces
+      UINT8 bom[4];
+      if (!Read(bom, sizeof(bom))) {
+        return false;
+      }
+      m_swapped = false;
+      if (Get32(bom) != PCAPNG_BYTE_ORDER_MAGIC) {
+        m_swapped = true;
+        if (Get32(bom) != PCAPNG_BYTE_ORDER_MAGIC) {
+          return false;
+        }
+      }
+      block_len = Get32(hdr + 4);
+      m_interfaces = 0;
+      if (block_len < 12 || !Skip(block_len - 12)) {
+        return false;
+      }
+      continue;
+    }
+
+    if (block_len < 12 || block_len - 8 > PCAP_MAX_RECORD) {
+      return false;
+    }
+    size_t body_len = block_len - 12;  // Without the header and the trailing copy of the length
+    if (!Read(m_record, block_len - 8)) {
+      return false;
+    }
+
+    if (type == PCAPNG_INTERFACE_DESCRIPTION) {
+      ReadInterface(m_record, body_len);
+    } else if (type == PCAPNG_ENHANCED_PACKET && body_len >= 20) {
+      uint32_t interface = Get32(m_record);
+      uint32_t captured = Get32(m_record + 12);
+      if (interface < (uint32_t)m_interfaces && captured <= body_len - 20) {
+        int64_t ticks = ((int64_t)Get32(m_record + 4) << 32) | Get32(m_record + 8);
+        int64_t tps = m_ticks_per_second[interface];
+        m_last_time_us = ticks / tps * 1000000 + ticks % tps * 1000000 / tps;
+        memmove(m_record, m_record + 20, captured);
+        *time_us = m_last_time_us;
+        *link_type = m_link_type[interface];
+        *len = (int)captured;
+        return true;
+      }
+    } else if (type == PCAPNG_SIMPLE_PACKET && body_len >= 4 && m_interfaces > 0) {
+      // No timestamp in a simple packet block, the best we can do is reuse the last one.
+      uint32_t captured = MIN(Get32(m_record), (uint32_t)body_len - 4);
+      memmove(m_record, m_record + 4, captured);
+      *time_us = m_last_time_us;
+      *link_type = m_link_type[0];
+      *len = (int)captured;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool PcapReader::NextUDP(PcapPacket *packet) {
+  int64_t time_us;
+  int link_type;
+  int len;
+
+  if (!m_file) {
+    return false;
+  }
+  while (m_ng ? ReadBlock(&time_us, &link_type, &len) : ReadRecord(&time_us, &link_type, &len)) {
+    if (DecodeFrame(link_type, m_record, len, time_us, packet)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool PcapReader::DecodeFrame(int link_type, const UINT8 *frame, int len, int64_t time_us, PcapPacket *packet) {
+  int ethertype;
+
+  switch (link_type) {
+    case LINKTYPE_ETHERNET:
+      if (len < 14) {
+        return false;
+      }
+      ethertype = (frame[12] << 8) | frame[13];
+      frame += 14;
+      len -= 14;
+      if (ethertype == ETHERTYPE_VLAN && len >= 4) {
+        ethertype = (frame[2] << 8) | frame[3];
+        frame += 4;
+        len -= 4;
+      }
+      if (ethertype != ETHERTYPE_IPV4) {
+        return false;
+      }
+      break;
+
+    case LINKTYPE_LINUX_SLL:
+      if (len < 16 || ((frame[14] << 8) | frame[15]) != ETHERTYPE_IPV4) {
+        return false;
+      }
+      frame += 16;
+      len -= 16;
+      break;
+
+    case LINKTYPE_NULL:
+      // Family is in the byte order of the capturing host, AF_INET is 2 everywhere
+      if (len < 4 || (frame[0] != 2 && frame[3] != 2)) {
+        return false;
+      }
+      frame += 4;
+      len -= 4;
+      break;
+
+    case LINKTYPE_RAW:
+    case LINKTYPE_IPV4:
+      break;
+
+    default:
+      return false;
+  }
+  return DecodeIPv4(frame, len, time_us, packet);
+}
+
+bool PcapReader::DecodeIPv4(const UINT8 *ip, int len, int64_t time_us, PcapPacket *packet) {
+  if (len < 20 || (ip[0] >> 4) != 4 || ip[9] != IPPROTO_UDP_) {
+    return false;
+  }
+  int header_len = (ip[0] & 0x0f) * 4;
+  int total_len = (ip[2] << 8) | ip[3];
+  if (header_len < 20 || total_len < header_len) {
+    return false;
+  }
+  len = MIN(len, total_len);  // Strip Ethernet padding
+  if (len <= header_len) {
+    return false;
+  }
+
+  uint32_t src_addr;
+  uint32_t dst_addr;
+  memcpy(&src_addr, ip + 12, sizeof(src_addr));
+  memcpy(&dst_addr, ip + 16, sizeof(dst_addr));
+
+  int flags = (ip[6] << 8) | ip[7];
+  bool more_fragments = (flags & 0x2000) != 0;
+  int offset = (flags & 0x1fff) * 8;
+  const UINT8 *payload = ip + header_len;
+  int payload_len = len - header_len;
+
+  if (!more_fragments && offset == 0) {
+    return DecodeUDP(src_addr, dst_addr, payload, payload_len, time_us, packet);
+  }
+
+  // A fragment. Find the datagram it belongs to, or start a new one in the oldest slot.
+  uint16_t id = (uint16_t)((ip[4] << 8) | ip[5]);
+  Fragments *f = 0;
+  for (int i = 0; i < PCAP_REASSEMBLY_SLOTS; i++) {
+    Fragments *s = &m_fragments[i];
+    if (s->in_use && s->id == id && s->src_addr == src_addr && s->dst_addr == dst_addr) {
+      f = s;
+      break;
+    }
+  }
+  if (!f) {
+    f = &m_fragments[m_next_slot];
+    m_next_slot = (m_next_slot + 1) % PCAP_REASSEMBLY_SLOTS;
+    f->in_use = true;
+    f->id = id;
+    f->src_addr = src_addr;
+    f->dst_addr = dst_addr;
+    f->received = 0;
+    f->total = -1;
+  }
+
+  if (offset + payload_len > PCAP_MAX_DATAGRAM) {
+    f->in_use = false;
+    return false;
+  }
+  memcpy(f->data + offset, payload, payload_len);
+  f->received += payload_len;
+  if (!more_fragments) {
+    f->total = offset + payload_len;
+  }
+  if (f->total < 0 || f->received < f->total) {
+    return false;
+  }
+
+  f->in_use = false;  // The data stays valid until the slot is reused, which is after the next call
+  return DecodeUDP(src_addr, dst_addr, f->data, f->total, time_us, packet);
+}
+
+bool PcapReader::DecodeUDP(uint32_t src_addr, uint32_t dst_addr, const UINT8 *udp, int len, int64_t time_us,
+                           PcapPacket *packet) {
+  if (len < 8) {
+    return false;
+  }
+  int udp_len = (udp[4] << 8) | udp[5];
+  if (udp_len < 8 || udp_len > len) {
+    return false;
+  }
+  packet->time_us = time_us;
+  packet->src_addr = src_addr;
+  packet->dst_addr = dst_addr;
+  packet->src_port = (uint16_t)((udp[0] << 8) | udp[1]);
+  packet->dst_port = (uint16_t)((udp[2] << 8) | udp[3]);
+  packet->data = udp + 8;
+  packet->len = udp_len - 8;
+  return true;
+}
+
+PLUGIN_END_NAMESPACE
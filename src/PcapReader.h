@@ -0,0 +1,119 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _PCAPREADER_H_
+#define _PCAPREADER_H_
+
+#include <zlib.h>
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/*
+ * Reads the UDP datagrams out of a network capture as written by tcpdump or Wireshark,
+ * so the radar data in the example directory can be fed into the plugin without a radar.
+ *
+ * Both the classic pcap and the newer pcapng file formats are understood, optionally
+ * gzip compressed. Only IPv4 over Ethernet (or Linux cooked capture) is decoded. The
+ * radar frames are larger than the MTU so they arrive as IP fragments; these are put
+ * back together before the datagram is returned.
+ */
+
+#define PCAP_MAX_DATAGRAM (65536)
+#define PCAP_MAX_RECORD (262144 + 64)  // Largest snap length used by tcpdump, plus pcapng block overhead
+#define PCAP_REASSEMBLY_SLOTS (4)
+#define PCAP_MAX_INTERFACES (8)
+
+struct PcapPacket {
+  int64_t time_us;    // Capture time in microseconds since the epoch
+  uint32_t src_addr;  // IPv4 addresses in network order
+  uint32_t dst_addr;
+  uint16_t src_port;  // UDP ports in host order
+  uint16_t dst_port;
+  const UINT8 *data;  // UDP payload, valid until the next call to NextUDP()
+  int len;
+};
+
+class PcapReader {
+ public:
+  PcapReader();
+  ~PcapReader();
+
+  bool Open(const char *filename);
+  void Close();
+  bool IsOpen() { return m_file != 0; }
+
+  // Return the next complete UDP datagram, or false at the end of the file.
+  bool NextUDP(PcapPacket *packet);
+
+ private:
+  struct Fragments {
+    bool in_use;
+    uint32_t src_addr;
+    uint32_t dst_addr;
+    uint16_t id;
+    int received;  // # of payload bytes received so far
+    int total;     // Payload length, known once the last fragment has arrived, else -1
+    UINT8 data[PCAP_MAX_DATAGRAM];
+  };
+
+  bool Read(void *buf, size_t len);
+  bool Skip(size_t len);
+  uint16_t Get16(const UINT8 *p);
+  uint32_t Get32(const UINT8 *p);
+
+  bool ReadFileHeader();
+  bool ReadRecord(int64_t *time_us, int *link_type, int *len);
+  bool ReadBlock(int64_t *time_us, int *link_type, int *len);
+  bool ReadInterface(const UINT8 *body, size_t len);
+
+  bool DecodeFrame(int link_type, const UINT8 *frame, int len, int64_t time_us, PcapPacket *packet);
+  bool DecodeIPv4(const UINT8 *ip, int len, int64_t time_us, PcapPacket *packet);
+  bool DecodeUDP(uint32_t src_addr, uint32_t dst_addr, const UINT8 *udp, int len, int64_t time_us, PcapPacket *packet);
+
+  gzFile m_file;
+  bool m_ng;       // pcapng instead of classic pcap
+  bool m_swapped;  // File was written on a machine with the other byte order
+
+  int m_interfaces;                                 // # of interfaces seen, always 1 for classic pcap
+  int m_link_type[PCAP_MAX_INTERFACES];             // Link type per interface
+  int64_t m_ticks_per_second[PCAP_MAX_INTERFACES];  // Timestamp resolution per interface
+  int64_t m_last_time_us;
+
+  UINT8 *m_record;         // Current captured frame or pcapng block, PCAP_MAX_RECORD bytes
+  Fragments *m_fragments;  // PCAP_REASSEMBLY_SLOTS partially received datagrams
+  int m_next_slot;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _PCAPREADER_H_ */
@@ -0,0 +1,166 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include "PolarGrid.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+static int RangeCell(int r) {
+  if (r < 0) {
+    return 0;
+  }
+  if (r >= RETURNS_PER_LINE) {
+    return POLAR_GRID_RANGES - 1;
+  }
+  return r / POLAR_GRID_RANGE_STEP;
+}
+
+void PolarGrid::Clear() {
+  for (size_t i = 0; i < ARRAY_SIZE(m_cells); i++) {
+    m_cells[i].clear();
+  }
+  m_cell_of.clear();
+  m_slot_of.clear();
+  m_size = 0;
+}
+
+void PolarGrid::Set(int key, int angle, int r) {
+  angle &= LINES_PER_ROTATION - 1;
+  int cell = RangeCell(r) * POLAR_GRID_ANGLES + angle / POLAR_GRID_ANGLE_STEP;
+  double a = angle * 2. * PI / LINES_PER_ROTATION;
+  Entry e;
+
+  e.key = key;
+  e.x = (float)(r * sin(a));
+  e.y = (float)(r * cos(a));
+
+  if (key >= (int)m_cell_of.size()) {
+    m_cell_of.resize(key + 1, -1);
+    m_slot_of.resize(key + 1, -1);
+  }
+  if (m_cell_of[key] == cell) {
+    m_cells[cell][m_slot_of[key]] = e;
+    return;
+  }
+  Remove(key);
+  m_cell_of[key] = cell;
+  m_slot_of[key] = (int)m_cells[cell].size();
+  m_cells[cell].push_back(e);
+  m_size++;
+}
+
+void PolarGrid::Remove(int key) {
+  if (!Contains(key)) {
+    return;
+  }
+  vector<Entry> &cell = m_cells[m_cell_of[key]];
+  int slot = m_slot_of[key];
+
+  // move the last entry of the cell into the hole
+  cell[slot] = cell.back();
+  m_slot_of[cell[slot].key] = slot;
+  cell.pop_back();
+  m_cell_of[key] = -1;
+  m_slot_of[key] = -1;
+  m_size--;
+}
+
+int PolarGrid::Search(float x, float y, int angle, int r, int dist, int skip, bool first, float *best_d2) {
+  int r1 = RangeCell(r - dist);
+  int r2 = RangeCell(r + dist);
+  int a1 = 0;
+  int a2 = POLAR_GRID_ANGLES - 1;
+  float max_d2 = (float)dist * dist;
+  int best = -1;
+
+  // The points within dist are within asin(dist / r) of the angle, unless the origin is too
+  if (r > dist) {
+    int spokes = (int)ceil(asin((double)dist / r) * LINES_PER_ROTATION / (2. * PI)) + 1;
+    if (2 * spokes + POLAR_GRID_ANGLE_STEP < LINES_PER_ROTATION) {
+      a1 = (angle - spokes + LINES_PER_ROTATION) / POLAR_GRID_ANGLE_STEP;
+      a2 = (angle + spokes + LINES_PER_ROTATION) / POLAR_GRID_ANGLE_STEP;
+    }
+  }
+
+  *best_d2 = max_d2;
+  for (int rc = r1; rc <= r2; rc++) {
+    for (int ac = a1; ac <= a2; ac++) {
+      const vector<Entry> &cell = m_cells[rc * POLAR_GRID_ANGLES + ac % POLAR_GRID_ANGLES];
+      for (size_t i = 0; i < cell.size(); i++) {
+        if (cell[i].key == skip) {
+          continue;
+        }
+        float dx = cell[i].x - x;
+        float dy = cell[i].y - y;
+        float d2 = dx * dx + dy * dy;
+        if (d2 <= *best_d2) {
+          *best_d2 = d2;
+          best = cell[i].key;
+          if (first) {
+            return best;
+          }
+        }
+      }
+    }
+  }
+  return best;
+}
+
+int PolarGrid::Nearest(int angle, int r, int skip) {
+  angle &= LINES_PER_ROTATION - 1;
+  double a = angle * 2. * PI / LINES_PER_ROTATION;
+  float x = (float)(r * sin(a));
+  float y = (float)(r * cos(a));
+  float d2;
+
+  if (m_size == 0) {
+    return -1;
+  }
+  // Every point within dist is in the cells that are searched, so the closest point found
+  // is the closest there is. Widen the search until something is found.
+  for (int dist = POLAR_GRID_RANGE_STEP;; dist *= 2) {
+    int key = Search(x, y, angle, r, dist, skip, false, &d2);
+    if (key >= 0 || dist > 2 * RETURNS_PER_LINE + r) {
+      return key;
+    }
+  }
+}
+
+int PolarGrid::FindWithin(int angle, int r, int dist) {
+  angle &= LINES_PER_ROTATION - 1;
+  double a = angle * 2. * PI / LINES_PER_ROTATION;
+  float d2;
+
+  return Search((float)(r * sin(a)), (float)(r * cos(a)), angle, r, dist, -1, true, &d2);
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,95 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _POLARGRID_H_
+#define _POLARGRID_H_
+
+#include <vector>
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/*
+ * An index of points in the radar image, so ARPA can find the targets near a position
+ * without looking at all of them.
+ *
+ * The image is divided in cells of POLAR_GRID_ANGLE_STEP spokes by POLAR_GRID_RANGE_STEP
+ * returns. A point is stored under a small integer key, in ARPA the Kalman lane of the
+ * target, which stays the same for as long as the target exists. Set moves a point to its
+ * new cell, so keeping the index up to date costs O(1) per target. Distances are measured
+ * in returns, along a straight line.
+ */
+
+#define POLAR_GRID_ANGLE_STEP (32)  // spokes per cell
+#define POLAR_GRID_RANGE_STEP (32)  // returns per cell
+#define POLAR_GRID_ANGLES (LINES_PER_ROTATION / POLAR_GRID_ANGLE_STEP)
+#define POLAR_GRID_RANGES (RETURNS_PER_LINE / POLAR_GRID_RANGE_STEP)
+
+class PolarGrid {
+ public:
+  PolarGrid() { m_size = 0; }
+
+  void Clear();
+
+  // Store key at angle 0 .. LINES_PER_ROTATION - 1 and radius r, or move it there.
+  // A radius beyond the image is stored in the outer cells.
+  void Set(int key, int angle, int r);
+  void Remove(int key);
+  bool Contains(int key) const { return key >= 0 && key < (int)m_cell_of.size() && m_cell_of[key] >= 0; }
+  size_t Size() const { return m_size; }
+
+  // The key of the point closest to angle, r, other than skip, or -1 when there is none.
+  int Nearest(int angle, int r, int skip = -1);
+
+  // The key of a point no further than dist from angle, r, or -1 when there is none.
+  int FindWithin(int angle, int r, int dist);
+
+ private:
+  struct Entry {
+    int key;
+    float x;  // in returns, to the east
+    float y;  // in returns, to the north
+  };
+
+  // Finds the closest point no further than dist, also sets best_d2 to its squared distance
+  int Search(float x, float y, int angle, int r, int dist, int skip, bool first, float *best_d2);
+
+  vector<Entry> m_cells[POLAR_GRID_ANGLES * POLAR_GRID_RANGES];
+  vector<int> m_cell_of;  // per key, -1 if not in the grid
+  vector<int> m_slot_of;  // per key, its index in m_cells[m_cell_of[key]]
+  size_t m_size;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif
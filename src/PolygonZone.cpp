@@ -0,0 +1,334 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#include <algorithm>
+
+#include "PolygonZone.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define METERS_PER_DEGREE (60. * 1852.)
+
+// strtod would follow the locale, which may use a decimal comma
+static bool ParseDegrees(const char **text, double *value) {
+  const char *p = *text;
+  double sign = 1.;
+  double v = 0.;
+  bool digits = false;
+
+  while (*p == ' ') {
+    p++;
+  }
+  if (*p == '-' || *p == '+') {
+    sign = (*p == '-') ? -1. : 1.;
+    p++;
+  }
+  for (; *p >= '0' && *p <= '9'; p++) {
+    v = v * 10. + (*p - '0');
+    digits = true;
+  }
+  if (*p == '.') {
+    double scale = 0.1;
+    for (p++; *p >= '0' && *p <= '9'; p++) {
+      v += (*p - '0') * scale;
+      scale *= 0.1;
+      digits = true;
+    }
+  }
+  while (*p == ' ') {
+    p++;
+  }
+  *text = p;
+  *value = sign * v;
+  return digits;
+}
+
+bool ParsePolygonPoints(const char *text, vector<PolygonPoint> *points) {
+  points->clear();
+  while (*text) {
+    PolygonPoint point;
+    if (!ParseDegrees(&text, &point.lat) || *text++ != ',' || !ParseDegrees(&text, &point.lon)) {
+      return false;
+    }
+    if (fabs(point.lat) > 90. || fabs(point.lon) > 180.) {
+      return false;
+    }
+    points->push_back(point);
+    if (*text == ';') {
+      text++;
+    } else if (*text) {
+      return false;
+    }
+  }
+  return points->size() >= 3;
+}
+
+static void FormatDegrees(double value, string *text) {
+  char buf[32];
+
+  snprintf(buf, sizeof(buf), "%.6f", value);
+  for (char *p = buf; *p; p++) {
+    if (*p == ',') {
+      *p = '.';
+    }
+  }
+  *text += buf;
+}
+
+string FormatPolygonPoints(const vector<PolygonPoint> &points) {
+  string text;
+
+  for (size_t i = 0; i < points.size(); i++) {
+    if (i) {
+      text += ';';
+    }
+    FormatDegrees(points[i].lat, &text);
+    text += ',';
+    FormatDegrees(points[i].lon, &text);
+  }
+  return text;
+}
+
+PolygonZones::PolygonZones() {
+  m_spoke_generation.resize(LINES_PER_ROTATION);
+  m_alarm_mask.resize(LINES_PER_ROTATION * STRONG_WORDS);
+  m_arpa_mask.resize(LINES_PER_ROTATION * STRONG_WORDS);
+  m_alarm_zones_at.resize(LINES_PER_ROTATION);
+  Clear();
+}
+
+void PolygonZones::Clear() {
+  m_zones.clear();
+  m_alarm_zones = 0;
+  m_arpa_zones = 0;
+  m_first.assign(1, 0);
+  m_x.clear();
+  m_y.clear();
+  m_mask.clear();
+  m_running_count.clear();
+  m_bogey_count.clear();
+  m_range_meters = 0;  // no origin, ProcessSpoke sets one
+  m_generation = 0;
+  m_last_bearing = 0;
+  fill(m_spoke_generation.begin(), m_spoke_generation.end(), 0);
+  fill(m_alarm_mask.begin(), m_alarm_mask.end(), 0);
+  fill(m_arpa_mask.begin(), m_arpa_mask.end(), 0);
+  fill(m_alarm_zones_at.begin(), m_alarm_zones_at.end(), 0);
+}
+
+bool PolygonZones::Add(const PolygonZone &zone) {
+  if (m_zones.size() >= POLYGON_ZONES || zone.points.size() < 3) {
+    return false;
+  }
+  m_zones.push_back(zone);
+  m_alarm_zones += zone.alarm_on;
+  m_arpa_zones += zone.arpa_on;
+  m_first.push_back(m_first.back() + zone.points.size());
+  m_x.resize(m_first.back());
+  m_y.resize(m_first.back());
+  m_mask.resize(m_zones.size() * LINES_PER_ROTATION * STRONG_WORDS);
+  m_running_count.push_back(0);
+  m_bogey_count.push_back(-1);
+  m_range_meters = 0;  // make all masks again
+  return true;
+}
+
+void PolygonZones::ResetBogeys() {
+  fill(m_running_count.begin(), m_running_count.end(), 0);
+  fill(m_bogey_count.begin(), m_bogey_count.end(), -1);
+}
+
+// Start a new generation of masks, for this range and position
+void PolygonZones::SetOrigin(int range_meters, double lat, double lon) {
+  m_range_meters = range_meters;
+  m_lat = lat;
+  m_lon = lon;
+  m_meters_per_lon = METERS_PER_DEGREE * cos(deg2rad(lat));
+
+  for (size_t z = 0; z < m_zones.size(); z++) {
+    const vector<PolygonPoint> &points = m_zones[z].points;
+    for (size_t i = 0; i < points.size(); i++) {
+      double dlon = points[i].lon - lon;
+      if (dlon > 180.) {
+        dlon -= 360.;
+      } else if (dlon < -180.) {
+        dlon += 360.;
+      }
+      m_x[m_first[z] + i] = dlon * m_meters_per_lon;
+      m_y[m_first[z] + i] = (points[i].lat - lat) * METERS_PER_DEGREE;
+    }
+  }
+  m_generation++;
+}
+
+static inline size_t LowestBit(uint64_t v) {
+#if defined(__GNUC__)
+  return (size_t)__builtin_ctzll(v);
+#else
+  return CountBits((v & (0 - v)) - 1);
+#endif
+}
+
+static void SetBits(uint64_t *mask, size_t start, size_t end) {
+  for (size_t r = start; r < end;) {
+    size_t w = r / 64;
+    size_t bits = MIN(end - r, 64 - r % 64);
+    uint64_t m = (bits == 64) ? ~(uint64_t)0 : (((uint64_t)1 << bits) - 1) << (r % 64);
+    mask[w] |= m;
+    r += bits;
+  }
+}
+
+// Make the masks of one spoke: follow the spoke outwards from own ship, and count where it
+// crosses the edges of each polygon.
+void PolygonZones::RasteriseSpoke(int bearing) {
+  double angle = deg2rad(bearing * 360. / LINES_PER_ROTATION);
+  double dx = sin(angle);
+  double dy = cos(angle);
+  double meters_per_return = (double)m_range_meters / RETURNS_PER_LINE;
+  uint64_t *alarm = &m_alarm_mask[bearing * STRONG_WORDS];
+  uint64_t *arpa = &m_arpa_mask[bearing * STRONG_WORDS];
+  uint64_t alarm_new[STRONG_WORDS] = {0};
+  uint64_t arpa_new[STRONG_WORDS] = {0};
+  uint64_t alarm_zones = 0;
+
+  for (size_t z = 0; z < m_zones.size(); z++) {
+    uint64_t mask[STRONG_WORDS] = {0};
+    size_t first = m_first[z];
+    size_t n = m_first[z + 1] - first;
+
+    m_crossings.clear();
+    for (size_t i = 0; i < n; i++) {
+      double px = m_x[first + i];
+      double py = m_y[first + i];
+      double qx = m_x[first + (i + 1) % n];
+      double qy = m_y[first + (i + 1) % n];
+
+      // Only edges with their ends on different sides of the line through the spoke, a corner
+      // on the line counts for the edge that leaves it on the left
+      bool p_left = dx * py - dy * px > 0.;
+      bool q_left = dx * qy - dy * qx > 0.;
+      if (p_left == q_left) {
+        continue;
+      }
+      double ex = qx - px;
+      double ey = qy - py;
+      double t = (px * ey - py * ex) / (dx * ey - dy * ex);  // distance along the spoke
+      if (t > 0.) {
+        m_crossings.push_back(t / meters_per_return);
+      }
+    }
+
+    // Own ship is inside when the spoke leaves the polygon once more than it enters it
+    sort(m_crossings.begin(), m_crossings.end());
+    bool inside = (m_crossings.size() & 1) != 0;
+    double from = 0.;
+    for (size_t i = 0; i < m_crossings.size(); i++) {
+      if (inside) {
+        size_t start = (size_t)MIN(ceil(from), (double)RETURNS_PER_LINE);
+        size_t end = (size_t)MIN(ceil(m_crossings[i]), (double)RETURNS_PER_LINE);
+        SetBits(mask, start, end);
+      }
+      inside = !inside;
+      from = m_crossings[i];
+    }
+
+    memcpy(Mask(z, bearing), mask, sizeof(mask));
+    for (size_t w = 0; w < STRONG_WORDS; w++) {
+      if (m_zones[z].alarm_on) {
+        alarm_new[w] |= mask[w];
+        if (mask[w]) {
+          alarm_zones |= (uint64_t)1 << z;
+        }
+      }
+      if (m_zones[z].arpa_on) {
+        arpa_new[w] |= mask[w];
+      }
+    }
+  }
+  m_alarm_zones_at[bearing] = alarm_zones;
+  memcpy(alarm, alarm_new, sizeof(alarm_new));
+  memcpy(arpa, arpa_new, sizeof(arpa_new));
+  m_spoke_generation[bearing] = m_generation;
+}
+
+void PolygonZones::ProcessSpoke(int bearing, const uint64_t *strong, int range_meters, double lat, double lon) {
+  if (m_zones.empty() || range_meters <= 0 || !(fabs(lat) <= 90.) || !(fabs(lon) <= 180.)) {
+    return;
+  }
+
+  if (range_meters != m_range_meters) {
+    SetOrigin(range_meters, lat, lon);
+  } else {
+    double meters_per_return = (double)range_meters / RETURNS_PER_LINE;
+    double north = (lat - m_lat) * METERS_PER_DEGREE;
+    double east = (lon - m_lon) * m_meters_per_lon;
+    if (north * north + east * east > meters_per_return * meters_per_return) {
+      SetOrigin(range_meters, lat, lon);
+    }
+  }
+  if (m_spoke_generation[bearing] != m_generation) {
+    RasteriseSpoke(bearing);
+  }
+
+  if (!m_alarm_zones) {
+    return;
+  }
+  if (bearing < m_last_bearing) {
+    // A rotation is complete
+    for (size_t z = 0; z < m_zones.size(); z++) {
+      m_bogey_count[z] = m_running_count[z];
+      m_running_count[z] = 0;
+    }
+  }
+  m_last_bearing = bearing;
+
+  // Most spokes don't have strong returns in any zone
+  const uint64_t *alarm = &m_alarm_mask[bearing * STRONG_WORDS];
+  uint64_t any = 0;
+  for (size_t w = 0; w < STRONG_WORDS; w++) {
+    any |= strong[w] & alarm[w];
+  }
+  if (!any) {
+    return;
+  }
+  for (uint64_t zones = m_alarm_zones_at[bearing]; zones; zones &= zones - 1) {
+    size_t z = LowestBit(zones);
+    const uint64_t *mask = Mask(z, bearing);
+    size_t n = 0;
+    for (size_t w = 0; w < STRONG_WORDS; w++) {
+      n += CountBits(strong[w] & mask[w]);
+    }
+    m_running_count[z] += n;
+  }
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,139 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef _POLYGONZONE_H_
+#define _POLYGONZONE_H_
+
+#include <string>
+#include <vector>
+
+#include "SpokeKernels.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/*
+ * Guard zones of any shape, defined by their corners in lat/lon, for instance the edges of a
+ * channel or a berth. They are set in the configuration, there is no dialog for them.
+ *
+ * Each zone is rasterised into a polar bit mask of LINES_PER_ROTATION spokes by RETURNS_PER_LINE
+ * returns, relative to the position of own ship. The mask follows the bearing of the spoke, not
+ * the heading, so turning the ship does not change it. When the range changes or own ship has
+ * moved more than one return since the masks were made, every spoke of the mask is made again
+ * when the beam passes it, so the work is spread over a rotation.
+ *
+ * Counting the bogeys of a spoke is an AND of its strong returns with the mask of the zone and
+ * a popcount. ARPA tests the centroid of a new blob in the union of the zones that have ARPA on.
+ *
+ * The zones are only changed when the configuration is loaded. ProcessSpoke is called by the
+ * spoke process thread, InArpaZone by the ARPA thread.
+ */
+
+#define POLYGON_ZONES (64)  // maximum number of polygon zones per radar, one bit each in m_alarm_zones_at
+
+struct PolygonPoint {
+  double lat;
+  double lon;
+};
+
+struct PolygonZone {
+  vector<PolygonPoint> points;
+  bool alarm_on;
+  bool arpa_on;
+};
+
+// Corners as "lat,lon;lat,lon;...", in degrees with a decimal point whatever the locale
+extern bool ParsePolygonPoints(const char *text, vector<PolygonPoint> *points);
+extern string FormatPolygonPoints(const vector<PolygonPoint> &points);
+
+class PolygonZones {
+ public:
+  PolygonZones();
+
+  void Clear();
+  // False when there are POLYGON_ZONES zones already or the polygon has less than 3 corners
+  bool Add(const PolygonZone &zone);
+  size_t Size() const { return m_zones.size(); }
+  const PolygonZone &Zone(size_t z) const { return m_zones[z]; }
+  bool AnyAlarm() const { return m_alarm_zones > 0; }
+  bool AnyArpa() const { return m_arpa_zones > 0; }
+
+  // strong is the line packed by the StrongKernel, only needed when AnyAlarm().
+  // lat, lon is the position of the radar when the spoke was received.
+  void ProcessSpoke(int bearing, const uint64_t *strong, int range_meters, double lat, double lon);
+
+  // Whether return r of the spoke at bearing is inside a zone with ARPA on
+  bool InArpaZone(int bearing, int r) const {
+    if (m_arpa_zones == 0 || r < 0 || r >= RETURNS_PER_LINE) {
+      return false;
+    }
+    return (m_arpa_mask[bearing * STRONG_WORDS + r / 64] >> (r % 64)) & 1;
+  }
+
+  // The number of strong returns in the zone during the last rotation, -1 if not known yet
+  int GetBogeyCount(size_t z) const { return m_bogey_count[z]; }
+  void ResetBogeys();
+
+ private:
+  void SetOrigin(int range_meters, double lat, double lon);
+  void RasteriseSpoke(int bearing);
+  uint64_t *Mask(size_t z, int bearing) { return &m_mask[(z * LINES_PER_ROTATION + bearing) * STRONG_WORDS]; }
+
+  vector<PolygonZone> m_zones;
+  size_t m_alarm_zones;
+  size_t m_arpa_zones;
+
+  // The corners of all zones in meters east (x) and north (y) of the origin, zone z has
+  // corners m_first[z] .. m_first[z + 1] - 1
+  vector<double> m_x;
+  vector<double> m_y;
+  vector<size_t> m_first;
+  vector<double> m_crossings;  // scratch space for RasteriseSpoke
+
+  vector<uint64_t> m_mask;        // zone, bearing, STRONG_WORDS words
+  vector<uint64_t> m_alarm_mask;  // bearing, STRONG_WORDS words: the zones with alarm on together
+  vector<uint64_t> m_arpa_mask;   // bearing, STRONG_WORDS words: the zones with ARPA on together
+  vector<uint64_t> m_alarm_zones_at;        // per bearing, bit z is set if zone z has alarm on and covers a return
+  vector<unsigned int> m_spoke_generation;  // per bearing, the m_generation its masks were made for
+  unsigned int m_generation;
+
+  int m_range_meters;  // origin and range of the current generation
+  double m_lat;
+  double m_lon;
+  double m_meters_per_lon;
+
+  vector<int> m_running_count;  // current rotation
+  vector<int> m_bogey_count;    // last complete rotation
+  int m_last_bearing;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _POLYGONZONE_H_ */
@@ -32,6 +32,7 @@
 #include "RadarDraw.h"
 #include "RadarDrawShader.h"
 #include "RadarDrawVertex.h"
+#include "RadarDrawVertexBuffer.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
@@ -41,7 +42,11 @@ RadarDraw* RadarDraw::make_Draw(RadarInfo* ri, int draw_method) {
     case 0:
       return new RadarDrawVertex(ri);
     case 1:
-      return new RadarDrawShader(ri);
+      return new RadarDrawShader(ri, false);
+    case 2:
+      return new RadarDrawVertexBuffer(ri);
+    case 3:
+      return new RadarDrawShader(ri, true);
     default:
       wxLogError(wxT("BR24radar_pi: unsupported draw method %d"), draw_method);
   }
@@ -51,7 +56,7 @@ RadarDraw* RadarDraw::make_Draw(RadarInfo* ri, int draw_method) {
 RadarDraw::~RadarDraw() {}
 
 void RadarDraw::GetDrawingMethods(wxArrayString& methods) {
-  wxString m[] = {_("Vertex Array"), _("Shader")};
+  wxString m[] = {_("Vertex Array"), _("Shader"), _("Vertex Buffer"), _("Shader (palette)")};
 
   methods = wxArrayString(ARRAY_SIZE(m), m);
 }
@@ -29,6 +29,8 @@
  ***************************************************************************
  */
 
+#define M_SETTINGS m_ri->m_pi->m_settings
+
 #include "RadarDrawShader.h"
 #include "drawutil.h"
 #include "shaderutil.h"
@@ -69,17 +71,31 @@ static const char *FragmentShaderColorText =
     "   gl_FragColor = texture2D(tex2d, vec2(d, a)); \n"
     "} \n";
 
-bool RadarDrawShader::Init() {
-  m_format = GL_RGBA;
-  m_channels = SHADER_COLOR_CHANNELS;
+// Same, but the texture holds a BlobColour that is looked up in the palette texture.
+// The index is rounded to the center of its palette texel so no neighbour colour bleeds in.
+static const char *FragmentShaderPaletteText =
+    "uniform sampler2D tex2d; \n"
+    "uniform sampler1D palette; \n"
+    "uniform float alpha; \n"
+    "void main() \n"
+    "{ \n"
+    "   float d = length(gl_TexCoord[0].xy);\n"
+    "   if (d >= 1.0) \n"
+    "      discard; \n"
+    "   float a = atan(gl_TexCoord[0].y, gl_TexCoord[0].x) / 6.28318; \n"
+    "   float index = texture2D(tex2d, vec2(d, a)).x; \n"
+    "   vec4 c = texture1D(palette, (floor(index * 255.0 + 0.5) + 0.5) / 256.0); \n"
+    "   gl_FragColor = vec4(c.rgb, c.a * alpha); \n"
+    "} \n";
 
+bool RadarDrawShader::Init() {
   if (!CompileShader && !ShadersSupported()) {
     wxLogError(wxT("BR24radar_pi: the OpenGL system of this computer does not support shader m_programs"));
     return false;
   }
 
   if (!CompileShaderText(&m_vertex, GL_VERTEX_SHADER, VertexShaderText) ||
-      !CompileShaderText(&m_fragment, GL_FRAGMENT_SHADER, FragmentShaderColorText)) {
+      !CompileShaderText(&m_fragment, GL_FRAGMENT_SHADER, m_palette ? FragmentShaderPaletteText : FragmentShaderColorText)) {
     wxLogError(wxT("BR24radar_pi: the OpenGL system of this computer failed to compile shader programs"));
     return false;
   }
@@ -104,8 +120,40 @@ bool RadarDrawShader::Init() {
                /* format          = */ m_format,
                /* type            = */ GL_UNSIGNED_BYTE,
                /* data            = */ m_data);
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  // Interpolating between two colour indices gives a meaningless colour, so the palette texture must not be filtered.
+  GLint filter = m_palette ? GL_NEAREST : GL_LINEAR;
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+
+  if (m_palette) {
+    if (!m_palette_texture) {
+      glGenTextures(1, &m_palette_texture);
+    }
+    glBindTexture(GL_TEXTURE_1D, m_palette_texture);
+    glTexImage1D(/* target          = */ GL_TEXTURE_1D,
+                 /* level           = */ 0,
+                 /* internal_format = */ GL_RGBA,
+                 /* width           = */ ARRAY_SIZE(m_ri->m_colour_palette),
+                 /* border          = */ 0,
+                 /* format          = */ GL_RGBA,
+                 /* type            = */ GL_UNSIGNED_BYTE,
+                 /* data            = */ m_ri->m_colour_palette);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    m_palette_version = m_ri->m_colour_palette_version;
+
+    UseProgram(m_program);
+    Uniform1i(GetUniformLocation(m_program, "tex2d"), 0);
+    Uniform1i(GetUniformLocation(m_program, "palette"), 1);
+    UseProgram(0);
+  }
+
+  if (!m_pbo[0] && PixelBuffersSupported()) {
+    GenBuffers(2, m_pbo);
+  }
+  LOG_VERBOSE(wxT("BR24radar_pi: %s shader uploads texture %s"), m_ri->m_name.c_str(),
+              m_pbo[0] ? wxT("through pixel buffer objects") : wxT("directly"));
 
   m_start_line = -1;
   m_lines = 0;
@@ -132,11 +180,20 @@ RadarDrawShader::~RadarDrawShader() {
     glDeleteTextures(1, &m_texture);
     m_texture = 0;
   }
+  if (m_palette_texture) {
+    glDeleteTextures(1, &m_palette_texture);
+    m_palette_texture = 0;
+  }
+  if (m_pbo[0]) {
+    DeleteBuffers(2, m_pbo);
+    m_pbo[0] = 0;
+    m_pbo[1] = 0;
+  }
+  free(m_data);
+  m_data = 0;
 }
 
 void RadarDrawShader::DrawRadarImage() {
-  wxCriticalSectionLocker lock(m_exclusive);
-
   if (!m_program || !m_texture) {
     return;
   }
@@ -145,49 +202,33 @@ void RadarDrawShader::DrawRadarImage() {
 
   UseProgram(m_program);
 
-  glBindTexture(GL_TEXTURE_2D, m_texture);
-
-  if (m_start_line > -1) {
-    // Since the last time we have received data from [m_start_line, m_end_line>
-    // so we only need to update the texture for those data lines.
-    if (m_start_line + m_lines > LINES_PER_ROTATION) {
-      int end_line = MOD_ROTATION2048(m_start_line + m_lines);
-      // if the new data partly wraps past the end of the texture
-      // tell it the two parts separately
-      // First remap [0, m_end_line>
-      glTexSubImage2D(/* target =   */ GL_TEXTURE_2D,
-                      /* level =    */ 0,
-                      /* x-offset = */ 0,
-                      /* y-offset = */ 0,
-                      /* width =    */ RETURNS_PER_LINE,
-                      /* height =   */ end_line,
-                      /* format =   */ m_format,
-                      /* type =     */ GL_UNSIGNED_BYTE,
-                      /* pixels =   */ m_data);
-      // And then remap [m_start_line, LINES_PER_ROTATION>
-      glTexSubImage2D(/* target =   */ GL_TEXTURE_2D,
+  if (m_palette) {
+    // Colour and trail setting changes only cost a new palette, not a new image.
+    ActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_1D, m_palette_texture);
+    if (m_palette_version != m_ri->m_colour_palette_version) {
+      m_palette_version = m_ri->m_colour_palette_version;
+      glTexSubImage1D(/* target =   */ GL_TEXTURE_1D,
                       /* level =    */ 0,
                       /* x-offset = */ 0,
-                      /* y-offset = */ m_start_line,
-                      /* width =    */ RETURNS_PER_LINE,
-                      /* height =   */ LINES_PER_ROTATION - m_start_line,
-                      /* format =   */ m_format,
+                      /* width =    */ ARRAY_SIZE(m_ri->m_colour_palette),
+                      /* format =   */ GL_RGBA,
                       /* type =     */ GL_UNSIGNED_BYTE,
-                      /* pixels =   */ m_data + m_start_line * RETURNS_PER_LINE * m_channels);
-    } else {
-      // Map [m_start_line, m_end_line>
-      glTexSubImage2D(/* target =   */ GL_TEXTURE_2D,
-                      /* level =    */ 0,
-                      /* x-offset = */ 0,
-                      /* y-offset = */ m_start_line,
-                      /* width =    */ RETURNS_PER_LINE,
-                      /* height =   */ m_lines,
-                      /* format =   */ m_format,
-                      /* type =     */ GL_UNSIGNED_BYTE,
-                      /* pixels =   */ m_data + m_start_line * RETURNS_PER_LINE * m_channels);
+                      /* pixels =   */ m_ri->m_colour_palette);
     }
-    m_start_line = -1;
-    m_lines = 0;
+    ActiveTexture(GL_TEXTURE0);
+
+    // m_alpha is a single byte, so reading it without the lock can at worst give the previous value.
+    GLfloat alpha = m_alpha / 255.0f;
+    Uniform1fv(GetUniformLocation(m_program, "alpha"), 1, &alpha);
+  }
+
+  glBindTexture(GL_TEXTURE_2D, m_texture);
+
+  if (m_pbo[0]) {
+    UploadThroughPixelBuffer();
+  } else {
+    UploadDirect();
   }
 
   // We tell the GPU to draw a square from (-512,-512) to (+512,+512).
@@ -208,6 +249,126 @@ void RadarDrawShader::DrawRadarImage() {
   glPopAttrib();
 }
 
+// Copy lines [start_line, start_line + lines> of the image at pixels, which may be an offset
+// into the bound GL_PIXEL_UNPACK_BUFFER, into the bound texture.
+void RadarDrawShader::UploadLines(int start_line, int lines, const unsigned char *pixels) {
+  if (start_line + lines > LINES_PER_ROTATION) {
+    int end_line = MOD_ROTATION2048(start_line + lines);
+    // if the new data partly wraps past the end of the texture
+    // tell it the two parts separately
+    // First remap [0, end_line>
+    glTexSubImage2D(/* target =   */ GL_TEXTURE_2D,
+                    /* level =    */ 0,
+                    /* x-offset = */ 0,
+                    /* y-offset = */ 0,
+                    /* width =    */ RETURNS_PER_LINE,
+                    /* height =   */ end_line,
+                    /* format =   */ m_format,
+                    /* type =     */ GL_UNSIGNED_BYTE,
+                    /* pixels =   */ pixels);
+    // And then remap [start_line, LINES_PER_ROTATION>
+    glTexSubImage2D(/* target =   */ GL_TEXTURE_2D,
+                    /* level =    */ 0,
+                    /* x-offset = */ 0,
+                    /* y-offset = */ start_line,
+                    /* width =    */ RETURNS_PER_LINE,
+                    /* height =   */ LINES_PER_ROTATION - start_line,
+                    /* format =   */ m_format,
+                    /* type =     */ GL_UNSIGNED_BYTE,
+                    /* pixels =   */ pixels + start_line * RETURNS_PER_LINE * m_channels);
+  } else {
+    // Map [start_line, end_line>
+    glTexSubImage2D(/* target =   */ GL_TEXTURE_2D,
+                    /* level =    */ 0,
+                    /* x-offset = */ 0,
+                    /* y-offset = */ start_line,
+                    /* width =    */ RETURNS_PER_LINE,
+                    /* height =   */ lines,
+                    /* format =   */ m_format,
+                    /* type =     */ GL_UNSIGNED_BYTE,
+                    /* pixels =   */ pixels + start_line * RETURNS_PER_LINE * m_channels);
+  }
+}
+
+// Upload straight from m_data. The lock is held for the whole driver copy, so the receive
+// thread waits in ProcessRadarSpoke until it is done.
+void RadarDrawShader::UploadDirect() {
+  wxStopWatch stopwatch;
+  wxCriticalSectionLocker lock(m_exclusive);
+
+  if (m_start_line > -1) {
+    // Since the last time we have received data from [m_start_line, m_start_line + m_lines>
+    // so we only need to update the texture for those data lines.
+    UploadLines(m_start_line, m_lines, m_data);
+    m_start_line = -1;
+    m_lines = 0;
+  }
+  CountLockTime(stopwatch.TimeInMicro());
+}
+
+// Upload through a pixel buffer object. Under the lock the changed lines are only copied
+// into the mapped buffer; the texture upload then runs from the buffer without the lock, and
+// the driver can do the transfer asynchronously. The two buffers are used in turn, and each
+// is orphaned before it is mapped, so mapping never waits for the upload of the previous frame.
+void RadarDrawShader::UploadThroughPixelBuffer() {
+  if (m_start_line == -1) {
+    // Nothing to do. A spoke that arrives just after this check is uploaded on the next frame.
+    return;
+  }
+
+  size_t size = m_channels * LINES_PER_ROTATION * RETURNS_PER_LINE;
+
+  m_pbo_index = 1 - m_pbo_index;
+  BindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo[m_pbo_index]);
+  BufferData(GL_PIXEL_UNPACK_BUFFER, size, 0, GL_STREAM_DRAW);
+  unsigned char *buffer = (unsigned char *)MapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+  if (!buffer) {
+    BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    UploadDirect();
+    return;
+  }
+
+  int start_line;
+  int lines;
+  {
+    wxStopWatch stopwatch;
+    wxCriticalSectionLocker lock(m_exclusive);
+
+    start_line = m_start_line;
+    lines = m_lines;
+    if (start_line > -1) {
+      size_t line_size = m_channels * RETURNS_PER_LINE;
+      int first = MIN(lines, LINES_PER_ROTATION - start_line);
+
+      memcpy(buffer + start_line * line_size, m_data + start_line * line_size, first * line_size);
+      memcpy(buffer, m_data, (lines - first) * line_size);
+      m_start_line = -1;
+      m_lines = 0;
+    }
+    CountLockTime(stopwatch.TimeInMicro());
+  }
+
+  if (UnmapBuffer(GL_PIXEL_UNPACK_BUFFER) && start_line > -1) {
+    UploadLines(start_line, lines, 0);  // pixels is an offset into the buffer
+  }
+  BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void RadarDrawShader::CountLockTime(wxLongLong us) {
+  m_lock_total_us += us;
+  if (us > m_lock_max_us) {
+    m_lock_max_us = us;
+  }
+  if (++m_lock_frames == LOCK_LOG_FRAMES) {
+    LOG_VERBOSE(wxT("BR24radar_pi: %s shader %s upload held lock %.1f us average, %ld us max over %d frames"),
+                m_ri->m_name.c_str(), m_pbo[0] ? wxT("PBO") : wxT("direct"), m_lock_total_us.ToDouble() / m_lock_frames,
+                m_lock_max_us.ToLong(), m_lock_frames);
+    m_lock_frames = 0;
+    m_lock_total_us = 0;
+    m_lock_max_us = 0;
+  }
+}
+
 void RadarDrawShader::ProcessRadarSpoke(int transparency, SpokeBearing angle, UINT8 *data, size_t len) {
   GLubyte alpha = 255 * (MAX_OVERLAY_TRANSPARENCY - transparency) / MAX_OVERLAY_TRANSPARENCY;
   wxCriticalSectionLocker lock(m_exclusive);
@@ -233,10 +394,9 @@ void RadarDrawShader::ProcessRadarSpoke(int transparency, SpokeBearing angle, UI
   } else {
     unsigned char *d = m_data + (angle * RETURNS_PER_LINE);
     for (size_t r = 0; r < len; r++) {
-      GLubyte strength = data[r];
-      BlobColour colour = m_ri->m_colour_map[strength];
-      *d++ = (m_ri->m_colour_map_rgb[colour].Red() * alpha) >> 8;
+      *d++ = m_ri->m_colour_map[data[r]];
     }
+    m_alpha = alpha;
   }
 }
 
@@ -37,20 +37,33 @@
 PLUGIN_BEGIN_NAMESPACE
 
 #define SHADER_COLOR_CHANNELS (4)  // RGB + Alpha
+#define SHADER_PALETTE_CHANNELS (1)  // BlobColour, looked up in RadarInfo::m_colour_palette by the shader
 
 class RadarDrawShader : public RadarDraw {
  public:
-  RadarDrawShader(RadarInfo* ri) {
+  // In palette mode the texture holds the BlobColour of each return instead of its RGBA
+  // colour, so it is a quarter of the size and colour changes don't need a new image.
+  RadarDrawShader(RadarInfo* ri, bool palette) {
     m_ri = ri;
     m_start_line = -1;  // No spokes received since last draw
     m_lines = 0;
     m_texture = 0;
+    m_palette_texture = 0;
+    m_palette_version = -1;
+    m_alpha = 255;
     m_fragment = 0;
     m_vertex = 0;
     m_program = 0;
-    m_format = GL_RGBA;
-    m_channels = SHADER_COLOR_CHANNELS;
-    CLEAR_STRUCT(m_data);
+    m_palette = palette;
+    m_format = palette ? GL_LUMINANCE : GL_RGBA;
+    m_channels = palette ? SHADER_PALETTE_CHANNELS : SHADER_COLOR_CHANNELS;
+    m_data = (unsigned char*)calloc(m_channels, LINES_PER_ROTATION * RETURNS_PER_LINE);
+    m_pbo[0] = 0;
+    m_pbo[1] = 0;
+    m_pbo_index = 0;
+    m_lock_frames = 0;
+    m_lock_total_us = 0;
+    m_lock_max_us = 0;
   }
 
   ~RadarDrawShader();
@@ -62,18 +75,38 @@ class RadarDrawShader : public RadarDraw {
  private:
   RadarInfo* m_ri;
 
-  wxCriticalSection m_exclusive;  // protects the following three data structures
-  unsigned char m_data[SHADER_COLOR_CHANNELS * LINES_PER_ROTATION * RETURNS_PER_LINE];
-  int m_start_line;  // First line received since last draw, or -1
-  int m_lines;       // # of lines received since last draw
+  wxCriticalSection m_exclusive;  // protects the following four data structures
+  unsigned char* m_data;          // m_channels * LINES_PER_ROTATION * RETURNS_PER_LINE bytes
+  int m_start_line;               // First line received since last draw, or -1
+  int m_lines;                    // # of lines received since last draw
+  GLubyte m_alpha;                // Alpha of the last spoke, applied by the shader in palette mode
 
+  bool m_palette;
   int m_format;
   int m_channels;
 
   GLuint m_texture;
+  GLuint m_palette_texture;
+  int m_palette_version;  // Value of RadarInfo::m_colour_palette_version that was uploaded
   GLuint m_fragment;
   GLuint m_vertex;
   GLuint m_program;
+
+  // Two pixel buffer objects used in turn to stream the changed lines to the texture,
+  // or zero when the OpenGL system doesn't support them.
+  GLuint m_pbo[2];
+  int m_pbo_index;
+
+  // How long DrawRadarImage holds m_exclusive, logged every LOCK_LOG_FRAMES frames
+  static const int LOCK_LOG_FRAMES = 500;
+  int m_lock_frames;
+  wxLongLong m_lock_total_us;
+  wxLongLong m_lock_max_us;
+
+  void UploadLines(int start_line, int lines, const unsigned char* pixels);
+  void UploadDirect();
+  void UploadThroughPixelBuffer();
+  void CountLockTime(wxLongLong us);
 };
 
 PLUGIN_END_NAMESPACE
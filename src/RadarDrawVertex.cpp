@@ -35,15 +35,15 @@ PLUGIN_BEGIN_NAMESPACE
 
 bool RadarDrawVertex::Init() { return true; }
 
-#define ADD_VERTEX_POINT(angle, radius, r, g, b, a)          \
-  {                                                          \
-    line->points[count].x = m_polarLookup->x[angle][radius]; \
-    line->points[count].y = m_polarLookup->y[angle][radius]; \
-    line->points[count].red = r;                             \
-    line->points[count].green = g;                           \
-    line->points[count].blue = b;                            \
-    line->points[count].alpha = a;                           \
-    count++;                                                 \
+#define ADD_VERTEX_POINT(angle, radius, r, g, b, a)             \
+  {                                                             \
+    line->points[count].x = m_polarLookup->GetX(angle, radius); \
+    line->points[count].y = m_polarLookup->GetY(angle, radius); \
+    line->points[count].red = r;                                \
+    line->points[count].green = g;                              \
+    line->points[count].blue = b;                               \
+    line->points[count].alpha = a;                              \
+    count++;                                                    \
   }
 
 void RadarDrawVertex::SetBlob(VertexLine* line, int angle_begin, int angle_end, int r1, int r2, GLubyte red, GLubyte green,
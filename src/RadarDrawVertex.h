@@ -72,7 +72,7 @@ class RadarDrawVertex : public RadarDraw {
     }
   }
 
- private:
+ protected:
   RadarInfo* m_ri;
 
   static const int VERTEX_PER_TRIANGLE = 3;
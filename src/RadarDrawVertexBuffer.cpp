@@ -0,0 +1,159 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include "RadarDrawVertexBuffer.h"
+#include "shaderutil.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+bool RadarDrawVertexBuffer::Init() {
+  if (!VertexBuffersSupported()) {
+    wxLogError(wxT("BR24radar_pi: the OpenGL system of this computer does not support vertex buffer objects"));
+    return false;
+  }
+
+  wxCriticalSectionLocker lock(m_exclusive);
+
+  if (!m_vbo) {
+    GenBuffers(1, &m_vbo);
+  }
+  BindBuffer(GL_ARRAY_BUFFER, m_vbo);
+  ResizeBuffer(INITIAL_SLOT_SIZE);
+  BindBuffer(GL_ARRAY_BUFFER, 0);
+
+  return true;
+}
+
+RadarDrawVertexBuffer::~RadarDrawVertexBuffer() {
+  wxCriticalSectionLocker lock(m_exclusive);
+
+  if (m_vbo) {
+    DeleteBuffers(1, &m_vbo);
+    m_vbo = 0;
+  }
+}
+
+// (Re)allocate m_vbo with room for at least slot_size vertices per spoke. The old contents
+// are lost, so all spokes are marked for upload. Must be called with m_vbo bound.
+void RadarDrawVertexBuffer::ResizeBuffer(size_t slot_size) {
+  size_t size = m_slot_size ? m_slot_size : INITIAL_SLOT_SIZE;
+
+  while (size < slot_size) {
+    size *= 2;
+  }
+  BufferData(GL_ARRAY_BUFFER, size * LINES_PER_ROTATION * sizeof(VertexPoint), 0, GL_DYNAMIC_DRAW);
+  m_slot_size = size;
+  m_start_line = 0;
+  m_lines = LINES_PER_ROTATION;
+}
+
+void RadarDrawVertexBuffer::ProcessRadarSpoke(int transparency, SpokeBearing angle, UINT8* data, size_t len) {
+  if (angle < 0 || angle >= LINES_PER_ROTATION) {
+    return;
+  }
+
+  RadarDrawVertex::ProcessRadarSpoke(transparency, angle, data, len);
+
+  wxCriticalSectionLocker lock(m_exclusive);
+
+  if (m_start_line == -1) {
+    m_start_line = angle;  // Note that this only runs once after each draw,
+  }
+  // When the heading changes the spokes don't arrive strictly in order, so grow the range
+  // up to this spoke instead of just counting them.
+  int lines = MOD_ROTATION2048(angle - m_start_line) + 1;
+  if (lines > m_lines) {
+    m_lines = lines;
+  }
+}
+
+void RadarDrawVertexBuffer::DrawRadarImage() {
+  wxCriticalSectionLocker lock(m_exclusive);
+
+  if (!m_vbo) {
+    return;
+  }
+
+  BindBuffer(GL_ARRAY_BUFFER, m_vbo);
+
+  if (m_start_line > -1) {
+    // Does a spoke no longer fit in its slot?
+    size_t needed = 0;
+    for (int i = 0; i < m_lines; i++) {
+      needed = MAX(needed, m_vertices[MOD_ROTATION2048(m_start_line + i)].count);
+    }
+    if (needed > m_slot_size) {
+      ResizeBuffer(needed);
+    }
+
+    // Only upload the spokes received since the last draw
+    for (int i = 0; i < m_lines; i++) {
+      int spoke = MOD_ROTATION2048(m_start_line + i);
+      VertexLine* line = &m_vertices[spoke];
+
+      if (line->count) {
+        BufferSubData(GL_ARRAY_BUFFER, spoke * m_slot_size * sizeof(VertexPoint), line->count * sizeof(VertexPoint), line->points);
+      }
+    }
+    m_start_line = -1;
+    m_lines = 0;
+  }
+
+  time_t now = time(0);
+  GLsizei spokes = 0;
+  for (size_t i = 0; i < LINES_PER_ROTATION; i++) {
+    VertexLine* line = &m_vertices[i];
+    if (!line->count || TIMED_OUT(now, line->timeout)) {
+      continue;
+    }
+    m_first[spokes] = i * m_slot_size;
+    m_vertex_count[spokes] = line->count;
+    spokes++;
+  }
+
+  if (spokes) {
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+
+    // With a buffer bound the pointers are offsets into the buffer
+    glVertexPointer(2, GL_FLOAT, sizeof(VertexPoint), (const GLvoid*)offsetof(VertexPoint, x));
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(VertexPoint), (const GLvoid*)offsetof(VertexPoint, red));
+    MultiDrawArrays(GL_TRIANGLES, m_first, m_vertex_count, spokes);
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+  }
+
+  BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,77 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _RADARDRAWVERTEXBUFFER_H_
+#define _RADARDRAWVERTEXBUFFER_H_
+
+#include "RadarDrawVertex.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/*
+ * The same triangles as RadarDrawVertex, but kept in a vertex buffer object on the GPU.
+ * The buffer has a fixed size slot per spoke, so only the spokes that changed since the
+ * last draw need to be uploaded, and the whole image is drawn in a single call.
+ */
+class RadarDrawVertexBuffer : public RadarDrawVertex {
+ public:
+  RadarDrawVertexBuffer(RadarInfo* ri) : RadarDrawVertex(ri) {
+    m_vbo = 0;
+    m_slot_size = 0;
+    m_start_line = -1;  // No spokes received since last draw
+    m_lines = 0;
+  }
+
+  bool Init();
+  void DrawRadarImage();
+  void ProcessRadarSpoke(int transparency, SpokeBearing angle, UINT8* data, size_t len);
+
+  ~RadarDrawVertexBuffer();
+
+ private:
+  static const size_t INITIAL_SLOT_SIZE = 64 * VERTEX_PER_QUAD;
+
+  // m_exclusive also protects the following
+  GLuint m_vbo;
+  size_t m_slot_size;  // # of vertices reserved per spoke in m_vbo
+  int m_start_line;    // First line received since last draw, or -1
+  int m_lines;         // # of lines received since last draw
+
+  GLint m_first[LINES_PER_ROTATION];  // Arguments for glMultiDrawArrays
+  GLsizei m_vertex_count[LINES_PER_ROTATION];
+
+  void ResizeBuffer(size_t slot_size);
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _RADARDRAWVERTEXBUFFER_H_ */
@@ -34,6 +34,8 @@
 #include "RadarDraw.h"
 #include "RadarMarpa.h"
 #include "RadarPanel.h"
+#include "SpokeKernels.h"
+#include "SpokeQueue.h"
 #include "br24ControlsDialog.h"
 #include "br24Receive.h"
 #include "br24Transmit.h"
@@ -186,8 +188,6 @@ RadarInfo::RadarInfo(br24radar_pi *pi, int radar) {
   m_auto_range_mode = true;
   m_course_index = 0;
   m_old_range = 0;
-  m_dir_lat = 0;
-  m_dir_lon = 0;
   m_range_meters = 0;
   m_auto_range_meters = 0;
   m_previous_auto_range_meters = 0;
@@ -198,6 +198,9 @@ RadarInfo::RadarInfo(br24radar_pi *pi, int radar) {
   ClearTrails();
   CLEAR_STRUCT(m_statistics);
   CLEAR_STRUCT(m_course_log);
+#ifdef BR24_STAGE_TIMING
+  CLEAR_STRUCT(m_stage_ns);
+#endif
 
   m_mouse_lat = NAN;
   m_mouse_lon = NAN;
@@ -211,6 +214,8 @@ RadarInfo::RadarInfo(br24radar_pi *pi, int radar) {
   }
   m_transmit = 0;
   m_receive = 0;
+  m_process = 0;
+  m_arpa_thread = 0;
   m_draw_panel.draw = 0;
   m_draw_overlay.draw = 0;
   m_radar_panel = 0;
@@ -219,6 +224,8 @@ RadarInfo::RadarInfo(br24radar_pi *pi, int radar) {
   m_state.Update(RADAR_OFF);
   m_range.m_settings = &m_pi->m_settings;
   m_refresh_millis = 50;
+  m_kernels = GetSpokeKernels();
+  m_colour_palette_version = 0;
 
   m_arpa = new RadarArpa(m_pi, this);
   for (size_t z = 0; z < GUARD_ZONES; z++) {
@@ -259,6 +266,28 @@ void RadarInfo::Shutdown() {
     m_receive = 0;
   }
 
+  if (m_process) {
+    m_process->Shutdown();
+    m_process->Wait();
+    while (!m_process->m_is_shutdown) {
+      wxYield();
+      wxMilliSleep(10);
+    }
+    delete m_process;
+    m_process = 0;
+  }
+
+  if (m_arpa_thread) {
+    m_arpa_thread->Shutdown();
+    m_arpa_thread->Wait();
+    while (!m_arpa_thread->m_is_shutdown) {
+      wxYield();
+      wxMilliSleep(10);
+    }
+    delete m_arpa_thread;
+    m_arpa_thread = 0;
+  }
+
   if (m_control_dialog) {
     delete m_control_dialog;
     m_control_dialog = 0;
@@ -303,6 +332,7 @@ bool RadarInfo::Init(wxString name, int verbose) {
   m_name = name;
 
   ComputeColourMap();
+  LOG_VERBOSE(wxT("BR24radar_pi: %s using %s spoke kernels"), m_name.c_str(), wxString::FromAscii(m_kernels->name).c_str());
 
   m_transmit = new br24Transmit(m_pi, name, m_radar);
 
@@ -369,6 +399,29 @@ void RadarInfo::SetName(wxString name) {
 }
 
 void RadarInfo::StartReceive() {
+  // Start the thread that processes the spokes before the thread that produces them
+  if (!m_process) {
+    LOG_RECEIVE(wxT("BR24radar_pi: %s starting spoke process thread"), m_name.c_str());
+    m_process = new SpokeProcessThread(m_pi, this);
+    if (!m_process || (m_process->Run() != wxTHREAD_NO_ERROR)) {
+      LOG_INFO(wxT("BR24radar_pi: %s unable to start spoke process thread, processing in receive thread."), m_name.c_str());
+      if (m_process) {
+        delete m_process;
+      }
+      m_process = 0;
+    }
+  }
+  if (!m_arpa_thread) {
+    LOG_RECEIVE(wxT("BR24radar_pi: %s starting ARPA thread"), m_name.c_str());
+    m_arpa_thread = new ArpaThread(m_pi, this);
+    if (!m_arpa_thread || (m_arpa_thread->Run() != wxTHREAD_NO_ERROR)) {
+      LOG_INFO(wxT("BR24radar_pi: %s unable to start ARPA thread, refreshing ARPA targets when drawing."), m_name.c_str());
+      if (m_arpa_thread) {
+        delete m_arpa_thread;
+      }
+      m_arpa_thread = 0;
+    }
+  }
   if (!m_receive) {
     LOG_RECEIVE(wxT("BR24radar_pi: %s starting receive thread"), m_name.c_str());
     m_receive = new br24Receive(m_pi, this);
@@ -417,6 +470,15 @@ void RadarInfo::ComputeColourMap() {
       b1 += delta_b;
     }
   }
+
+  CLEAR_STRUCT(m_colour_palette);
+  for (int i = BLOB_NONE + 1; i < BLOB_COLOURS; i++) {
+    m_colour_palette[i][0] = m_colour_map_rgb[i].Red();
+    m_colour_palette[i][1] = m_colour_map_rgb[i].Green();
+    m_colour_palette[i][2] = m_colour_map_rgb[i].Blue();
+    m_colour_palette[i][3] = 255;
+  }
+  m_colour_palette_version++;
 }
 
 void RadarInfo::ResetSpokes() {
@@ -442,6 +504,7 @@ void RadarInfo::ResetSpokes() {
     // Zap them anyway just to be sure
     m_guard_zone[z]->ResetBogeys();
   }
+  m_polygon_zones.ResetBogeys();
 }
 
 /*
@@ -457,6 +520,7 @@ void RadarInfo::ResetSpokes() {
 void RadarInfo::ProcessRadarSpoke(SpokeBearing angle, SpokeBearing bearing, UINT8 *data, size_t len, int range_meters,
                                   wxLongLong time_rec, double lat, double lon) {
   int orientation;
+  STAGE_TIMER_START(stage_time);
 
   // calculate course as the moving average of m_hdt over one revolution
   SampleCourse(angle);  // used for course_up mode
@@ -506,66 +570,85 @@ void RadarInfo::ProcessRadarSpoke(SpokeBearing angle, SpokeBearing bearing, UINT
   m_history[bearing].time = time_rec;
   m_history[bearing].lat = lat;
   m_history[bearing].lon = lon;
-  for (size_t radius = 0; radius < len; radius++) {
-    hist_data[radius] = 0;
-    if (data[radius] >= weakest_normal_blob) {
-      // and add 1 if above threshold and set the left 2 bits, used for ARPA
-      hist_data[radius] = hist_data[radius] | 192;
-    }
+  // Set the left 2 bits if above threshold, used for ARPA
+  m_kernels->history(data, hist_data, len, weakest_normal_blob);
+  if (m_arpa) {
+    m_arpa->LabelSpoke(bearing, hist_data);
   }
+  STAGE_TIMER_STOP(stage_time, STAGE_HISTORY);
 
+  // Pack the strong returns into bits once, then each zone only counts the bits in its span
+  uint64_t strong[STRONG_WORDS];
+  bool strong_packed = false;
   for (size_t z = 0; z < GUARD_ZONES; z++) {
     if (m_guard_zone[z]->m_alarm_on) {
-      m_guard_zone[z]->ProcessSpoke(angle, data, m_history[bearing].line, len, range_meters);
+      if (!strong_packed) {
+        m_kernels->strong(data, len, weakest_normal_blob, strong);
+        strong_packed = true;
+      }
+      m_guard_zone[z]->ProcessSpoke(angle, data, strong, range_meters);
+    }
+  }
+  if (m_polygon_zones.Size()) {
+    if (m_polygon_zones.AnyAlarm() && !strong_packed) {
+      m_kernels->strong(data, len, weakest_normal_blob, strong);
     }
+    m_polygon_zones.ProcessSpoke(bearing, strong, range_meters, lat, lon);
+  }
+  if (m_arpa_thread) {
+    m_arpa_thread->SpokeProcessed();
   }
+  STAGE_TIMER_STOP(stage_time, STAGE_GUARD_ZONE);
 
   bool draw_trails_on_overlay = (m_pi->m_settings.trails_on_overlay == 1);
   if (m_draw_overlay.draw && !draw_trails_on_overlay) {
     m_draw_overlay.draw->ProcessRadarSpoke(m_pi->m_settings.overlay_transparency, bearing, data, len);
   }
+  STAGE_TIMER_STOP(stage_time, STAGE_DRAW);
 
   UpdateTrailPosition();
 
   // True trails
   int motion = m_trails_motion.GetValue();
   PolarToCartesianLookupTable *polarLookup = GetPolarToCartesianLookupTable();
+  // when ship moves north, offset.lat > 0. Add to move trails image in opposite direction
+  // when ship moves east, offset.lon > 0. Add to move trails image in opposite direction
+  int center_x = TrailIndex(TRAILS_SIZE / 2 + m_trails.offset.lat);
+  int center_y = TrailIndex(TRAILS_SIZE / 2 + m_trails.offset.lon);
   for (size_t radius = 0; radius < len - 1; radius++) {  //  len - 1 : no trails on range circle
-    int x = polarLookup->intx[bearing][radius] + TRAILS_SIZE / 2 + m_trails.offset.lat;
-    int y = polarLookup->inty[bearing][radius] + TRAILS_SIZE / 2 + m_trails.offset.lon;
-
-    if (x >= 0 && x < TRAILS_SIZE && y >= 0 && y < TRAILS_SIZE) {
-      UINT8 *trail = &m_trails.true_trails[x][y];
-      // when ship moves north, offset.lat > 0. Add to move trails image in opposite direction
-      // when ship moves east, offset.lon > 0. Add to move trails image in opposite direction
-      if (data[radius] >= weakest_normal_blob) {
-        *trail = 1;
-      } else {
-        if (*trail > 0 && *trail < TRAIL_MAX_REVOLUTIONS) {
-          (*trail)++;
-        }
-        if (motion == TARGET_MOTION_TRUE) {
-          data[radius] = m_trail_colour[*trail];
-        }
-      }
+    int x = polarLookup->intx[bearing][radius] + center_x;
+    int y = polarLookup->inty[bearing][radius] + center_y;
+
+    // The spoke is shorter than the buffer, so it wraps at most once
+    if (x < 0) {
+      x += TRAILS_SIZE;
+    } else if (x >= TRAILS_SIZE) {
+      x -= TRAILS_SIZE;
+    }
+    if (y < 0) {
+      y += TRAILS_SIZE;
+    } else if (y >= TRAILS_SIZE) {
+      y -= TRAILS_SIZE;
     }
-  }
 
-  // Relative trails
-  UINT8 *trail = m_trails.relative_trails[angle];
-  for (size_t radius = 0; radius < len - 1; radius++) {  // len - 1 : no trails on range circle
+    UINT8 *trail = &m_trails.true_trails[x][y];
     if (data[radius] >= weakest_normal_blob) {
       *trail = 1;
     } else {
       if (*trail > 0 && *trail < TRAIL_MAX_REVOLUTIONS) {
         (*trail)++;
       }
-      if (motion == TARGET_MOTION_RELATIVE) {
+      if (motion == TARGET_MOTION_TRUE) {
         data[radius] = m_trail_colour[*trail];
       }
     }
-    trail++;
   }
+  STAGE_TIMER_STOP(stage_time, STAGE_TRUE_TRAILS);
+
+  // Relative trails, len - 1 : no trails on range circle
+  m_kernels->trails(data, m_trails.relative_trails[angle], len - 1, weakest_normal_blob, TRAIL_MAX_REVOLUTIONS, m_trail_colour,
+                    motion == TARGET_MOTION_RELATIVE);
+  STAGE_TIMER_STOP(stage_time, STAGE_RELATIVE_TRAILS);
 
   if (m_draw_overlay.draw && draw_trails_on_overlay) {
     m_draw_overlay.draw->ProcessRadarSpoke(m_pi->m_settings.overlay_transparency, bearing, data, len);
@@ -574,6 +657,7 @@ void RadarInfo::ProcessRadarSpoke(SpokeBearing angle, SpokeBearing bearing, UINT
   if (m_draw_panel.draw) {
     m_draw_panel.draw->ProcessRadarSpoke(4, stabilized_mode ? bearing : angle, data, len);
   }
+  STAGE_TIMER_STOP(stage_time, STAGE_DRAW);
 }
 
 void RadarInfo::SampleCourse(int angle) {
@@ -624,36 +708,38 @@ void RadarInfo::ZoomTrails(float zoom_factor) {
   memcpy(m_trails.relative_trails, m_trails.copy_of_relative_trails, sizeof(m_trails.copy_of_relative_trails));
 
   CLEAR_STRUCT(m_trails.copy_of_true_trails);
-  // zoom true trails
-  for (int i = wxMax(TRAILS_SIZE / 2 + m_trails.offset.lat - RETURNS_PER_LINE, 0);
-       i < wxMin(TRAILS_SIZE / 2 + m_trails.offset.lat + RETURNS_PER_LINE, TRAILS_SIZE); i++) {
-    int index_i = (int((float)(i - TRAILS_SIZE / 2 + m_trails.offset.lat) * zoom_factor)) + TRAILS_SIZE / 2 -
-                  m_trails.offset.lat * zoom_factor;
-    if (index_i >= TRAILS_SIZE - 1) break;  // allow adding an additional pixel later
-    if (index_i < 0) continue;
-    for (int j = wxMax(TRAILS_SIZE / 2 + m_trails.offset.lon - RETURNS_PER_LINE, 0);
-         j < wxMin(TRAILS_SIZE / 2 + m_trails.offset.lon + RETURNS_PER_LINE, TRAILS_SIZE); j++) {
-      int index_j = (int((float)(j - TRAILS_SIZE / 2 + m_trails.offset.lon) * zoom_factor)) + TRAILS_SIZE / 2 -
-                    m_trails.offset.lon * zoom_factor;
-      if (index_j >= TRAILS_SIZE - 1) break;
-      if (index_j < 0) continue;
-      if (m_trails.true_trails[i][j] != 0) {  // many to one mapping, prevent overwriting trails with 0
-        m_trails.copy_of_true_trails[index_i][index_j] = m_trails.true_trails[i][j];
+  // zoom true trails around the ship, i and j are relative to the ship
+  int center_x = TRAILS_SIZE / 2 + m_trails.offset.lat;
+  int center_y = TRAILS_SIZE / 2 + m_trails.offset.lon;
+  for (int i = -RETURNS_PER_LINE; i < RETURNS_PER_LINE; i++) {
+    int index_i = int((float)i * zoom_factor);
+    if (index_i >= RETURNS_PER_LINE - 1) break;  // allow adding an additional pixel later
+    if (index_i < -RETURNS_PER_LINE) continue;
+    UINT8 *from = m_trails.true_trails[TrailIndex(center_x + i)];
+    UINT8 *to = m_trails.copy_of_true_trails[TrailIndex(center_x + index_i)];
+    UINT8 *to_next = m_trails.copy_of_true_trails[TrailIndex(center_x + index_i + 1)];
+    for (int j = -RETURNS_PER_LINE; j < RETURNS_PER_LINE; j++) {
+      int index_j = int((float)j * zoom_factor);
+      if (index_j >= RETURNS_PER_LINE - 1) break;
+      if (index_j < -RETURNS_PER_LINE) continue;
+      UINT8 trail = from[TrailIndex(center_y + j)];
+      if (trail != 0) {  // many to one mapping, prevent overwriting trails with 0
+        int y = TrailIndex(center_y + index_j);
+        int y_next = TrailIndex(center_y + index_j + 1);
+        to[y] = trail;
         if (zoom_factor > 1.2) {
           // add an extra pixel in the y direction
-          m_trails.copy_of_true_trails[index_i][index_j + 1] = m_trails.true_trails[i][j];
+          to[y_next] = trail;
           if (zoom_factor > 1.6) {
             // also add  pixel in the x direction
-            m_trails.copy_of_true_trails[index_i + 1][index_j] = m_trails.true_trails[i][j];
-            m_trails.copy_of_true_trails[index_i + 1][index_j + 1] = m_trails.true_trails[i][j];
+            to_next[y] = trail;
+            to_next[y_next] = trail;
           }
         }
       }
     }
   }
   memcpy(m_trails.true_trails, m_trails.copy_of_true_trails, sizeof(m_trails.copy_of_true_trails));
-  m_trails.offset.lon *= zoom_factor;
-  m_trails.offset.lat *= zoom_factor;
 }
 
 void RadarInfo::UpdateTransmitState() {
@@ -740,17 +826,9 @@ void RadarInfo::UpdateTrailPosition() {
 
   // When position changes the trail image is not moved, only the pointer to the center
   // of the image (offset) is changed.
-  // So we move the image around within the m_trails.true_trails buffer (by moving the pointer).
-  // But when there is no room anymore (margin used) the whole trails image is shifted
-  // and the offset is reset
-  if (m_trails.offset.lon >= MARGIN || m_trails.offset.lon <= -MARGIN) {
-    LOG_INFO(wxT("BR24radar_pi: offset lon too large %d"), m_trails.offset.lon);
-    m_trails.offset.lon = 0;
-  }
-  if (m_trails.offset.lat >= MARGIN || m_trails.offset.lat <= -MARGIN) {
-    LOG_INFO(wxT("BR24radar_pi: offset lat too large %d"), m_trails.offset.lat);
-    m_trails.offset.lat = 0;
-  }
+  // The m_trails.true_trails buffer wraps around at the edges, so the image never has to be
+  // shifted back to the middle: we only clear the rows or columns that come into view on
+  // the side we are moving to, as they still contain trails from the other side.
 
   // zooming of trails required? First check conditions
   if (m_old_range == 0 || m_range_meters == 0) {
@@ -767,11 +845,7 @@ void RadarInfo::UpdateTrailPosition() {
     float zoom_factor = (float)m_old_range / (float)m_range_meters;
     m_old_range = m_range_meters;
 
-    // center the image before zooming
-    // otherwise the offset might get too large
-    ShiftImageLatToCenter();
-    ShiftImageLonToCenter();
-    ZoomTrails(zoom_factor);  // this no longer modifies m_trails.offset, as the image is centered now
+    ZoomTrails(zoom_factor);  // zooms around the ship, so m_trails.offset stays valid
   }
   m_old_range = m_range_meters;
 
@@ -799,39 +873,6 @@ void RadarInfo::UpdateTrailPosition() {
   shift_lat = (int)(fshift_lat + m_trails.dif_lat);
   shift_lon = (int)(fshift_lon + m_trails.dif_lon);
 
-  // Check for changes in the direction of movement, part of the image buffer has to be erased
-  if (shift_lat > 0 && m_dir_lat <= 0) {
-    // change of direction of movement
-    // clear space in true_trails outside image in that direction (this area might not be empty)
-    memset(&m_trails.true_trails[TRAILS_SIZE - MARGIN + m_trails.offset.lat][0], 0, TRAILS_SIZE * (MARGIN - m_trails.offset.lat));
-    m_dir_lat = 1;
-  }
-
-  if (shift_lat < 0 && m_dir_lat >= 0) {
-    // change of direction of movement
-    // clear space in true_trails outside image in that direction
-    memset(&m_trails.true_trails[0][0], 0, TRAILS_SIZE * (MARGIN + m_trails.offset.lat));
-    m_dir_lat = -1;
-  }
-
-  if (shift_lon > 0 && m_dir_lon <= 0) {
-    // change of direction of movement
-    // clear space in true_trails outside image in that direction
-    for (int i = 0; i < TRAILS_SIZE; i++) {
-      memset(&m_trails.true_trails[i][TRAILS_SIZE - MARGIN + m_trails.offset.lon], 0, MARGIN - m_trails.offset.lon);
-    }
-    m_dir_lon = 1;
-  }
-
-  if (shift_lon < 0 && m_dir_lon >= 0) {
-    // change of direction of movement
-    // clear space in true_trails outside image in that direction
-    for (int i = 0; i < TRAILS_SIZE; i++) {
-      memset(&m_trails.true_trails[i][0], 0, MARGIN + m_trails.offset.lon);
-    }
-    m_dir_lon = -1;
-  }
-
   // save the rounding fraction and appy it next time
   m_trails.dif_lat = fshift_lat + m_trails.dif_lat - (double)shift_lat;
   m_trails.dif_lon = fshift_lon + m_trails.dif_lon - (double)shift_lon;
@@ -846,61 +887,41 @@ void RadarInfo::UpdateTrailPosition() {
     return;
   }
 
-  // offset lon too large: shift image
-  if (abs(m_trails.offset.lon + shift_lon) >= MARGIN) {
-    ShiftImageLonToCenter();
+  // clear what comes into view, the edge of the image is RETURNS_PER_LINE away from the ship
+  if (shift_lat > 0) {
+    ClearTrailRows(m_trails.offset.lat + RETURNS_PER_LINE, shift_lat + 1);
+  } else if (shift_lat < 0) {
+    ClearTrailRows(m_trails.offset.lat + shift_lat - RETURNS_PER_LINE, 1 - shift_lat);
   }
-
-  // offset lat too large: shift image in lat direction
-  if (abs(m_trails.offset.lat + shift_lat) >= MARGIN) {
-    ShiftImageLatToCenter();
+  if (shift_lon > 0) {
+    ClearTrailColumns(m_trails.offset.lon + RETURNS_PER_LINE, shift_lon + 1);
+  } else if (shift_lon < 0) {
+    ClearTrailColumns(m_trails.offset.lon + shift_lon - RETURNS_PER_LINE, 1 - shift_lon);
   }
-  // apply the shifts to the offset
-  m_trails.offset.lat += shift_lat;
-  m_trails.offset.lon += shift_lon;
+
+  // apply the shifts to the offset, kept within the buffer so it can't overflow
+  m_trails.offset.lat = TrailIndex(m_trails.offset.lat + shift_lat);
+  m_trails.offset.lon = TrailIndex(m_trails.offset.lon + shift_lon);
 }
 
-// shifts the true trails image in lon direction to center
-void RadarInfo::ShiftImageLonToCenter() {
-  if (m_trails.offset.lon >= MARGIN || m_trails.offset.lon <= -MARGIN) {  // abs no good
-    LOG_INFO(wxT("BR24radar_pi: offset lon too large %i"), m_trails.offset.lon);
-    m_trails.offset.lon = 0;
-    return;
-  }
-  if (m_trails.offset.lon > 0) {
-    for (int i = 0; i < TRAILS_SIZE; i++) {
-      memmove(&m_trails.true_trails[i][MARGIN], &m_trails.true_trails[i][MARGIN + m_trails.offset.lon], RETURNS_PER_LINE * 2);
-      memset(&m_trails.true_trails[i][TRAILS_SIZE - MARGIN], 0, MARGIN);
-    }
+// Clears count rows of the true trails, starting at row first counted from the middle of the buffer
+void RadarInfo::ClearTrailRows(int first, int count) {
+  for (int i = 0; i < count; i++) {
+    memset(m_trails.true_trails[TrailIndex(TRAILS_SIZE / 2 + first + i)], 0, TRAILS_SIZE);
   }
-  if (m_trails.offset.lon < 0) {
-    for (int i = 0; i < TRAILS_SIZE; i++) {
-      memmove(&m_trails.true_trails[i][MARGIN], &m_trails.true_trails[i][MARGIN + m_trails.offset.lon], RETURNS_PER_LINE * 2);
-      memset(&m_trails.true_trails[i][TRAILS_SIZE - MARGIN], 0, MARGIN);
-      memset(&m_trails.true_trails[i][0], 0, MARGIN);
-    }
-  }
-  m_trails.offset.lon = 0;
 }
 
-// shifts the true trails image in lat direction to center
-void RadarInfo::ShiftImageLatToCenter() {
-  if (m_trails.offset.lat >= MARGIN || m_trails.offset.lat <= -MARGIN) {  // abs not ok
-    LOG_INFO(wxT("BR24radar_pi: offset lat too large %i"), m_trails.offset.lat);
-    m_trails.offset.lat = 0;
-  }
+// Clears count columns of the true trails, starting at column first counted from the middle of the buffer
+void RadarInfo::ClearTrailColumns(int first, int count) {
+  int start = TrailIndex(TRAILS_SIZE / 2 + first);
+  int part = MIN(count, TRAILS_SIZE - start);  // up to the right edge, the rest wraps to the left edge
 
-  if (m_trails.offset.lat > 0) {
-    memmove(&m_trails.true_trails[MARGIN][0], &m_trails.true_trails[MARGIN + m_trails.offset.lat][0],
-            (RETURNS_PER_LINE * 2) * TRAILS_SIZE);
-    memset(&m_trails.true_trails[TRAILS_SIZE - MARGIN][0], 0, TRAILS_SIZE * MARGIN);
-  }
-  if (m_trails.offset.lat < 0) {
-    memmove(&m_trails.true_trails[MARGIN][0], &m_trails.true_trails[MARGIN + m_trails.offset.lat][0],
-            RETURNS_PER_LINE * 2 * TRAILS_SIZE);
-    memset(&m_trails.true_trails[0][0], 0, TRAILS_SIZE * MARGIN);
+  for (int i = 0; i < TRAILS_SIZE; i++) {
+    memset(&m_trails.true_trails[i][start], 0, part);
+    if (count > part) {
+      memset(&m_trails.true_trails[i][0], 0, count - part);
+    }
   }
-  m_trails.offset.lat = 0;
 }
 
 void RadarInfo::RenderGuardZone() {
@@ -1036,6 +1057,7 @@ void RadarInfo::UpdateControlState(bool all) {
   }
 }
 
+// Called with m_exclusive held
 void RadarInfo::ResetRadarImage() {
   if (m_range_meters) {
     ResetSpokes();
@@ -1126,6 +1148,9 @@ void RadarInfo::RenderRadarImage(wxPoint center, double scale, double overlay_ro
     for (int i = 0; i < GUARD_ZONES; i++) {
       if (m_guard_zone[i]->m_arpa_on) arpa_on = true;
     }
+    if (m_polygon_zones.AnyArpa()) {
+      arpa_on = true;
+    }
     if (m_arpa->GetTargetCount()) {
       arpa_on = true;
     }
@@ -1173,7 +1198,7 @@ void RadarInfo::RenderRadarImage(wxPoint center, double scale, double overlay_ro
     arpa_rotate = overlay_rotate - OPENGL_ROTATION;
   }
 
-  if (arpa_on) {
+  if (arpa_on && !m_arpa_thread) {
     m_arpa->RefreshArpaTargets();
   }
 
@@ -1579,6 +1604,7 @@ void RadarInfo::ComputeTargetTrails() {
   LOG_VERBOSE(wxT("BR24radar_pi: Target trail value %d = %d revolutions"), target_trails, maxRev);
 
   // Disperse the BLOB_HISTORY values over 0..maxrev
+  CLEAR_STRUCT(m_trail_colour);
   for (revolution = 0; revolution <= TRAIL_MAX_REVOLUTIONS; revolution++) {
     if (revolution >= 1 && revolution < maxRev) {
       m_trail_colour[revolution] = (BlobColour)(BLOB_HISTORY_0 + (int)colour);
@@ -32,6 +32,7 @@
 #ifndef _RADAR_INFO_H_
 #define _RADAR_INFO_H_
 
+#include "PolygonZone.h"
 #include "br24radar_pi.h"
 
 PLUGIN_BEGIN_NAMESPACE
@@ -40,6 +41,28 @@ class RadarDraw;
 class RadarCanvas;
 class RadarPanel;
 class GuardZoneBogey;
+struct SpokeKernels;
+
+/*
+ * radar-bench compiles the plugin sources with BR24_STAGE_TIMING defined to see
+ * where RadarInfo::ProcessRadarSpoke spends its time. In the plugin itself these
+ * macros compile to nothing.
+ */
+#ifdef BR24_STAGE_TIMING
+enum SpokeStage { STAGE_HISTORY, STAGE_GUARD_ZONE, STAGE_TRUE_TRAILS, STAGE_RELATIVE_TRAILS, STAGE_DRAW, SPOKE_STAGES };
+
+extern int64_t GetStageClock();  // Monotonic nanoseconds, provided by radar-bench
+#define STAGE_TIMER_START(t) int64_t t = GetStageClock()
+#define STAGE_TIMER_STOP(t, stage)        \
+  {                                       \
+    int64_t stage_now = GetStageClock();  \
+    m_stage_ns[stage] += stage_now - (t); \
+    (t) = stage_now;                      \
+  }
+#else
+#define STAGE_TIMER_START(t)
+#define STAGE_TIMER_STOP(t, stage)
+#endif
 
 struct RadarRange {
   int meters;
@@ -193,6 +216,8 @@ class RadarInfo {
 
   br24Transmit *m_transmit;
   br24Receive *m_receive;
+  SpokeProcessThread *m_process;
+  ArpaThread *m_arpa_thread;
   br24ControlsDialog *m_control_dialog;
   RadarPanel *m_radar_panel;
   RadarCanvas *m_radar_canvas;
@@ -213,9 +238,14 @@ class RadarInfo {
   int m_refresh_millis;
 
   GuardZone *m_guard_zone[GUARD_ZONES];
+  PolygonZones m_polygon_zones;  // guard zones of any shape, only set by the configuration
   double m_ebl[ORIENTATION_NUMBER][BEARING_LINES];
   double m_vrm[BEARING_LINES];
   receive_statistics m_statistics;
+  wxCriticalSection m_statistics_lock;  // Protects m_statistics, so receiving never waits for m_exclusive
+#ifdef BR24_STAGE_TIMING
+  int64_t m_stage_ns[SPOKE_STAGES];  // Nanoseconds spent in each stage of ProcessRadarSpoke
+#endif
 
   struct line_history {
     UINT8 line[RETURNS_PER_LINE];
@@ -245,11 +275,9 @@ class RadarInfo {
     double lon;
     double dif_lat;  // Fraction of a pixel expressed in lat/lon for True Motion Target Trails
     double dif_lon;
-    IntVector offset;
+    IntVector offset;  // Position of the ship relative to the middle of true_trails, wraps at TRAILS_SIZE
   };
   int m_old_range;
-  int m_dir_lat;
-  int m_dir_lon;
   TrailBuffer m_trails;
 
   /* Methods */
@@ -269,8 +297,6 @@ class RadarInfo {
   void UpdateTrailPosition();
   void RenderGuardZone();
   void ResetRadarImage();
-  void ShiftImageLonToCenter();
-  void ShiftImageLatToCenter();
   void RenderRadarImage(wxPoint center, double scale, double rotation, bool overlay);
   void ShowRadarWindow(bool show);
   void ShowControlDialog(bool show, bool reparent);
@@ -311,9 +337,19 @@ class RadarInfo {
   // Speedup lookup tables of color to r,g,b, set dependent on m_settings.display_option.
   wxColour m_colour_map_rgb[BLOB_COLOURS];
   BlobColour m_colour_map[UINT8_MAX + 1];
+  // The same colours as RGBA per BlobColour, for the palette texture of RadarDrawShader
+  GLubyte m_colour_palette[UINT8_MAX + 1][4];
+  int m_colour_palette_version;  // Incremented every time the palette changes
 
  private:
   void ResetSpokes();
+  void ClearTrailRows(int first, int count);
+  void ClearTrailColumns(int first, int count);
+  // Wraps a row or column number around the edges of m_trails.true_trails
+  static int TrailIndex(int i) {
+    i %= TRAILS_SIZE;
+    return (i < 0) ? i + TRAILS_SIZE : i;
+  }
   void RenderRadarImage(DrawInfo *di);
   wxString FormatDistance(double distance);
   wxString FormatAngle(double angle);
@@ -321,6 +357,10 @@ class RadarInfo {
   int m_previous_auto_range_meters;
   int m_auto_range_meters;
 
+#ifdef BR24_STAGE_TIMING
+  friend class RadarBench;  // Installs its own RadarDraw
+#endif
+
   //  wxCriticalSection m_exclusive;  // protects the following two
   DrawInfo m_draw_panel;    // Draw onto our own panel
   DrawInfo m_draw_overlay;  // Abstract painting method
@@ -330,7 +370,8 @@ class RadarInfo {
 
   wxString m_range_text;
 
-  BlobColour m_trail_colour[TRAIL_MAX_REVOLUTIONS + 1];
+  UINT8 m_trail_colour[UINT8_MAX + 1];  // BlobColour per trail age, all 256 ages so it can be used as a lookup table
+  const SpokeKernels *m_kernels;        // SIMD versions of the loops in ProcessRadarSpoke
 
   int m_previous_orientation;
 };
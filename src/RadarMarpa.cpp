@@ -38,29 +38,61 @@ PLUGIN_BEGIN_NAMESPACE
 
 static int target_id_count = 0;
 
+#define MILLIS_PER_WAIT 250
+
 RadarArpa::RadarArpa(br24radar_pi* pi, RadarInfo* ri) {
   m_ri = ri;
   m_pi = pi;
-  m_number_of_targets = 0;
-  CLEAR_STRUCT(m_targets);
+  m_clear_contours = false;
+  m_cpa_alarms = 0;
+  m_index_range = 0;
 }
 
-ArpaTarget::~ArpaTarget() {
-  if (m_kalman) {
-    delete m_kalman;
-    m_kalman = 0;
+ArpaTarget::~ArpaTarget() {}
+
+RadarArpa::~RadarArpa() {
+  wxCriticalSectionLocker lock(m_exclusive);  // the store is freed after this returns, but no refresh can be running
+}
+
+ArpaTargetStore::~ArpaTargetStore() {
+  for (size_t i = 0; i < m_blocks.size(); i++) {
+    delete[] m_blocks[i];
   }
 }
 
-RadarArpa::~RadarArpa() {
-  int n = m_number_of_targets;
-  m_number_of_targets = 0;
-  for (int i = 0; i < n; i++) {
-    if (m_targets[i]) {
-      delete m_targets[i];
-      m_targets[i] = 0;
+ArpaTarget* ArpaTargetStore::Add(br24radar_pi* pi, RadarInfo* ri) {
+  if (m_live.size() >= MAX_NUMBER_OF_TARGETS) {
+    return 0;
+  }
+  if (m_free.empty()) {
+    ArpaTarget* block = new ArpaTarget[TARGET_POOL_BLOCK];
+    m_blocks.push_back(block);
+    for (int i = 0; i < TARGET_POOL_BLOCK; i++) {
+      block[i].m_kalman = &m_kalman;
+      block[i].m_cpa = &m_cpa;
+      block[i].m_lane = m_kalman.AddFilter();
+      m_cpa.AddLane();
     }
+    for (int i = TARGET_POOL_BLOCK - 1; i >= 0; i--) {
+      m_free.push_back(&block[i]);
+    }
+  }
+  ArpaTarget* target = m_free.back();
+  m_free.pop_back();
+  target->set(pi, ri);
+  target->m_id = m_next_id++;
+  if (m_next_id <= 0) {
+    m_next_id = 1;
   }
+  m_live.push_back(target);
+  return target;
+}
+
+void ArpaTargetStore::Remove(size_t i) {
+  // we keep the target for later use, destruction and construction is expensive
+  m_free.push_back(m_live[i]);
+  m_live[i] = m_live.back();
+  m_live.pop_back();
 }
 
 Position Polar2Pos(Polar pol, Position own_ship, double range) {
@@ -89,227 +121,37 @@ Polar Pos2Polar(Position p, Position own_ship, int range) {
 }
 
 bool RadarArpa::Pix(int ang, int rad) {
-  if (rad <= 1 || rad >= RETURNS_PER_LINE - 1) {  //  avoid range ring
-    return false;
-  }
-  return ((m_ri->m_history[MOD_ROTATION2048(ang)].line[rad] & 128) != 0);
-}
-
-bool ArpaTarget::Pix(int ang, int rad) {
-  if (rad <= 1 || rad >= RETURNS_PER_LINE - 1) {  //  avoid range ring
-    return false;
-  }
-  if (m_check_for_duplicate) {
-    // check bit 1
-    return ((m_ri->m_history[MOD_ROTATION2048(ang)].line[rad] & 64) != 0);
-  } else {
-    // check bit 0
-    return ((m_ri->m_history[MOD_ROTATION2048(ang)].line[rad] & 128) != 0);
-  }
+  return HistoryPixel<RadarInfo::line_history, HISTORY_UNCLAIMED>(m_ri->m_history)(ang, rad);
 }
 
+template <UINT8 bit>
 bool ArpaTarget::MultiPix(int ang, int rad) {  // checks if the blob has a contour of at least length pixels
   // pol must start on the contour of the blob
   // false if not
   // if false clears out pixels of the blob in hist
-  wxCriticalSectionLocker lock(ArpaTarget::m_ri->m_exclusive);
-  int length = m_ri->m_min_contour_length;
-  Polar start;
-  start.angle = ang;
-  start.r = rad;
-  if (!Pix(start.angle, start.r)) {
-    return false;
-  }
-  Polar current = start;  // the 4 possible translations to move from a point on the contour to the next
-  Polar max_angle;
-  Polar min_angle;
-  Polar max_r;
-  Polar min_r;
-  Polar transl[4];  //   = { 0, 1,   1, 0,   0, -1,   -1, 0 };
-  transl[0].angle = 0;
-  transl[0].r = 1;
-  transl[1].angle = 1;
-  transl[1].r = 0;
-  transl[2].angle = 0;
-  transl[2].r = -1;
-  transl[3].angle = -1;
-  transl[3].r = 0;
-  int count = 0;
-  int aa;
-  int rr;
-  bool succes = false;
-  int index = 0;
-  max_r = current;
-  max_angle = current;
-  min_r = current;
-  min_angle = current;  // check if p inside blob
-  if (start.r >= RETURNS_PER_LINE - 1) {
-    return false;  //  r too large
-  }
-  if (start.r < 3) {
-    return false;  //  r too small
-  }
-  // first find the orientation of border point p
-  for (int i = 0; i < 4; i++) {
-    index = i;
-    aa = current.angle + transl[index].angle;
-    rr = current.r + transl[index].r;
-    succes = !Pix(aa, rr);
-    if (succes) break;
-  }
-  if (!succes) {
-    // single pixel blob
-    return false;
-  }
-  index += 1;  // determines starting direction
-  if (index > 3) index -= 4;
-  while (current.r != start.r || current.angle != start.angle || count == 0) {  // try all translations to find the next point
-    // start with the "left most" translation relative to the
-    // previous one
-    index += 3;  // we will turn left all the time if possible
-    for (int i = 0; i < 4; i++) {
-      if (index > 3) index -= 4;
-      aa = current.angle + transl[index].angle;
-      rr = current.r + transl[index].r;
-      succes = Pix(aa, rr);
-      if (succes) {  // next point found
-        break;
-      }
-      index += 1;
-    }
-    if (!succes) {
-      return false;  // no next point found (this happens when the blob consists of one single pixel)
-    }                // next point found
-    current.angle = aa;
-    current.r = rr;
-    if (count >= length) {
-      return true;
-    }
-    count++;
-    if (current.angle > max_angle.angle) {
-      max_angle = current;
-    }
-    if (current.angle < min_angle.angle) {
-      min_angle = current;
-    }
-    if (current.r > max_r.r) {
-      max_r = current;
-    }
-    if (current.r < min_r.r) {
-      min_r = current;
-    }
-  }  // contour length is less than m_min_contour_length
-     // before returning false erase this blob so we do not have to check this one again
-  if (min_angle.angle < 0) {
-    min_angle.angle += LINES_PER_ROTATION;
-    max_angle.angle += LINES_PER_ROTATION;
-  }
-  for (int a = min_angle.angle; a <= max_angle.angle; a++) {
-    for (int r = min_r.r; r <= max_r.r; r++) {
-      m_ri->m_history[MOD_ROTATION2048(a)].line[r] &= 63;
-    }
-  }
-  return false;
-}
+  // called from RadarArpa::RefreshArpaTargets, so RadarInfo::m_exclusive is already held
+  HistoryPixel<RadarInfo::line_history, bit> pix(m_ri->m_history);
+  ContourBounds contour(m_ri->m_min_contour_length);
 
-bool RadarArpa::MultiPix(int ang, int rad) {
-  // checks the blob has a contour of at least length pixels
-  // pol must start on the contour of the blob
-  // false if not
-  // if false clears out pixels of th blob in hist
-  //    wxCriticalSectionLocker lock(ArpaTarget::m_ri->m_exclusive);
-  int length = m_ri->m_min_contour_length;
-  Polar start;
-  start.angle = ang;
-  start.r = rad;
-  if (!Pix(start.angle, start.r)) {
-    return false;
-  }
-  Polar current = start;  // the 4 possible translations to move from a point on the contour to the next
-  Polar max_angle;
-  Polar min_angle;
-  Polar max_r;
-  Polar min_r;
-  Polar transl[4];  //   = { 0, 1,   1, 0,   0, -1,   -1, 0 };
-  transl[0].angle = 0;
-  transl[0].r = 1;
-  transl[1].angle = 1;
-  transl[1].r = 0;
-  transl[2].angle = 0;
-  transl[2].r = -1;
-  transl[3].angle = -1;
-  transl[3].r = 0;
-  int count = 0;
-  int aa;
-  int rr;
-  bool succes = false;
-  int index = 0;
-  max_r = current;
-  max_angle = current;
-  min_r = current;
-  min_angle = current;  // check if p inside blob
-  if (start.r >= RETURNS_PER_LINE - 1) {
-    return false;  //  r too large
-  }
-  if (start.r < 3) {
-    return false;  //  r too small
-  }
-  // first find the orientation of border point p
-  for (int i = 0; i < 4; i++) {
-    index = i;
-    aa = current.angle + transl[index].angle;
-    rr = current.r + transl[index].r;
-    succes = !Pix(aa, rr);
-    if (succes) break;
-  }
-  if (!succes) {
+  if (!pix(ang, rad) || rad < 3) {
     return false;
   }
-  index += 1;  // determines starting direction
-  if (index > 3) index -= 4;
-  while (current.r != start.r || current.angle != start.angle ||
-         count == 0) {  // try all translations to find the next point  // start with the "left most" translation relative to the
-    // previous one
-    index += 3;  // we will turn left all the time if possible
-    for (int i = 0; i < 4; i++) {
-      if (index > 3) index -= 4;
-      aa = current.angle + transl[index].angle;
-      rr = current.r + transl[index].r;
-      succes = Pix(aa, rr);
-      if (succes) {  // next point found
-        break;
-      }
-      index += 1;
-    }
-    if (!succes) {
-      return false;  // no next point found
-    }                // next point found
-    current.angle = aa;
-    current.r = rr;
-    if (count >= length) {
+  switch (TraceContour(pix, ang, rad, contour)) {
+    case CONTOUR_STOPPED:
       return true;
-    }
-    count++;
-    if (current.angle > max_angle.angle) {
-      max_angle = current;
-    }
-    if (current.angle < min_angle.angle) {
-      min_angle = current;
-    }
-    if (current.r > max_r.r) {
-      max_r = current;
-    }
-    if (current.r < min_r.r) {
-      min_r = current;
-    }
-  }  // contour length is less than m_min_contour_length
+    case CONTOUR_CLOSED:
+      break;
+    default:
+      return false;  // single pixel blob
+  }
+  // contour length is less than m_min_contour_length
   // before returning false erase this blob so we do not have to check this one again
-  if (min_angle.angle < 0) {
-    min_angle.angle += LINES_PER_ROTATION;
-    max_angle.angle += LINES_PER_ROTATION;
+  if (contour.m_min_angle < 0) {
+    contour.m_min_angle += LINES_PER_ROTATION;
+    contour.m_max_angle += LINES_PER_ROTATION;
   }
-  for (int a = min_angle.angle; a <= max_angle.angle; a++) {
-    for (int r = min_r.r; r <= max_r.r; r++) {
+  for (int a = contour.m_min_angle; a <= contour.m_max_angle; a++) {
+    for (int r = contour.m_min_r; r <= contour.m_max_r; r++) {
       m_ri->m_history[MOD_ROTATION2048(a)].line[r] &= 63;
     }
   }
@@ -325,25 +167,20 @@ void RadarArpa::AcquireOrDeleteMarpaTarget(Position target_pos, int status) {
   // no contour taken yet
   // target status acquire0
   // returns in X metric coordinates of click
-  // constructs Kalman filter
+  wxCriticalSectionLocker lock(m_exclusive);
 
   // make new target
-  int i_target;
-  if (m_number_of_targets < MAX_NUMBER_OF_TARGETS - 1 ||
-      (m_number_of_targets == MAX_NUMBER_OF_TARGETS - 1 && status == FOR_DELETION)) {
-    if (m_targets[m_number_of_targets] == 0) {
-      m_targets[m_number_of_targets] = new ArpaTarget(m_pi, m_ri);
-    }
-    i_target = m_number_of_targets;
-    m_number_of_targets++;
-  } else {
+  ArpaTarget* target = 0;
+  if (m_targets.Size() < MAX_NUMBER_OF_TARGETS - 1 || status == FOR_DELETION) {
+    target = m_targets.Add(m_pi, m_ri);
+  }
+  if (!target) {
     LOG_INFO(wxT("BR24radar_pi: RadarArpa:: Error, max targets exceeded "));
     return;
   }
 
   LOG_ARPA(wxT("BR24radar_pi: Adding (M)ARPA target at position %f / %f"), target_pos.lat, target_pos.lon);
 
-  ArpaTarget* target = m_targets[i_target];
   target->m_position = target_pos;  // Expected position
   target->m_position.time = 0;
   target->m_position.dlat_dt = 0.;
@@ -354,14 +191,11 @@ void RadarArpa::AcquireOrDeleteMarpaTarget(Position target_pos, int status) {
   target->m_min_angle.angle = 0;
   target->m_max_r.r = 0;
   target->m_min_r.r = 0;
-
-  if (!target->m_kalman) {
-    target->m_kalman = new KalmanFilter();
-  }
   target->m_automatic = false;
   return;
 }
 
+template <UINT8 bit>
 bool ArpaTarget::FindContourFromInside(Polar* pol) {  // moves pol to contour of blob
   // true if success
   // false when failed
@@ -370,16 +204,16 @@ bool ArpaTarget::FindContourFromInside(Polar* pol) {  // moves pol to contour of
   if (rad >= RETURNS_PER_LINE - 1 || rad < 3) {
     return false;
   }
-  if (!(Pix(ang, rad))) {
+  if (!(Pix<bit>(ang, rad))) {
     return false;
   }
-  while (Pix(ang, rad)) {
+  while (Pix<bit>(ang, rad)) {
     ang--;
   }
   ang++;
   pol->angle = ang;
   // check if the blob has the required min contour length
-  if (MultiPix(ang, rad)) {
+  if (MultiPix<bit>(ang, rad)) {
     return true;
   } else {
     return false;
@@ -393,34 +227,17 @@ bool ArpaTarget::FindContourFromInside(Polar* pol) {  // moves pol to contour of
  *
  * Returns 0 if ok, or a small integer on error (but nothing is done with this)
  */
+template <UINT8 bit>
 int ArpaTarget::GetContour(Polar* pol) {
-  wxCriticalSectionLocker lock(ArpaTarget::m_ri->m_exclusive);
-  // the 4 possible translations to move from a point on the contour to the next
-  Polar transl[4];  //   = { 0, 1,   1, 0,   0, -1,   -1, 0 };
-  transl[0].angle = 0;
-  transl[0].r = 1;
-
-  transl[1].angle = 1;
-  transl[1].r = 0;
-
-  transl[2].angle = 0;
-  transl[2].r = -1;
-
-  transl[3].angle = -1;
-  transl[3].r = 0;
-
-  int count = 0;
+  // called from RadarArpa::RefreshArpaTargets, so RadarInfo::m_exclusive is already held
+  HistoryPixel<RadarInfo::line_history, bit> pix(m_ri->m_history);
+  ContourRecorder<ContourPoint> contour(m_contour, MAX_CONTOUR_LENGTH);
   Polar start = *pol;
-  Polar current = *pol;
-  int aa;
-  int rr;
-
-  bool succes = false;
-  int index = 0;
-  m_max_r = current;
-  m_max_angle = current;
-  m_min_r = current;
-  m_min_angle = current;
+
+  m_max_r = start;
+  m_max_angle = start;
+  m_min_r = start;
+  m_min_angle = start;
   // check if p inside blob
   if (start.r >= RETURNS_PER_LINE - 1) {
     return 1;  // return code 1, r too large
@@ -428,71 +245,23 @@ int ArpaTarget::GetContour(Polar* pol) {
   if (start.r < 4) {
     return 2;  // return code 2, r too small
   }
-  if (!Pix(start.angle, start.r)) {
+  if (!pix(start.angle, start.r)) {
     return 3;  // return code 3, starting point outside blob
   }
-  // first find the orientation of border point p
-  for (int i = 0; i < 4; i++) {
-    index = i;
-    aa = current.angle + transl[index].angle;
-    rr = current.r + transl[index].r;
-    //  if (rr > 511) return 13;  // r too large
-    succes = !Pix(aa, rr);
-    if (succes) break;
-  }
-  if (!succes) {
-    return 4;  // return code 4, starting point not on contour
-  }
-  index += 1;  // determines starting direction
-  if (index > 3) index -= 4;
-
-  while (current.r != start.r || current.angle != start.angle || count == 0) {
-    // try all translations to find the next point
-    // start with the "left most" translation relative to the previous one
-    index += 3;  // we will turn left all the time if possible
-    for (int i = 0; i < 4; i++) {
-      if (index > 3) index -= 4;
-      aa = current.angle + transl[index].angle;
-      rr = current.r + transl[index].r;
-      succes = Pix(aa, rr);
-      if (succes) {
-        // next point found
-
-        break;
-      }
-      index += 1;
-    }
-    if (!succes) {
-      LOG_INFO(wxT("BR24radar_pi::RadarArpa::GetContour no next point found count= %i"), count);
+  switch (TraceContour(pix, start.angle, start.r, contour)) {
+    case CONTOUR_NOT_ON_EDGE:
+      return 4;  // return code 4, starting point not on contour
+    case CONTOUR_NO_NEXT_POINT:
+      LOG_INFO(wxT("BR24radar_pi::RadarArpa::GetContour no next point found count= %i"), contour.m_count);
       return 7;  // return code 7, no next point found
-    }
-    // next point found
-    current.angle = aa;
-    current.r = rr;
-    if (count < MAX_CONTOUR_LENGTH - 2) {
-      m_contour[count] = current;
-    }
-    if (count == MAX_CONTOUR_LENGTH - 2) {
-      m_contour[count] = start;  // shortcut to the beginning for drawing the contour
-      current = start;           // this will cause the while to terminate
-    }
-    if (count < MAX_CONTOUR_LENGTH - 1) {
-      count++;
-    }
-    if (current.angle > m_max_angle.angle) {
-      m_max_angle = current;
-    }
-    if (current.angle < m_min_angle.angle) {
-      m_min_angle = current;
-    }
-    if (current.r > m_max_r.r) {
-      m_max_r = current;
-    }
-    if (current.r < m_min_r.r) {
-      m_min_r = current;
-    }
+    default:
+      break;
   }
-  m_contour_length = count;
+  m_max_angle.angle = contour.m_max_angle;
+  m_min_angle.angle = contour.m_min_angle;
+  m_max_r.r = contour.m_max_r;
+  m_min_r.r = contour.m_min_r;
+  m_contour_length = contour.m_count;
   //  CalculateCentroid(*target);    we better use the real centroid instead of the average, todo
   if (m_min_angle.angle < 0) {
     m_min_angle.angle += LINES_PER_ROTATION;
@@ -513,163 +282,239 @@ int ArpaTarget::GetContour(Polar* pol) {
   return 0;  //  success, blob found
 }
 
-void RadarArpa::DrawContour(ArpaTarget* target) {
-  // should be improved using vertex arrays
-  PolarToCartesianLookupTable* polarLookup;
-  if (target->m_lost_count > 0) {
-    return;  // don't draw targets that were not seen last sweep
+void RadarArpa::DrawArpaTargets() {
+  wxCriticalSectionLocker lock(m_snapshot_lock);
+
+  if (m_published.vertices.empty()) {
+    return;
   }
-  polarLookup = GetPolarToCartesianLookupTable();
+
   wxColor arpa = m_pi->m_settings.arpa_colour;
   glColor4ub(arpa.Red(), arpa.Green(), arpa.Blue(), arpa.Alpha());
   glLineWidth(3.0);
 
   glEnableClientState(GL_VERTEX_ARRAY);
+  glVertexPointer(2, GL_FLOAT, 0, &m_published.vertices[0]);
+  for (size_t i = 0; i < m_published.targets.size(); i++) {
+    ArpaTargetSnapshot* t = &m_published.targets[i];
+    if (t->vertex_count > 0) {
+      glDrawArrays(GL_LINE_STRIP, t->first_vertex, t->vertex_count);
+    }
+  }
+  glDisableClientState(GL_VERTEX_ARRAY);  // disable vertex arrays
+}
 
-  double vertex_array[2 * MAX_CONTOUR_LENGTH + 1];
-  for (int i = 0; i < target->m_contour_length; i++) {
-    int angle = MOD_ROTATION2048(target->m_contour[i].angle - 512);
-    int radius = target->m_contour[i].r;
-    if (radius <= 0 || radius >= RETURNS_PER_LINE) {
-      LOG_INFO(wxT("BR24radar_pi: wrong values in DrawContour"));
-      return;
+// Copy what DrawArpaTargets needs into m_building and make that the published snapshot.
+// Must be called with m_exclusive held.
+void RadarArpa::PublishSnapshot() {
+  PolarToCartesianLookupTable* polarLookup = GetPolarToCartesianLookupTable();
+  GLfloat scale = (GLfloat)m_ri->m_range_meters / RETURNS_PER_LINE;
+
+  m_building.targets.clear();
+  m_building.vertices.clear();
+  for (size_t i = 0; i < m_targets.Size(); i++) {
+    ArpaTarget* target = m_targets[i];
+    if (target->m_status == LOST) continue;
+
+    ArpaTargetSnapshot t;
+    t.id = target->m_id;
+    t.lat = target->m_position.lat;
+    t.lon = target->m_position.lon;
+    t.status = target->m_status;
+    t.first_vertex = m_building.vertices.size() / 2;
+    t.vertex_count = 0;
+    if (target->m_lost_count == 0) {  // don't draw targets that were not seen last sweep
+      int n;
+      for (n = 0; n < target->m_contour_length; n++) {
+        int angle = MOD_ROTATION2048(target->m_contour[n].angle - 512);
+        int radius = target->m_contour[n].r;
+        if (radius <= 0 || radius >= RETURNS_PER_LINE) {
+          LOG_INFO(wxT("BR24radar_pi: wrong values in contour of ARPA target"));
+          m_building.vertices.resize(2 * t.first_vertex);
+          break;
+        }
+        m_building.vertices.push_back(polarLookup->GetX(angle, radius) * scale);
+        m_building.vertices.push_back(polarLookup->GetY(angle, radius) * scale);
+      }
+      if (n == target->m_contour_length) {
+        t.vertex_count = n;
+      }
     }
-    vertex_array[2 * i] = polarLookup->x[angle][radius] * m_ri->m_range_meters / RETURNS_PER_LINE;
-    vertex_array[2 * i + 1] = polarLookup->y[angle][radius] * m_ri->m_range_meters / RETURNS_PER_LINE;
+    m_building.targets.push_back(t);
   }
 
-  glVertexPointer(2, GL_DOUBLE, 0, vertex_array);
-  glDrawArrays(GL_LINE_STRIP, 0, target->m_contour_length);
+  wxCriticalSectionLocker lock(m_snapshot_lock);
+  m_published.targets.swap(m_building.targets);
+  m_published.vertices.swap(m_building.vertices);
+}
 
-  glDisableClientState(GL_VERTEX_ARRAY);  // disable vertex arrays
+void RadarArpa::CleanUpLostTargets() {
+  // remove targets with status LOST from the store
+  size_t i = 0;
+  while (i < m_targets.Size()) {
+    if (m_targets[i]->m_status == LOST) {
+      m_index.Remove(m_targets[i]->m_lane);
+      m_targets.Remove(i);  // this moves the last target to i, so check i again
+    } else {
+      i++;
+    }
+  }
+}
 
-// following displays expected position with crosses that indicate the size of the search area
-// for debugging only
-
-#ifdef MARPA_DEBUG
-  // draw expected pos for test
-  int angle = MOD_ROTATION2048(target->expected.angle - 512);
-  int radius = target->expected.r;
-
-  double xx;
-  double yy;
-  int dist_a = (int)(326. / (double)radius * TARGET_SEARCH_RADIUS2 / 2.);
-  int dist_r = (int)((double)TARGET_SEARCH_RADIUS2 / 2.);
-  glColor4ub(0, 250, 0, 250);
-  if (radius < 511 - dist_r && radius > dist_r) {
-    xx = polarLookup->x[MOD_ROTATION2048(angle)][radius - dist_r] * m_ri->m_range_meters / RETURNS_PER_LINE;
-    yy = polarLookup->y[MOD_ROTATION2048(angle)][radius - dist_r] * m_ri->m_range_meters / RETURNS_PER_LINE;
-    glVertex2f(xx, yy);
-    xx = polarLookup->x[MOD_ROTATION2048(angle)][radius + dist_r] * m_ri->m_range_meters / RETURNS_PER_LINE;
-    yy = polarLookup->y[MOD_ROTATION2048(angle)][radius + dist_r] * m_ri->m_range_meters / RETURNS_PER_LINE;
-    glVertex2f(xx, yy);
-    xx = polarLookup->x[MOD_ROTATION2048(angle - dist_a)][radius] * m_ri->m_range_meters / RETURNS_PER_LINE;
-    yy = polarLookup->y[MOD_ROTATION2048(angle - dist_a)][radius] * m_ri->m_range_meters / RETURNS_PER_LINE;
-    glVertex2f(xx, yy);
-    xx = polarLookup->x[MOD_ROTATION2048(angle + dist_a)][radius] * m_ri->m_range_meters / RETURNS_PER_LINE;
-    yy = polarLookup->y[MOD_ROTATION2048(angle + dist_a)][radius] * m_ri->m_range_meters / RETURNS_PER_LINE;
-    glVertex2f(xx, yy);
-  }
-#endif
+// Run the Kalman filters queued by ArpaTarget::RefreshTarget and complete those refreshes,
+// then move the refreshed targets in the index and take out the ones that got lost. CPA and
+// the TTM sentences follow once, in ReportTargets, after all passes of a refresh.
+void RadarArpa::FinishRefresh() {
+  m_targets.RunKalman();
+  for (size_t i = 0; i < m_targets.Size(); i++) {
+    ArpaTarget* target = m_targets[i];
+    bool refreshed = target->m_refresh_pending;
+    target->FinishRefresh();
+    if (target->m_status == LOST) {
+      m_index.Remove(target->m_lane);
+    } else if (refreshed) {
+      m_index.Set(target->m_lane, target->m_polar.angle, target->m_polar.r);
+    }
+  }
 }
 
-void RadarArpa::DrawArpaTargets() {
-  for (int i = 0; i < m_number_of_targets; i++) {
-    if (!m_targets[i]) continue;
-    if (m_targets[i]->m_status != LOST) {
-      DrawContour(m_targets[i]);
+// CPA of the targets that were refreshed, relative to own ship's course and speed over ground,
+// then the TTM sentences of those targets and the number of targets that sound the CPA alarm
+void RadarArpa::ReportTargets() {
+  double now = wxGetUTCTimeMillis().ToDouble() / 1000.;
+  double sog;
+  double cog;
+  if (m_pi->GetOwnShipMotion(&sog, &cog)) {
+    double v = sog * 1852. / 3600.;  // m/s
+    m_targets.RunCpa(v * cos(deg2rad(cog)), v * sin(deg2rad(cog)), now);
+  } else {
+    m_targets.InvalidateCpa();
+  }
+  for (size_t i = 0; i < m_targets.Size(); i++) {
+    ArpaTarget* target = m_targets[i];
+    if (target->m_ttm_pending) {
+      target->m_ttm_pending = false;
+      target->PassARPAtoOCPN(&target->m_polar, target->m_ttm_status);
     }
   }
+
+  if (m_pi->m_settings.cpa_alarm_nm > 0.) {
+    m_cpa_alarms = m_targets.CountDangerous(now, m_pi->m_settings.cpa_alarm_nm * 1852., m_pi->m_settings.tcpa_alarm_minutes * 60.);
+  } else {
+    m_cpa_alarms = 0;
+  }
 }
 
-void RadarArpa::CleanUpLostTargets() {
-  // remove targets with status LOST and put them at the end
-  // adjust m_number_of_targets
-  int ii = 0;
-  while (ii < m_number_of_targets) {
-    if (m_targets[ii]) {
-      if (m_targets[ii]->m_status == LOST) {
-        // we keep the lost target for later use, destruction and construction is expensive
-        ArpaTarget* lost = m_targets[ii];
-        int len = sizeof(ArpaTarget*);
-        // move rest of larget list up to keep them in sequence
-        memmove(&m_targets[ii], &m_targets[ii] + 1, (m_number_of_targets - ii) * len);
-        m_number_of_targets--;
-        // set the lost target at the last position
-        m_targets[m_number_of_targets] = lost;
-      } else {
-        ii++;
-      }
+// The index holds the targets by their position in the radar image, so after a change of
+// range all of them are placed again. Targets that are not refreshed in a sweep keep the
+// place they had relative to own ship at their last refresh. range_meters is not 0.
+void RadarArpa::IndexTargets(int range_meters) {
+  Position own_pos;
+
+  m_index.Clear();
+  m_index_range = 0;
+  if (!m_pi->GetRadarPosition(&own_pos.lat, &own_pos.lon)) {
+    return;  // try again at the next refresh
+  }
+  for (size_t i = 0; i < m_targets.Size(); i++) {
+    ArpaTarget* target = m_targets[i];
+    if (target->m_status == LOST || target->m_status == FOR_DELETION) {
+      continue;
     }
+    target->m_polar = Pos2Polar(target->m_position, own_pos, range_meters);
+    m_index.Set(target->m_lane, target->m_polar.angle, target->m_polar.r);
   }
+  m_index_range = range_meters;
 }
 
 void RadarArpa::RefreshArpaTargets() {
+  wxCriticalSectionLocker lock(m_exclusive);
+
+  if (m_clear_contours) {
+    m_clear_contours = false;
+    for (size_t i = 0; i < m_targets.Size(); i++) {
+      m_targets[i]->m_contour_length = 0;
+    }
+  }
+
   CleanUpLostTargets();
+
+  // The receive thread sets the range to 0 when the radar stops sending spokes, so read it once
+  int range_meters;
+  {
+    wxCriticalSectionLocker ri_lock(m_ri->m_exclusive);  // always after our own m_exclusive
+    range_meters = m_ri->m_range_meters;
+  }
+  if (range_meters != 0 && m_index_range != range_meters) {
+    IndexTargets(range_meters);
+  }
   int target_to_delete = -1;
   // find a target with status FOR_DELETION if it is there
-  for (int i = 0; i < m_number_of_targets; i++) {
-    if (!m_targets[i]) continue;
+  for (size_t i = 0; i < m_targets.Size(); i++) {
     if (m_targets[i]->m_status == FOR_DELETION) {
       target_to_delete = i;
     }
   }
   if (target_to_delete != -1) {
-    // delete the target that is closest to the target with status FOR_DELETION
-    Position* deletePosition = &m_targets[target_to_delete]->m_position;
-    double min_dist = 1000;
-    int del_target = -1;
-    for (int i = 0; i < m_number_of_targets; i++) {
-      if (!m_targets[i]) continue;
-      if (i == target_to_delete || m_targets[i]->m_status == LOST) continue;
-      double dif_lat = deletePosition->lat - m_targets[i]->m_position.lat;
-      double dif_lon = (deletePosition->lon - m_targets[i]->m_position.lon) * cos(deg2rad(deletePosition->lat));
-      double dist2 = dif_lat * dif_lat + dif_lon * dif_lon;
-      if (dist2 < min_dist) {
-        min_dist = dist2;
-        del_target = i;
+    // delete the target that is closest to the target with status FOR_DELETION,
+    // the marker itself is not in the index; without a range there is no image to find it in
+    ArpaTarget* marker = m_targets[target_to_delete];
+    Position own_pos;
+    if (range_meters != 0 && m_pi->GetRadarPosition(&own_pos.lat, &own_pos.lon)) {
+      Polar pol = Pos2Polar(marker->m_position, own_pos, range_meters);
+      int lane = m_index.Nearest(pol.angle, pol.r);
+      if (lane != -1) {
+        m_targets.AtLane(lane)->SetStatusLost();
       }
     }
-    // del_target is the index of the target closest to target with index target_to_delete
-    if (del_target != -1) {
-      m_targets[del_target]->SetStatusLost();
-    }
-    m_targets[target_to_delete]->SetStatusLost();
+    marker->SetStatusLost();
     // now first clean up the lost targets again
     CleanUpLostTargets();
   }
 
-  ArpaTarget t;
-  KalmanFilter k;
-  // main target refresh loop
+  // The refresh and search passes read the times and positions of the history lines and clear
+  // the bits of the blobs they find, so the spoke process thread must not change them meanwhile.
+  {
+    wxCriticalSectionLocker ri_lock(m_ri->m_exclusive);  // always after our own m_exclusive
 
-  // pass 1 of target refresh
-  int dist = TARGET_SEARCH_RADIUS1;
-  for (int i = 0; i < m_number_of_targets; i++) {
-    if (!m_targets[i]) {
-      LOG_INFO(wxT("BR24radar_pi:  error target non existent i=%i"), i);
-      continue;
+    // main target refresh loop
+
+    // pass 1 of target refresh
+    int dist = TARGET_SEARCH_RADIUS1;
+    for (size_t i = 0; i < m_targets.Size(); i++) {
+      m_targets[i]->m_pass_nr = PASS1;
+      if (m_targets[i]->m_pass1_result == NOT_FOUND_IN_PASS1) continue;
+      m_targets[i]->RefreshTarget(dist);
+      if (m_targets[i]->m_pass1_result == NOT_FOUND_IN_PASS1) {
+      }
     }
-    m_targets[i]->m_pass_nr = PASS1;
-    if (m_targets[i]->m_pass1_result == NOT_FOUND_IN_PASS1) continue;
-    m_targets[i]->RefreshTarget(dist);
-    if (m_targets[i]->m_pass1_result == NOT_FOUND_IN_PASS1) {
+    FinishRefresh();
+
+    // pass 2 of target refresh
+    dist = TARGET_SEARCH_RADIUS2;
+    for (size_t i = 0; i < m_targets.Size(); i++) {
+      if (m_targets[i]->m_pass1_result == UNKNOWN) continue;
+      m_targets[i]->m_pass_nr = PASS2;
+      m_targets[i]->RefreshTarget(dist);
     }
-  }
-
-  // pass 2 of target refresh
-  dist = TARGET_SEARCH_RADIUS2;
-  for (int i = 0; i < m_number_of_targets; i++) {
-    if (!m_targets[i]) {
-      LOG_INFO(wxT("BR24radar_pi: error target non existent i=%i"), i);
-      continue;
+    FinishRefresh();
+
+    // The targets have now been refreshed up to SCAN_MARGIN (pass 2: + 100) spokes behind the beam,
+    // and have cleared the pixels of their blobs. Blobs further back that are still set are new targets.
+    // Only the blobs that the sweep watermark passed since the previous refresh are taken.
+    m_labeller.TakeBlobs(3 * SCAN_MARGIN, m_new_blobs);
+    if (!m_new_blobs.empty()) {
+      for (int i = 0; i < GUARD_ZONES; i++) m_ri->m_guard_zone[i]->SearchTargets(m_new_blobs);
+      SearchPolygonZones(m_new_blobs);
+      m_new_blobs.clear();
     }
-    if (m_targets[i]->m_pass1_result == UNKNOWN) continue;
-    m_targets[i]->m_pass_nr = PASS2;
-    m_targets[i]->RefreshTarget(dist);
+    FinishRefresh();  // of the new targets
+    ReportTargets();
   }
 
-  for (int i = 0; i < GUARD_ZONES; i++) m_ri->m_guard_zone[i]->SearchTargets();
+  FlushReports();
+
+  PublishSnapshot();
 }
 
 void ArpaTarget::RefreshTarget(int dist) {
@@ -730,8 +575,8 @@ void ArpaTarget::RefreshTarget(int dist) {
   x_local.lon = (m_position.lon - own_pos.lon) * 60. * 1852. * cos(deg2rad(own_pos.lat));  // in meters
   x_local.dlat_dt = m_position.dlat_dt;                                                    // meters / sec
   x_local.dlon_dt = m_position.dlon_dt;                                                    // meters / sec
-  m_kalman->Predict(&x_local, delta_t);  // x_local is new estimated local position of the target
-                                         // now set the polar to expected angular position from the expected local position
+  m_kalman->Predict(m_lane, &x_local, delta_t);  // x_local is new estimated local position of the target
+                                                 // now set the polar to expected angular position from the expected local position
   pol.angle = (int)(atan2(x_local.lon, x_local.lat) * LINES_PER_ROTATION / (2. * PI));
   if (pol.angle < 0) pol.angle += LINES_PER_ROTATION;
   pol.r =
@@ -747,7 +592,7 @@ void ArpaTarget::RefreshTarget(int dist) {
   // now search for the target at the expected polar position in pol
   int dist1 = dist;
   Polar back = pol;
-  if (GetTarget(&pol, dist1)) {
+  if (GetTarget<HISTORY_UNCLAIMED>(&pol, dist1)) {
     ResetPixels();
     // target too large? (land masses?) get rid of it
     if (abs(back.r - pol.r) > MAX_TARGET_DIAMETER || abs(m_max_r.r - m_min_r.r) > MAX_TARGET_DIAMETER ||
@@ -789,8 +634,9 @@ void ArpaTarget::RefreshTarget(int dist) {
 
     // Kalman filter to  calculate the apostriori local position and speed based on found position (pol)
     if (m_status > 1) {
-      m_kalman->Update_P();
-      m_kalman->SetMeasurement(&pol, &x_local, &m_expected, m_ri->m_range_meters);  // pol is measured position in polar coordinates
+      m_kalman->QueueUpdate_P(m_lane);
+      m_kalman->QueueMeasurement(m_lane, &pol, &x_local, &m_expected, m_ri->m_range_meters);  // pol is measured position in polar coordinates
+      m_measured = true;
     }
 
     // x_local expected position in local coordinates
@@ -801,16 +647,14 @@ void ArpaTarget::RefreshTarget(int dist) {
   // target not found
   else {
     // target not found
-    if (m_pass_nr == PASS1) m_kalman->Update_P();
+    if (m_pass_nr == PASS1) m_kalman->QueueUpdate_P(m_lane);
     // check if the position of the target has been taken by another target, a duplicate
     // if duplicate, handle target as not found but don't do pass 2 (= search in the surroundings)
     bool duplicate = false;
-    m_check_for_duplicate = true;
-    if (m_pass_nr == PASS1 && GetTarget(&pol, dist1)) {
+    if (m_pass_nr == PASS1 && GetTarget<HISTORY_RETURN>(&pol, dist1)) {
       m_pass1_result = UNKNOWN;
       duplicate = true;
     }
-    m_check_for_duplicate = false;
 
     // not found in pass 1
     // try again later in pass 2 with a larger distance
@@ -838,6 +682,27 @@ void ArpaTarget::RefreshTarget(int dist) {
       return;
     }
   }  // end of target not found
+
+  // The Kalman filters of all targets run together after the search, then RadarArpa calls FinishRefresh
+  m_x_local = x_local;
+  m_own_pos = own_pos;
+  m_refresh_pending = true;
+}
+
+void ArpaTarget::FinishRefresh() {
+  if (!m_refresh_pending) {
+    return;
+  }
+  m_refresh_pending = false;
+
+  Polar pol;
+  Position own_pos = m_own_pos;
+  LocalPosition x_local = m_x_local;
+  if (m_measured) {
+    m_kalman->GetMeasurement(m_lane, &x_local);
+    m_measured = false;
+  }
+
   // set pass1_result ready for next sweep
   m_pass1_result = UNKNOWN;
   if (m_status != ACQUIRE1) {
@@ -887,6 +752,7 @@ void ArpaTarget::RefreshTarget(int dist) {
 
     // send target data to OCPN
     pol = Pos2Polar(m_position, own_pos, m_ri->m_range_meters);
+    m_polar = pol;
     if (m_status >= STATUS_TO_OCPN) {
       OCPN_target_status s;
       if (m_status >= Q_NUM) s = Q;
@@ -901,7 +767,12 @@ void ArpaTarget::RefreshTarget(int dist) {
       double dist2target = (4.0 / 100) * (double)pol.r / (double)RETURNS_PER_LINE * m_ri->m_range_meters;
       posOffset += dist2target;
       if (m_pi->FindAIS_at_arpaPos(m_position.lat, m_position.lon, posOffset)) s = L;
-      PassARPAtoOCPN(&pol, s);
+
+      // RadarArpa::FinishRefresh sends the TTM when it has computed the CPA
+      m_cpa->Queue(m_lane, (m_position.lat - own_pos.lat) * 60. * 1852.,
+                   (m_position.lon - own_pos.lon) * 60. * 1852. * cos(deg2rad(own_pos.lat)), m_position.dlat_dt, m_position.dlon_dt);
+      m_ttm_status = s;
+      m_ttm_pending = true;
     }
   }
   return;
@@ -909,12 +780,13 @@ void ArpaTarget::RefreshTarget(int dist) {
 
 #define PIX(aa, rr)       \
   if (rr > 510) continue; \
-  if (MultiPix(aa, rr)) { \
+  if (MultiPix<bit>(aa, rr)) { \
     pol->angle = aa;      \
     pol->r = rr;          \
     return true;          \
   }
 
+template <UINT8 bit>
 bool ArpaTarget::FindNearestContour(Polar* pol, int dist) {
   // make a search pattern along a square
   // returns the position of the nearest blob found in pol
@@ -953,7 +825,14 @@ void RadarArpa::CalculateCentroid(ArpaTarget* target) {
 ArpaTarget::ArpaTarget(br24radar_pi* pi, RadarInfo* ri) {
   ArpaTarget::m_ri = ri;
   m_pi = pi;
+  m_id = 0;
   m_kalman = 0;
+  m_cpa = 0;
+  m_lane = -1;
+  m_refresh_pending = false;
+  m_measured = false;
+  m_ttm_pending = false;
+  m_ttm_status = Q;
   m_status = LOST;
   m_contour_length = 0;
   m_lost_count = 0;
@@ -970,7 +849,16 @@ ArpaTarget::ArpaTarget(br24radar_pi* pi, RadarInfo* ri) {
 }
 
 ArpaTarget::ArpaTarget() {
+  m_ri = 0;
+  m_pi = 0;
+  m_id = 0;
   m_kalman = 0;
+  m_cpa = 0;
+  m_lane = -1;
+  m_refresh_pending = false;
+  m_measured = false;
+  m_ttm_pending = false;
+  m_ttm_status = Q;
   m_status = LOST;
   m_contour_length = 0;
   m_lost_count = 0;
@@ -986,6 +874,12 @@ ArpaTarget::ArpaTarget() {
   m_pass_nr = PASS1;
 }
 
+void ArpaTarget::set(br24radar_pi* pi, RadarInfo* ri) {
+  m_pi = pi;
+  m_ri = ri;
+}
+
+template <UINT8 bit>
 bool ArpaTarget::GetTarget(Polar* pol, int dist1) {
   // general target refresh
   bool contour_found = false;
@@ -1001,15 +895,15 @@ bool ArpaTarget::GetTarget(Polar* pol, int dist1) {
   int a = pol->angle;
   int r = pol->r;
 
-  if (Pix(a, r)) {
-    contour_found = FindContourFromInside(pol);
+  if (Pix<bit>(a, r)) {
+    contour_found = FindContourFromInside<bit>(pol);
   } else {
-    contour_found = FindNearestContour(pol, dist);
+    contour_found = FindNearestContour<bit>(pol, dist);
   }
   if (!contour_found) {
     return false;
   }
-  int cont = GetContour(pol);
+  int cont = GetContour<bit>(pol);
   if (cont != 0) {
     // LOG_ARPA(wxT("BR24radar_pi: ARPA contour error %d at %d, %d"), cont, a, r);
     // reset pol in case of error
@@ -1021,73 +915,53 @@ bool ArpaTarget::GetTarget(Polar* pol, int dist1) {
 }
 
 void ArpaTarget::PassARPAtoOCPN(Polar* pol, OCPN_target_status status) {
-  wxString s_TargID, s_Bear_Unit, s_Course_Unit;
-  wxString s_speed, s_course, s_Dist_Unit, s_status;
-  wxString s_bearing;
-  wxString s_distance;
-  wxString s_target_name;
-  wxString nmea;
-  char sentence[90];
-  char checksum = 0;
-  char* p;
-
-  s_Bear_Unit = wxEmptyString;  // Bearing Units  R or empty
-  s_Course_Unit = wxT("T");     // Course type R; Realtive T; true
-  s_Dist_Unit = wxT("N");       // Speed/Distance Unit K, N, S N= NM/h = Knots
+  ArpaReport report;
+  wxLongLong now = wxGetUTCTimeMillis();
+  double cpa;
+  double tcpa;
+
+  report.target_id = m_target_id;
+  report.automatic = m_automatic;
   switch (status) {
     case Q:
-      s_status = wxT("Q");  // yellow
+      report.status = 'Q';  // yellow
       break;
     case T:
-      s_status = wxT("T");  // green
+      report.status = 'T';  // green
       break;
-    case L:
-      s_status = wxT("L");  // ?
+    default:
+      report.status = 'L';
       break;
   }
-
-  double dist = (double)pol->r / (double)RETURNS_PER_LINE * (double)m_ri->m_range_meters / 1852.;
-  double bearing = (double)pol->angle * 360. / (double)LINES_PER_ROTATION;
-
-  if (bearing < 0) bearing += 360;
-  s_TargID = wxString::Format(wxT("%4i"), m_target_id);
-  s_speed = wxString::Format(wxT("%4.2f"), m_speed_kn);
-  s_course = wxString::Format(wxT("%3.1f"), m_course);
-  if (m_automatic) {
-    s_target_name = wxString::Format(wxT("ARPA%4i"), m_target_id);
-  } else {
-    s_target_name = wxString::Format(wxT("MARPA%4i"), m_target_id);
-  }
-  s_distance = wxString::Format(wxT("%f"), dist);
-  s_bearing = wxString::Format(wxT("%f"), bearing);
-
-  /* Code for TTM follows. Send speed and course using TTM*/
-  snprintf(sentence, sizeof(sentence), "RATTM,%2s,%s,%s,%s,%s,%s,%s, , ,%s,%s,%s, ",
-           (const char*)s_TargID.mb_str(),       // 1 target id
-           (const char*)s_distance.mb_str(),     // 2 Targ distance
-           (const char*)s_bearing.mb_str(),      // 3 Bearing fr own ship.
-           (const char*)s_Bear_Unit.mb_str(),    // 4 Brearing unit ( T = true)
-           (const char*)s_speed.mb_str(),        // 5 Target speed
-           (const char*)s_course.mb_str(),       // 6 Target Course.
-           (const char*)s_Course_Unit.mb_str(),  // 7 Course ref T // 8 CPA Not used // 9 TCPA Not used
-           (const char*)s_Dist_Unit.mb_str(),    // 10 S/D Unit N = knots/Nm
-           (const char*)s_target_name.mb_str(),  // 11 Target name
-           (const char*)s_status.mb_str());      // 12 Target Status L/Q/T // 13 Ref N/A
-
-  for (p = sentence; *p; p++) {
-    checksum ^= *p;
-  }
-  nmea.Printf(wxT("$%s*%02X\r\n"), sentence, (unsigned)checksum);
-  PushNMEABuffer(nmea);
+  report.distance_nm = (double)pol->r / (double)RETURNS_PER_LINE * (double)m_ri->m_range_meters / 1852.;
+  report.bearing = (double)pol->angle * 360. / (double)LINES_PER_ROTATION;
+  if (report.bearing < 0) report.bearing += 360;
+  report.speed_kn = m_speed_kn;
+  report.course = m_course;
+  report.has_cpa = m_cpa && m_cpa->Get(m_lane, now.ToDouble() / 1000., &cpa, &tcpa);
+  if (report.has_cpa) {
+    report.cpa_nm = cpa / 1852.;
+    report.tcpa_min = tcpa / 60.;
+  }
+  report.lat = m_position.lat;
+  report.lon = m_position.lon;
+  report.time_of_day_ms = (now % 86400000).ToLong();
+
+  m_ri->m_arpa->QueueReport(report);
 }
 
 void ArpaTarget::SetStatusLost() {
   m_contour_length = 0;
   m_lost_count = 0;
   if (m_kalman) {
-    // reset kalman filter, don't delete it, too  expensive
-    m_kalman->ResetFilter();
+    m_kalman->ResetFilter(m_lane);
+  }
+  if (m_cpa) {
+    m_cpa->ResetLane(m_lane);
   }
+  m_refresh_pending = false;
+  m_measured = false;
+  m_ttm_pending = false;
   if (m_status >= STATUS_TO_OCPN) {
     Polar p;
     p.angle = 0;
@@ -1107,18 +981,91 @@ void ArpaTarget::SetStatusLost() {
 }
 
 void RadarArpa::DeleteAllTargets() {
-  for (int i = 0; i < m_number_of_targets; i++) {
-    if (!m_targets[i]) continue;
+  wxCriticalSectionLocker lock(m_exclusive);
+
+  for (size_t i = 0; i < m_targets.Size(); i++) {
     m_targets[i]->SetStatusLost();
   }
+  FlushReports();
+}
+
+// Called with m_exclusive held. The sentences are collected in m_reports, which keeps its
+// size, so reporting a target doesn't allocate anything until they are passed to OpenCPN.
+void RadarArpa::QueueReport(const ArpaReport& report) {
+  const char* sentence = FormatTTM(&m_nmea, report);
+  m_reports.insert(m_reports.end(), sentence, sentence + m_nmea.Length() + 1);
+  if (m_pi->m_settings.arpa_send_tll) {
+    sentence = FormatTLL(&m_nmea, report);
+    m_reports.insert(m_reports.end(), sentence, sentence + m_nmea.Length() + 1);
+  }
+}
+
+// Pass the sentences of QueueReport to OpenCPN, one after the other
+void RadarArpa::FlushReports() {
+  for (size_t i = 0; i < m_reports.size(); i += strlen(&m_reports[i]) + 1) {
+    PushNMEABuffer(wxString::FromAscii(&m_reports[i]));
+  }
+  m_reports.clear();
+}
+
+// Make a target of a new blob found in a zone with ARPA on. Returns 1 if it did, 0 if the blob
+// is part of a target already and -1 when there can be no more targets.
+int RadarArpa::AcquireBlob(const SweepBlob& blob) {
+  // The refresh of the existing targets clears the pixels of their blobs, so if the
+  // seed is still set the blob doesn't belong to a target yet.
+  if (!Pix(blob.seed_angle, blob.seed_r)) {
+    return 0;
+  }
+  if (GetTargetCount() >= MAX_NUMBER_OF_TARGETS - 1) {
+    LOG_INFO(wxT("BR24radar_pi: No more scanning for ARPA targets in loop, maximum number of targets reached"));
+    return -1;
+  }
+
+  // A target that was not found in this sweep still has this blob's pixels set; don't
+  // start a second target on it.
+  Polar pol;
+  pol.angle = (int)blob.centroid_angle;
+  pol.r = (int)blob.centroid_r;
+  if (IsNearTarget(pol, DISTANCE_BETWEEN_TARGETS + (blob.max_r - blob.min_r) / 2)) {
+    return 0;
+  }
+
+  pol.angle = blob.seed_angle;
+  pol.r = blob.seed_r;
+  return AcquireNewARPATarget(pol, 0) == -1 ? -1 : 1;
+}
+
+// Acquire the new blobs whose centroid is in a polygon zone with ARPA on
+void RadarArpa::SearchPolygonZones(const vector<SweepBlob>& blobs) {
+  if (!m_ri->m_polygon_zones.AnyArpa() || blobs.empty()) {
+    return;
+  }
+  if (GetTargetCount() >= MAX_NUMBER_OF_TARGETS - 2) {
+    LOG_INFO(wxT("BR24radar_pi: No more scanning for ARPA targets, maximum number of targets reached"));
+    return;
+  }
+  if (!m_pi->m_settings.show || m_ri->m_state.GetValue() != RADAR_TRANSMIT) {
+    return;
+  }
+
+  for (size_t i = 0; i < blobs.size(); i++) {
+    const SweepBlob& blob = blobs[i];
+
+    if (!m_ri->m_polygon_zones.InArpaZone(MOD_ROTATION2048((int)blob.centroid_angle), (int)blob.centroid_r)) {
+      continue;
+    }
+    if (AcquireBlob(blob) < 0) {
+      return;
+    }
+  }
 }
 
 int RadarArpa::AcquireNewARPATarget(Polar pol, int status) {
   // acquires new target from mouse click position
   // no contour taken yet
   // target status status, normally 0, if dummy target to delete a target -2
-  // returns in X metric coordinates of click
-  // constructs Kalman filter
+  // returns the id of the new target, or -1
+  // called by GuardZone::SearchTargets from RefreshArpaTargets, so m_exclusive is already held
   Position own_pos;
   Position target_pos;
 
@@ -1126,21 +1073,16 @@ int RadarArpa::AcquireNewARPATarget(Polar pol, int status) {
     return -1;
   }
   target_pos = Polar2Pos(pol, own_pos, m_ri->m_range_meters);
-  // make new target or re-use an existing one with status == lost
-  int i;
-  if (m_number_of_targets < MAX_NUMBER_OF_TARGETS - 1 || (m_number_of_targets == MAX_NUMBER_OF_TARGETS - 1 && status == -2)) {
-    if (!m_targets[m_number_of_targets]) {
-      m_targets[m_number_of_targets] = new ArpaTarget(m_pi, m_ri);
-    }
-    i = m_number_of_targets;
-    m_number_of_targets++;
-  } else {
-    LOG_INFO(wxT("BR24radar_pi: RadarArpa:: Error, max targets exceeded %i"), m_number_of_targets);
+  // make new target or re-use one that was lost
+  ArpaTarget* target = 0;
+  if (m_targets.Size() < MAX_NUMBER_OF_TARGETS - 1 || status == FOR_DELETION) {
+    target = m_targets.Add(m_pi, m_ri);
+  }
+  if (!target) {
+    LOG_INFO(wxT("BR24radar_pi: RadarArpa:: Error, max targets exceeded %i"), (int)m_targets.Size());
     return -1;
   }
 
-  ArpaTarget* target = m_targets[i];
-
   target->m_position = target_pos;  // Expected position
   target->m_position.time = wxGetUTCTimeMillis();
   target->m_position.dlat_dt = 0.;
@@ -1151,14 +1093,14 @@ int RadarArpa::AcquireNewARPATarget(Polar pol, int status) {
   target->m_min_angle.angle = 0;
   target->m_max_r.r = 0;
   target->m_min_r.r = 0;
-  if (!target->m_kalman) {
-    target->m_kalman = new KalmanFilter();
-  }
-  target->m_check_for_duplicate = false;
   target->m_automatic = true;
   target->m_target_id = 0;
   target->RefreshTarget(TARGET_SEARCH_RADIUS1);
-  return i;
+  if (target->m_status != LOST) {
+    // in the index straight away, so the next blobs of this search are checked against it
+    m_index.Set(target->m_lane, target->m_expected.angle, target->m_expected.r);
+  }
+  return target->m_id;
 }
 
 void ArpaTarget::ResetPixels() {
@@ -1171,10 +1113,56 @@ void ArpaTarget::ResetPixels() {
   }
 }
 
+// Called by RadarInfo with RadarInfo::m_exclusive held, so it must not take RadarArpa::m_exclusive;
+// the targets' contours are cleared by the next refresh instead.
 void RadarArpa::ClearContours() {
-  for (int i = 0; i < m_number_of_targets; i++) {
-    m_targets[i]->m_contour_length = 0;
+  m_clear_contours = true;
+  m_labeller.Reset();  // its blobs are in the old range
+
+  wxCriticalSectionLocker lock(m_snapshot_lock);
+  m_published.targets.clear();
+  m_published.vertices.clear();
+}
+
+// Called by RadarInfo::ProcessRadarSpoke with RadarInfo::m_exclusive held, after the ARPA bits of
+// the history line have been set.
+void RadarArpa::LabelSpoke(SpokeBearing bearing, UINT8* line) {
+  bool search = false;
+
+  for (int i = 0; i < GUARD_ZONES; i++) {
+    if (m_ri->m_guard_zone[i]->m_arpa_on) {
+      search = true;
+    }
+  }
+  if (m_ri->m_polygon_zones.AnyArpa()) {
+    search = true;
+  }
+  if (search) {
+    m_labeller.ProcessSpoke(bearing, line, m_ri->m_min_contour_length);
+  } else if (!m_labeller.IsIdle()) {
+    m_labeller.Reset();
+  }
+}
+
+void* ArpaThread::Entry(void) {
+  LOG_VERBOSE(wxT("BR24radar_pi: %s ARPA thread starting"), m_ri->m_name.c_str());
+
+  while (!m_stop) {
+    // Also refresh without new spokes so that targets time out when the radar data stops
+    m_sweep_progress.WaitTimeout(MILLIS_PER_WAIT);
+    if (!m_stop) {
+      m_ri->m_arpa->RefreshArpaTargets();
+    }
   }
+
+  LOG_VERBOSE(wxT("BR24radar_pi: %s ARPA thread stopping"), m_ri->m_name.c_str());
+  m_is_shutdown = true;
+  return 0;
+}
+
+void ArpaThread::Shutdown(void) {
+  m_stop = true;
+  m_sweep_progress.Post();
 }
 
 PLUGIN_END_NAMESPACE
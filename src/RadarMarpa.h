@@ -36,9 +36,14 @@
 //#include "pi_common.h"
 
 //#include "br24radar_pi.h"
+#include "ArpaNmea.h"
+#include "ContourTracer.h"
+#include "Cpa.h"
 #include "Kalman.h"
 #include "Matrix.h"
+#include "PolarGrid.h"
 #include "RadarInfo.h"
+#include "SweepLabeller.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
@@ -46,7 +51,8 @@ PLUGIN_BEGIN_NAMESPACE
 class KalmanFilter;
 class Position;
 
-#define MAX_NUMBER_OF_TARGETS (100)
+#define MAX_NUMBER_OF_TARGETS (2000)  // upper limit of the target store, so memory use stays bounded
+#define TARGET_POOL_BLOCK (64)         // targets are allocated this many at a time
 #define TARGET_SEARCH_RADIUS1 (2)   // radius of target search area for pass 1 (on top of the size of the blob)
 #define TARGET_SEARCH_RADIUS2 (15)  // radius of target search area for pass 1
 #define SCAN_MARGIN (150)           // number of lines that a next scan of the target may have moved
@@ -69,6 +75,7 @@ class Position;
 #define STATUS_TO_OCPN (5)            // First status to be send to OCPN
 #define START_UP_SPEED (0.5)          // maximum allowed speed (m/sec) for new target, real format with .
 #define DISTANCE_BETWEEN_TARGETS (4)  // minimum separation between targets
+#define ARPA_SPOKES_PER_REFRESH (64)  // the ARPA thread refreshes the targets every this many spokes
 
 typedef int target_status;
 enum OCPN_target_status {
@@ -92,35 +99,56 @@ Position Polar2Pos(Polar pol, Position own_ship, double range);
 
 Polar Pos2Polar(Position p, Position own_ship, int range);
 
+// A point of a target contour, in a quarter of the size of a Polar
+struct ContourPoint {
+  short angle;
+  short r;
+};
+
 enum TargetProcessStatus { UNKNOWN, NOT_FOUND_IN_PASS1 };
 enum PassN { PASS1, PASS2 };
 
 class ArpaTarget {
   friend class RadarArpa;  // Allow RadarArpa access to private members
+  friend class ArpaTargetStore;
 
  public:
   ArpaTarget(br24radar_pi* pi, RadarInfo* ri);
   ArpaTarget();
   ~ArpaTarget();
 
+  // The contour functions are instantiated for the history bit they look at:
+  // HISTORY_UNCLAIMED to find the target, HISTORY_RETURN to check for a duplicate.
+  template <UINT8 bit>
   int GetContour(Polar* p);
   void set(br24radar_pi* pi, RadarInfo* ri);
+  template <UINT8 bit>
   bool FindNearestContour(Polar* pol, int dist);
+  template <UINT8 bit>
   bool FindContourFromInside(Polar* p);
+  template <UINT8 bit>
   bool GetTarget(Polar* pol, int dist);
   void RefreshTarget(int dist);
+  void FinishRefresh();
   void PassARPAtoOCPN(Polar* p, OCPN_target_status s);
   void SetStatusLost();
   void ResetPixels();
   void GetSpeed();
-  bool Pix(int ang, int rad);
+  template <UINT8 bit>
+  bool Pix(int ang, int rad) {
+    return HistoryPixel<RadarInfo::line_history, bit>(m_ri->m_history)(ang, rad);
+  }
+  template <UINT8 bit>
   bool MultiPix(int ang, int rad);
 
  private:
   RadarInfo* m_ri;
   br24radar_pi* m_pi;
-  KalmanFilter* m_kalman;
-  int m_target_id;
+  KalmanBatch* m_kalman;  // filter is lane m_lane of the store's batch
+  CpaBatch* m_cpa;        // and so is the CPA
+  int m_lane;
+  int m_id;         // stable while the target is in the store, see ArpaTargetStore
+  int m_target_id;  // number in the TTM sentences, given when the target is passed to OpenCPN
   target_status m_status;
   Position m_position;   // holds actual position of target
   double m_speed_kn;     // Average speed of target. TODO: Merge with m_position.speed?
@@ -128,47 +156,164 @@ class ArpaTarget {
   double m_course;
   int m_stationary;  // number of sweeps target was stationary
   int m_lost_count;
-  bool m_check_for_duplicate;
   TargetProcessStatus m_pass1_result;
   PassN m_pass_nr;
-  Polar m_contour[MAX_CONTOUR_LENGTH + 1];  // contour of target, only valid immediately after finding it
+  ContourPoint m_contour[MAX_CONTOUR_LENGTH + 1];  // contour of target, only valid immediately after finding it
   int m_contour_length;
   Polar m_max_angle, m_min_angle, m_max_r, m_min_r;  // charasterictics of contour
 
   Polar m_expected;
+  Polar m_polar;  // position relative to own ship at the last refresh, as kept in RadarArpa::m_index
+
+  // Saved by RefreshTarget for FinishRefresh, after the Kalman filters have run
+  bool m_refresh_pending;
+  bool m_measured;  // a measurement was queued for the Kalman filter
+  LocalPosition m_x_local;
+  Position m_own_pos;
+
+  // Set by FinishRefresh, the TTM is sent by RadarArpa once the CPA is known
+  bool m_ttm_pending;
+  OCPN_target_status m_ttm_status;
 
   bool m_automatic;  // True for ARPA, false for MARPA.
 };
 
+// What the renderer needs of a target. A copy is made by the ARPA thread after each refresh,
+// so drawing never looks at the targets themselves.
+struct ArpaTargetSnapshot {
+  int id;  // ArpaTarget::m_id
+  double lat;
+  double lon;
+  target_status status;
+  size_t first_vertex;  // index of the first contour vertex in ArpaSnapshot::vertices
+  size_t vertex_count;  // 0 if the contour is not to be drawn
+};
+
+struct ArpaSnapshot {
+  vector<ArpaTargetSnapshot> targets;
+  vector<GLfloat> vertices;  // x, y pairs of all target contours in meters from the radar
+};
+
+/*
+ * The targets of one radar. They are allocated in blocks of TARGET_POOL_BLOCK and are only
+ * freed when the radar goes away; a removed target goes on a free list to be re-used.
+ * The live targets are kept at the front of an array of pointers, so removing one swaps
+ * the last one into its place. Its index can change, but a target keeps its id until it
+ * is removed.
+ */
+class ArpaTargetStore {
+ public:
+  ArpaTargetStore() { m_next_id = 1; }
+  ~ArpaTargetStore();
+
+  ArpaTarget* Add(br24radar_pi* pi, RadarInfo* ri);  // returns 0 when MAX_NUMBER_OF_TARGETS are in use
+  void Remove(size_t i);
+  size_t Size() const { return m_live.size(); }
+  ArpaTarget* operator[](size_t i) const { return m_live[i]; }
+  ArpaTarget* AtLane(int lane) const { return &m_blocks[lane / TARGET_POOL_BLOCK][lane % TARGET_POOL_BLOCK]; }
+  void RunKalman() { m_kalman.Run(); }
+  void RunCpa(double own_v_north, double own_v_east, double now) { m_cpa.Run(own_v_north, own_v_east, now); }
+  void InvalidateCpa() { m_cpa.Invalidate(); }
+  int CountDangerous(double now, double max_cpa, double max_tcpa) const { return m_cpa.CountDangerous(now, max_cpa, max_tcpa); }
+
+ private:
+  vector<ArpaTarget*> m_live;
+  vector<ArpaTarget*> m_free;
+  vector<ArpaTarget*> m_blocks;  // each TARGET_POOL_BLOCK targets
+  KalmanBatch m_kalman;          // the filters of all targets, one lane per target
+  CpaBatch m_cpa;                // CPA and TCPA of all targets, same lanes
+  int m_next_id;
+};
+
 class RadarArpa {
  public:
   RadarArpa(br24radar_pi* pi, RadarInfo* ri);
   ~RadarArpa();
   void DrawArpaTargets();
-  void RefreshArpaTargets();
+  void RefreshArpaTargets();  // Only called by the ARPA thread, or by the renderer if that thread did not start
   int AcquireNewARPATarget(Polar pol, int status);
   void AcquireNewMARPATarget(Position p);
   void DeleteTarget(Position p);
-  bool MultiPix(int ang, int rad);
   void DeleteAllTargets();
   void CleanUpLostTargets();
   void RadarLost() {
     DeleteAllTargets();  // Let ARPA targets disappear
   }
   void ClearContours();
-  int GetTargetCount() { return m_number_of_targets; }
+  void LabelSpoke(SpokeBearing bearing, UINT8* line);
+  int GetTargetCount() { return (int)m_targets.Size(); }
+  bool Pix(int ang, int rad);
+  bool IsNearTarget(Polar pol, int dist) { return m_index.FindWithin(pol.angle, pol.r, dist) >= 0; }
+  int AcquireBlob(const SweepBlob& blob);  // by the zone searches, -1 when no more targets can be made
+  int GetCpaAlarmCount() { return m_cpa_alarms; }
+  void QueueReport(const ArpaReport& report);  // by ArpaTarget::PassARPAtoOCPN
 
  private:
-  int m_number_of_targets;
-  ArpaTarget* m_targets[MAX_NUMBER_OF_TARGETS];
+  wxCriticalSection m_exclusive;  // protects the targets, taken before RadarInfo::m_exclusive
+  ArpaTargetStore m_targets;
+  PolarGrid m_index;  // the targets that are not lost, by Kalman lane, see IndexTargets
+  int m_index_range;  // m_ri->m_range_meters that the positions in m_index are for
+  volatile bool m_clear_contours;  // set by ClearContours, handled by the next refresh
+  volatile int m_cpa_alarms;       // targets that come within the CPA alarm limits, read by CheckGuardZoneBogeys
+
+  SweepLabeller m_labeller;       // protected by RadarInfo::m_exclusive
+  vector<SweepBlob> m_new_blobs;  // blobs taken from m_labeller for the guard zones to search
+
+  wxCriticalSection m_snapshot_lock;  // protects m_published
+  ArpaSnapshot m_published;           // read by DrawArpaTargets
+  ArpaSnapshot m_building;            // filled by PublishSnapshot, then swapped with m_published
+
+  NmeaBuilder m_nmea;
+  vector<char> m_reports;  // NMEA sentences to pass to OpenCPN, each ends with a 0
 
   br24radar_pi* m_pi;
   RadarInfo* m_ri;
 
   void AcquireOrDeleteMarpaTarget(Position p, int status);
+  void FinishRefresh();
+  void ReportTargets();
+  void FlushReports();
+  void IndexTargets(int range_meters);
+  void SearchPolygonZones(const vector<SweepBlob>& blobs);
   void CalculateCentroid(ArpaTarget* t);
-  void DrawContour(ArpaTarget* t);
-  bool Pix(int ang, int rad);
+  void PublishSnapshot();
+};
+
+/*
+ * Refreshing the targets traces contours, runs the Kalman filters and searches the
+ * guard zones for new targets. It runs in its own thread per radar, woken by the spoke
+ * process thread every ARPA_SPOKES_PER_REFRESH spokes, so it follows the antenna sweep
+ * instead of the screen refresh rate and doesn't hold up the GUI thread.
+ */
+class ArpaThread : public wxThread {
+ public:
+  ArpaThread(br24radar_pi* pi, RadarInfo* ri) : wxThread(wxTHREAD_JOINABLE), m_pi(pi), m_ri(ri), m_sweep_progress(0, 1) {
+    Create(1024 * 1024);  // Stack size, be liberal
+    m_spokes = 0;
+    m_stop = false;
+    m_is_shutdown = false;
+  }
+
+  void* Entry(void);
+  void Shutdown(void);
+
+  // Called by the spoke process thread for every spoke
+  void SpokeProcessed() {
+    if (++m_spokes >= ARPA_SPOKES_PER_REFRESH) {
+      m_spokes = 0;
+      m_sweep_progress.Post();
+    }
+  }
+
+  volatile bool m_is_shutdown;
+
+ private:
+  br24radar_pi* m_pi;
+  RadarInfo* m_ri;
+
+  wxSemaphore m_sweep_progress;  // Posted every ARPA_SPOKES_PER_REFRESH spokes
+  int m_spokes;  // Spokes processed since the last post
+  volatile bool m_stop;
 };
 
 PLUGIN_END_NAMESPACE
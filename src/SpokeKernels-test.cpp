@@ -0,0 +1,154 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include <iostream>
+
+#include "SpokeKernels.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define TEST_LEN (RETURNS_PER_LINE - 1)  // Trails are computed for one return less, so not a multiple of a vector
+#define TEST_MAX_AGE (241)               // TRAIL_MAX_REVOLUTIONS
+#define TEST_SPOKES (20000)
+
+static unsigned int seed = 1;
+
+static UINT8 Random() {
+  seed = seed * 1103515245 + 12345;
+  return (UINT8)(seed >> 16);
+}
+
+// Check that all kernel sets this CPU can run produce the same bytes as the scalar one
+int main() {
+  int ret = 0;
+  const SpokeKernels *kernels[4];
+  size_t n = GetAvailableSpokeKernels(kernels, ARRAY_SIZE(kernels));
+  UINT8 trail_colour[UINT8_MAX + 1];
+
+  for (size_t c = 0; c < ARRAY_SIZE(trail_colour); c++) {
+    trail_colour[c] = Random() & 31;
+  }
+
+  for (size_t k = 1; k < n; k++) {
+    int errors = 0;
+
+    for (int spoke = 0; spoke < TEST_SPOKES && !errors; spoke++) {
+      UINT8 data[TEST_LEN], expected_data[TEST_LEN];
+      UINT8 trail[TEST_LEN], expected_trail[TEST_LEN];
+      UINT8 history[TEST_LEN], expected_history[TEST_LEN];
+      uint64_t strong[STRONG_WORDS], expected_strong[STRONG_WORDS];
+      UINT8 threshold = Random();
+      bool recolour = (spoke & 1) != 0;
+
+      for (int r = 0; r < TEST_LEN; r++) {
+        data[r] = Random();
+        trail[r] = Random();
+        if (trail[r] > 200) {  // Make sure we hit the limit and 0 often enough
+          trail[r] = (trail[r] & 1) ? TEST_MAX_AGE : 0;
+        }
+      }
+      if ((spoke & 7) == 0) {
+        threshold = (spoke & 8) ? 0 : 255;
+      }
+      memcpy(expected_data, data, sizeof(data));
+      memcpy(expected_trail, trail, sizeof(trail));
+
+      size_t len = TEST_LEN - (spoke & 127);  // Also lines that end in the middle of a word
+      kernels[0]->strong(data, len, threshold, expected_strong);
+      kernels[k]->strong(data, len, threshold, strong);
+      kernels[0]->history(expected_data, expected_history, TEST_LEN, threshold);
+      kernels[k]->history(data, history, TEST_LEN, threshold);
+      kernels[0]->trails(expected_data, expected_trail, TEST_LEN, threshold, TEST_MAX_AGE, trail_colour, recolour);
+      kernels[k]->trails(data, trail, TEST_LEN, threshold, TEST_MAX_AGE, trail_colour, recolour);
+
+      if (memcmp(history, expected_history, sizeof(history))) {
+        cout << "ERROR: " << kernels[k]->name << " history differs from scalar, threshold=" << (int)threshold << "\n";
+        errors++;
+      }
+      if (memcmp(strong, expected_strong, sizeof(strong))) {
+        cout << "ERROR: " << kernels[k]->name << " strong bits differ from scalar, threshold=" << (int)threshold << "\n";
+        errors++;
+      }
+      if (memcmp(trail, expected_trail, sizeof(trail))) {
+        cout << "ERROR: " << kernels[k]->name << " trails differ from scalar, threshold=" << (int)threshold << "\n";
+        errors++;
+      }
+      if (memcmp(data, expected_data, sizeof(data))) {
+        cout << "ERROR: " << kernels[k]->name << " trail colours differ from scalar, threshold=" << (int)threshold << "\n";
+        errors++;
+      }
+    }
+    cout << "INFO: " << kernels[k]->name << (errors ? " FAILED\n" : " matches scalar\n");
+    if (errors) {
+      ret = 1;
+    }
+  }
+
+  // The count of a span of strong bits against counting the bytes
+  int count_errors = 0;
+  for (int spoke = 0; spoke < TEST_SPOKES / 10; spoke++) {
+    UINT8 data[RETURNS_PER_LINE];
+    uint64_t strong[STRONG_WORDS];
+    UINT8 threshold = Random();
+
+    for (int r = 0; r < RETURNS_PER_LINE; r++) {
+      data[r] = Random();
+    }
+    kernels[0]->strong(data, RETURNS_PER_LINE, threshold, strong);
+    size_t start = Random() * 2;
+    size_t end = start + ((spoke & 1) ? Random() % 64 : Random() * 2);
+    end = MIN(end, RETURNS_PER_LINE);
+    size_t expected = 0;
+    for (size_t r = start; r < end; r++) {
+      expected += data[r] >= threshold;
+    }
+    if (CountStrong(strong, start, end) != expected) {
+      count_errors++;
+    }
+  }
+  if (count_errors) {
+    cout << "ERROR: CountStrong differs from counting returns " << count_errors << " times\n";
+    ret = 1;
+  }
+
+  cout << "INFO: Using " << GetSpokeKernels()->name << " kernels\n";
+  if (ret == 0) {
+    cout << "INFO: TEST PASSED\n";
+  } else {
+    cout << "ERROR: TEST FAILED\n";
+  }
+  exit(ret);
+}
+
+PLUGIN_END_NAMESPACE
+
+int main() { br24::main(); }
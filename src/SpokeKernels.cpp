@@ -0,0 +1,374 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include "SpokeKernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPOKE_KERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(SPOKE_KERNELS_SSE2) && defined(__GNUC__)
+#define SPOKE_KERNELS_AVX2
+#include <immintrin.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SPOKE_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+PLUGIN_BEGIN_NAMESPACE
+
+/*
+ * Scalar versions. These are the reference for the others, and also finish the
+ * last few bytes that do not fill a whole vector.
+ */
+
+static void HistoryScalar(const UINT8 *data, UINT8 *history, size_t len, UINT8 threshold) {
+  for (size_t r = 0; r < len; r++) {
+    history[r] = (data[r] >= threshold) ? 192 : 0;
+  }
+}
+
+static void TrailsScalar(UINT8 *data, UINT8 *trail, size_t len, UINT8 threshold, UINT8 max_age, const UINT8 *trail_colour,
+                         bool recolour) {
+  for (size_t r = 0; r < len; r++) {
+    if (data[r] >= threshold) {
+      trail[r] = 1;
+    } else {
+      if (trail[r] > 0 && trail[r] < max_age) {
+        trail[r]++;
+      }
+      if (recolour) {
+        data[r] = trail_colour[trail[r]];
+      }
+    }
+  }
+}
+
+// Pack the returns from r on, r is a multiple of 64
+static void StrongTail(const UINT8 *data, size_t r, size_t len, UINT8 threshold, uint64_t *strong) {
+  for (size_t w = r / 64; w < STRONG_WORDS; w++) {
+    strong[w] = 0;
+  }
+  for (; r < len; r++) {
+    if (data[r] >= threshold) {
+      strong[r / 64] |= (uint64_t)1 << (r % 64);
+    }
+  }
+}
+
+static void StrongScalar(const UINT8 *data, size_t len, UINT8 threshold, uint64_t *strong) {
+  StrongTail(data, 0, len, threshold, strong);
+}
+
+static const SpokeKernels SCALAR_KERNELS = {"scalar", HistoryScalar, TrailsScalar, StrongScalar};
+
+/*
+ * SSE2, 16 returns at a time. SSE2 has no unsigned byte compare, so a >= b is
+ * computed as max(a, b) == a. There is no byte table lookup either, so the trail
+ * colours are looked up one by one and then merged back in.
+ */
+
+#ifdef SPOKE_KERNELS_SSE2
+
+static void HistorySSE2(const UINT8 *data, UINT8 *history, size_t len, UINT8 threshold) {
+  const __m128i thr = _mm_set1_epi8((char)threshold);
+  const __m128i hist = _mm_set1_epi8((char)192);
+  size_t r = 0;
+
+  for (; r + 16 <= len; r += 16) {
+    __m128i d = _mm_loadu_si128((const __m128i *)(data + r));
+    __m128i strong = _mm_cmpeq_epi8(_mm_max_epu8(d, thr), d);
+    _mm_storeu_si128((__m128i *)(history + r), _mm_and_si128(strong, hist));
+  }
+  HistoryScalar(data + r, history + r, len - r, threshold);
+}
+
+static void TrailsSSE2(UINT8 *data, UINT8 *trail, size_t len, UINT8 threshold, UINT8 max_age, const UINT8 *trail_colour,
+                       bool recolour) {
+  const __m128i thr = _mm_set1_epi8((char)threshold);
+  const __m128i max = _mm_set1_epi8((char)max_age);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi8(1);
+  const __m128i ones = _mm_set1_epi8((char)0xff);
+  size_t r = 0;
+
+  for (; r + 16 <= len; r += 16) {
+    __m128i d = _mm_loadu_si128((const __m128i *)(data + r));
+    __m128i t = _mm_loadu_si128((const __m128i *)(trail + r));
+    __m128i strong = _mm_cmpeq_epi8(_mm_max_epu8(d, thr), d);
+    __m128i stopped = _mm_or_si128(_mm_cmpeq_epi8(t, zero), _mm_cmpeq_epi8(_mm_max_epu8(t, max), t));
+    __m128i aged = _mm_sub_epi8(t, _mm_andnot_si128(stopped, ones));  // -(-1) == +1
+    t = _mm_or_si128(_mm_and_si128(strong, one), _mm_andnot_si128(strong, aged));
+    _mm_storeu_si128((__m128i *)(trail + r), t);
+
+    if (recolour) {
+      UINT8 colour[16];
+      for (int i = 0; i < 16; i++) {
+        colour[i] = trail_colour[trail[r + i]];
+      }
+      __m128i c = _mm_loadu_si128((const __m128i *)colour);
+      _mm_storeu_si128((__m128i *)(data + r), _mm_or_si128(_mm_and_si128(strong, d), _mm_andnot_si128(strong, c)));
+    }
+  }
+  TrailsScalar(data + r, trail + r, len - r, threshold, max_age, trail_colour, recolour);
+}
+
+static inline uint64_t StrongMaskSSE2(const UINT8 *data, __m128i thr) {
+  __m128i d = _mm_loadu_si128((const __m128i *)data);
+  return (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(d, thr), d));
+}
+
+static void StrongSSE2(const UINT8 *data, size_t len, UINT8 threshold, uint64_t *strong) {
+  const __m128i thr = _mm_set1_epi8((char)threshold);
+  size_t r = 0;
+
+  for (; r + 64 <= len; r += 64) {
+    strong[r / 64] = StrongMaskSSE2(data + r, thr) | (StrongMaskSSE2(data + r + 16, thr) << 16) |
+                     (StrongMaskSSE2(data + r + 32, thr) << 32) | (StrongMaskSSE2(data + r + 48, thr) << 48);
+  }
+  StrongTail(data, r, len, threshold, strong);
+}
+
+static const SpokeKernels SSE2_KERNELS = {"sse2", HistorySSE2, TrailsSSE2, StrongSSE2};
+
+#endif
+
+/*
+ * AVX2, the same as SSE2 but 32 returns at a time. Compiled for AVX2 regardless of the
+ * compiler flags, and only used when the CPU says it has it.
+ */
+
+#ifdef SPOKE_KERNELS_AVX2
+
+TARGET_AVX2 static void HistoryAVX2(const UINT8 *data, UINT8 *history, size_t len, UINT8 threshold) {
+  const __m256i thr = _mm256_set1_epi8((char)threshold);
+  const __m256i hist = _mm256_set1_epi8((char)192);
+  size_t r = 0;
+
+  for (; r + 32 <= len; r += 32) {
+    __m256i d = _mm256_loadu_si256((const __m256i *)(data + r));
+    __m256i strong = _mm256_cmpeq_epi8(_mm256_max_epu8(d, thr), d);
+    _mm256_storeu_si256((__m256i *)(history + r), _mm256_and_si256(strong, hist));
+  }
+  HistoryScalar(data + r, history + r, len - r, threshold);
+}
+
+TARGET_AVX2 static void TrailsAVX2(UINT8 *data, UINT8 *trail, size_t len, UINT8 threshold, UINT8 max_age,
+                                   const UINT8 *trail_colour, bool recolour) {
+  const __m256i thr = _mm256_set1_epi8((char)threshold);
+  const __m256i max = _mm256_set1_epi8((char)max_age);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi8(1);
+  const __m256i ones = _mm256_set1_epi8((char)0xff);
+  size_t r = 0;
+
+  for (; r + 32 <= len; r += 32) {
+    __m256i d = _mm256_loadu_si256((const __m256i *)(data + r));
+    __m256i t = _mm256_loadu_si256((const __m256i *)(trail + r));
+    __m256i strong = _mm256_cmpeq_epi8(_mm256_max_epu8(d, thr), d);
+    __m256i stopped = _mm256_or_si256(_mm256_cmpeq_epi8(t, zero), _mm256_cmpeq_epi8(_mm256_max_epu8(t, max), t));
+    __m256i aged = _mm256_sub_epi8(t, _mm256_andnot_si256(stopped, ones));
+    t = _mm256_blendv_epi8(aged, one, strong);
+    _mm256_storeu_si256((__m256i *)(trail + r), t);
+
+    if (recolour) {
+      UINT8 colour[32];
+      for (int i = 0; i < 32; i++) {
+        colour[i] = trail_colour[trail[r + i]];
+      }
+      __m256i c = _mm256_loadu_si256((const __m256i *)colour);
+      _mm256_storeu_si256((__m256i *)(data + r), _mm256_blendv_epi8(c, d, strong));
+    }
+  }
+  TrailsScalar(data + r, trail + r, len - r, threshold, max_age, trail_colour, recolour);
+}
+
+TARGET_AVX2 static inline uint64_t StrongMaskAVX2(const UINT8 *data, __m256i thr) {
+  __m256i d = _mm256_loadu_si256((const __m256i *)data);
+  return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(d, thr), d));
+}
+
+TARGET_AVX2 static void StrongAVX2(const UINT8 *data, size_t len, UINT8 threshold, uint64_t *strong) {
+  const __m256i thr = _mm256_set1_epi8((char)threshold);
+  size_t r = 0;
+
+  for (; r + 64 <= len; r += 64) {
+    strong[r / 64] = StrongMaskAVX2(data + r, thr) | (StrongMaskAVX2(data + r + 32, thr) << 32);
+  }
+  StrongTail(data, r, len, threshold, strong);
+}
+
+static const SpokeKernels AVX2_KERNELS = {"avx2", HistoryAVX2, TrailsAVX2, StrongAVX2};
+
+#endif
+
+/*
+ * NEON, 16 returns at a time. On AArch64 the 256 byte colour table fits in four
+ * 64 byte TBL lookups, so the whole loop stays in vector registers.
+ */
+
+#ifdef SPOKE_KERNELS_NEON
+
+static void HistoryNEON(const UINT8 *data, UINT8 *history, size_t len, UINT8 threshold) {
+  const uint8x16_t thr = vdupq_n_u8(threshold);
+  const uint8x16_t hist = vdupq_n_u8(192);
+  size_t r = 0;
+
+  for (; r + 16 <= len; r += 16) {
+    uint8x16_t d = vld1q_u8(data + r);
+    vst1q_u8(history + r, vandq_u8(vcgeq_u8(d, thr), hist));
+  }
+  HistoryScalar(data + r, history + r, len - r, threshold);
+}
+
+#ifdef __aarch64__
+static inline uint8x16x4_t LoadTable64(const UINT8 *p) {
+  uint8x16x4_t table;
+
+  table.val[0] = vld1q_u8(p);
+  table.val[1] = vld1q_u8(p + 16);
+  table.val[2] = vld1q_u8(p + 32);
+  table.val[3] = vld1q_u8(p + 48);
+  return table;
+}
+#endif
+
+static void TrailsNEON(UINT8 *data, UINT8 *trail, size_t len, UINT8 threshold, UINT8 max_age, const UINT8 *trail_colour,
+                       bool recolour) {
+  const uint8x16_t thr = vdupq_n_u8(threshold);
+  const uint8x16_t max = vdupq_n_u8(max_age);
+  const uint8x16_t one = vdupq_n_u8(1);
+#ifdef __aarch64__
+  const uint8x16x4_t colour0 = LoadTable64(trail_colour);
+  const uint8x16x4_t colour1 = LoadTable64(trail_colour + 64);
+  const uint8x16x4_t colour2 = LoadTable64(trail_colour + 128);
+  const uint8x16x4_t colour3 = LoadTable64(trail_colour + 192);
+  const uint8x16_t step = vdupq_n_u8(64);
+#endif
+  size_t r = 0;
+
+  for (; r + 16 <= len; r += 16) {
+    uint8x16_t d = vld1q_u8(data + r);
+    uint8x16_t t = vld1q_u8(trail + r);
+    uint8x16_t strong = vcgeq_u8(d, thr);
+    uint8x16_t running = vandq_u8(vtstq_u8(t, t), vcltq_u8(t, max));
+    t = vbslq_u8(strong, one, vsubq_u8(t, running));  // running is 0xff, so this adds one
+    vst1q_u8(trail + r, t);
+
+    if (recolour) {
+#ifdef __aarch64__
+      // Out of range indices leave the lane alone, so each table only fills in its own 64 entries
+      uint8x16_t i = t;
+      uint8x16_t c = vqtbl4q_u8(colour0, i);
+      i = vsubq_u8(i, step);
+      c = vqtbx4q_u8(c, colour1, i);
+      i = vsubq_u8(i, step);
+      c = vqtbx4q_u8(c, colour2, i);
+      i = vsubq_u8(i, step);
+      c = vqtbx4q_u8(c, colour3, i);
+#else
+      UINT8 colour[16];
+      for (int i = 0; i < 16; i++) {
+        colour[i] = trail_colour[trail[r + i]];
+      }
+      uint8x16_t c = vld1q_u8(colour);
+#endif
+      vst1q_u8(data + r, vbslq_u8(strong, d, c));
+    }
+  }
+  TrailsScalar(data + r, trail + r, len - r, threshold, max_age, trail_colour, recolour);
+}
+
+// NEON has no movemask; weigh each byte with its bit and add up the bytes of each half
+static void StrongNEON(const UINT8 *data, size_t len, UINT8 threshold, uint64_t *strong) {
+  static const UINT8 weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+  const uint8x16_t weight = vld1q_u8(weights);
+  const uint8x16_t thr = vdupq_n_u8(threshold);
+  size_t r = 0;
+
+  for (; r + 64 <= len; r += 64) {
+    uint64_t word = 0;
+    for (int i = 0; i < 4; i++) {
+      uint8x16_t bits = vandq_u8(vcgeq_u8(vld1q_u8(data + r + i * 16), thr), weight);
+      uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(bits)));
+      word |= (vgetq_lane_u64(sum, 0) | (vgetq_lane_u64(sum, 1) << 8)) << (i * 16);
+    }
+    strong[r / 64] = word;
+  }
+  StrongTail(data, r, len, threshold, strong);
+}
+
+static const SpokeKernels NEON_KERNELS = {"neon", HistoryNEON, TrailsNEON, StrongNEON};
+
+#endif
+
+size_t GetAvailableSpokeKernels(const SpokeKernels **kernels, size_t max) {
+  size_t n = 0;
+
+  if (n < max) {
+    kernels[n++] = &SCALAR_KERNELS;
+  }
+#ifdef SPOKE_KERNELS_SSE2
+  if (n < max) {
+    kernels[n++] = &SSE2_KERNELS;
+  }
+#endif
+#ifdef SPOKE_KERNELS_AVX2
+  if (n < max && __builtin_cpu_supports("avx2")) {
+    kernels[n++] = &AVX2_KERNELS;
+  }
+#endif
+#ifdef SPOKE_KERNELS_NEON
+  if (n < max) {
+    kernels[n++] = &NEON_KERNELS;
+  }
+#endif
+  return n;
+}
+
+static const SpokeKernels *best_kernels = 0;
+
+const SpokeKernels *GetSpokeKernels() {
+  if (!best_kernels) {
+    const SpokeKernels *kernels[4];
+    size_t n = GetAvailableSpokeKernels(kernels, ARRAY_SIZE(kernels));
+
+    best_kernels = kernels[n - 1];  // Listed from slow to fast
+  }
+  return best_kernels;
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,109 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _SPOKEKERNELS_H_
+#define _SPOKEKERNELS_H_
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/*
+ * The byte-per-return loops of RadarInfo::ProcessRadarSpoke, written once as plain
+ * C++ and once for each vector instruction set we know about. They all produce
+ * exactly the same bytes; spoke-kernel-test checks this against the scalar version.
+ *
+ * GetSpokeKernels() picks the fastest set the CPU supports the first time it is
+ * called. SSE2 and NEON are compile time choices, AVX2 is checked at run time.
+ */
+
+// history[r] = 192 if data[r] >= threshold, else 0
+typedef void (*HistoryKernel)(const UINT8 *data, UINT8 *history, size_t len, UINT8 threshold);
+
+// Age the trail of each return: a return >= threshold sets it to 1, otherwise a trail that
+// is already running is incremented up to max_age. If recolour is set the returns below
+// the threshold are replaced by trail_colour[trail]; trail_colour must have 256 entries.
+typedef void (*TrailKernel)(UINT8 *data, UINT8 *trail, size_t len, UINT8 threshold, UINT8 max_age, const UINT8 *trail_colour,
+                            bool recolour);
+
+// One bit per return: bit r % 64 of strong[r / 64] = 1 if data[r] >= threshold. The bits from
+// len on are cleared, strong must have STRONG_WORDS words.
+typedef void (*StrongKernel)(const UINT8 *data, size_t len, UINT8 threshold, uint64_t *strong);
+
+#define STRONG_WORDS (RETURNS_PER_LINE / 64)
+
+struct SpokeKernels {
+  const char *name;
+  HistoryKernel history;
+  TrailKernel trails;
+  StrongKernel strong;
+};
+
+static inline size_t CountBits(uint64_t v) {
+#if defined(__GNUC__)
+  return (size_t)__builtin_popcountll(v);
+#else
+  v = v - ((v >> 1) & 0x5555555555555555ULL);
+  v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+  v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+  return (size_t)((v * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// The number of returns in [start, end) that are set in a line packed by a StrongKernel
+static inline size_t CountStrong(const uint64_t *strong, size_t start, size_t end) {
+  if (start >= end) {
+    return 0;
+  }
+  size_t first = start / 64;
+  size_t last = (end - 1) / 64;
+  uint64_t head = ~(uint64_t)0 << (start % 64);
+  uint64_t tail = ~(uint64_t)0 >> (63 - (end - 1) % 64);
+
+  if (first == last) {
+    return CountBits(strong[first] & head & tail);
+  }
+  size_t n = CountBits(strong[first] & head);
+  for (size_t w = first + 1; w < last; w++) {
+    n += CountBits(strong[w]);
+  }
+  return n + CountBits(strong[last] & tail);
+}
+
+extern const SpokeKernels *GetSpokeKernels();
+
+// All kernel sets this CPU can run, the scalar one first. Returns the number stored in kernels.
+extern size_t GetAvailableSpokeKernels(const SpokeKernels **kernels, size_t max);
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _SPOKEKERNELS_H_ */
@@ -0,0 +1,88 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include "SpokeQueue.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define MILLIS_PER_WAIT 250
+
+bool SpokeProcessThread::PushSpoke(SpokeBearing angle, SpokeBearing bearing, const UINT8 *data, size_t len, int range_meters,
+                                   wxLongLong time, double lat, double lon) {
+  QueuedSpoke *spoke = m_queue.Reserve();
+
+  if (!spoke) {
+    return false;
+  }
+  spoke->angle = angle;
+  spoke->bearing = bearing;
+  spoke->range_meters = range_meters;
+  spoke->time = time;
+  spoke->lat = lat;
+  spoke->lon = lon;
+  memcpy(spoke->data, data, MIN(len, sizeof(spoke->data)));
+  if (len < sizeof(spoke->data)) {
+    memset(spoke->data + len, 0, sizeof(spoke->data) - len);
+  }
+  m_queue.Commit();
+  return true;
+}
+
+void *SpokeProcessThread::Entry(void) {
+  LOG_VERBOSE(wxT("BR24radar_pi: %s spoke process thread starting"), m_ri->m_name.c_str());
+
+  while (!m_stop) {
+    m_spokes_ready.WaitTimeout(MILLIS_PER_WAIT);
+
+    QueuedSpoke *spoke;
+    while (!m_stop && (spoke = m_queue.Front()) != 0) {
+      {
+        wxCriticalSectionLocker lock(m_ri->m_exclusive);
+
+        m_ri->ProcessRadarSpoke(spoke->angle, spoke->bearing, spoke->data, RETURNS_PER_LINE, spoke->range_meters, spoke->time,
+                                spoke->lat, spoke->lon);
+      }
+      m_queue.Pop();
+    }
+  }
+
+  LOG_VERBOSE(wxT("BR24radar_pi: %s spoke process thread stopping"), m_ri->m_name.c_str());
+  m_is_shutdown = true;
+  return 0;
+}
+
+void SpokeProcessThread::Shutdown(void) {
+  m_stop = true;
+  m_spokes_ready.Post();
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,145 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _SPOKEQUEUE_H_
+#define _SPOKEQUEUE_H_
+
+#include "br24radar_pi.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/*
+ * The receive thread only decodes the radar frames and pushes the spokes into a
+ * SpokeQueue. A SpokeProcessThread per radar pops them and runs the expensive
+ * RadarInfo::ProcessRadarSpoke pipeline (history, guard zones, trails, drawing).
+ * This way a slow trail shift or draw buffer reallocation no longer stops us from
+ * reading the multicast socket.
+ *
+ * The queue is a fixed size single producer, single consumer ring buffer. It does
+ * not use any locks; m_head is only written by the producer and m_tail only by
+ * the consumer, and each publishes its index with release semantics.
+ */
+
+#if defined(__GNUC__)
+#define SPOKE_QUEUE_LOAD(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define SPOKE_QUEUE_STORE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#else
+// MSVC gives volatile accesses acquire/release semantics
+#define SPOKE_QUEUE_LOAD(p) (*(volatile size_t *)(p))
+#define SPOKE_QUEUE_STORE(p, v) (*(volatile size_t *)(p) = (v))
+#endif
+
+#define SPOKE_QUEUE_SIZE (LINES_PER_ROTATION)  // Must be a power of 2, this is 0.5 - 1 s of data
+#define SPOKE_QUEUE_MASK (SPOKE_QUEUE_SIZE - 1)
+
+struct QueuedSpoke {
+  SpokeBearing angle;
+  SpokeBearing bearing;
+  int range_meters;
+  wxLongLong time;
+  double lat;
+  double lon;
+  UINT8 data[RETURNS_PER_LINE];
+};
+
+class SpokeQueue {
+ public:
+  SpokeQueue() {
+    m_head = 0;
+    m_tail = 0;
+  }
+
+  // Producer side: returns the slot to fill, or 0 when the queue is full.
+  QueuedSpoke *Reserve() {
+    size_t head = m_head;
+    if (head - SPOKE_QUEUE_LOAD(&m_tail) >= SPOKE_QUEUE_SIZE) {
+      return 0;
+    }
+    return &m_spokes[head & SPOKE_QUEUE_MASK];
+  }
+  void Commit() { SPOKE_QUEUE_STORE(&m_head, m_head + 1); }
+
+  // Consumer side: returns the oldest spoke, or 0 when the queue is empty.
+  QueuedSpoke *Front() {
+    size_t tail = m_tail;
+    if (SPOKE_QUEUE_LOAD(&m_head) == tail) {
+      return 0;
+    }
+    return &m_spokes[tail & SPOKE_QUEUE_MASK];
+  }
+  void Pop() { SPOKE_QUEUE_STORE(&m_tail, m_tail + 1); }
+
+  // Can be called from either side, the result is only a snapshot.
+  size_t Depth() { return SPOKE_QUEUE_LOAD(&m_head) - SPOKE_QUEUE_LOAD(&m_tail); }
+
+ private:
+  // Keep the two indices on separate cache lines so producer and consumer do not fight over them.
+  size_t m_head;  // Next slot the producer will fill
+  char m_pad1[64 - sizeof(size_t)];
+  size_t m_tail;  // Next slot the consumer will read
+  char m_pad2[64 - sizeof(size_t)];
+
+  QueuedSpoke m_spokes[SPOKE_QUEUE_SIZE];
+};
+
+class SpokeProcessThread : public wxThread {
+ public:
+  SpokeProcessThread(br24radar_pi *pi, RadarInfo *ri) : wxThread(wxTHREAD_JOINABLE), m_pi(pi), m_ri(ri) {
+    Create(1024 * 1024);  // Stack size, be liberal
+    m_stop = false;
+    m_is_shutdown = false;
+  }
+
+  ~SpokeProcessThread() {}
+
+  void *Entry(void);
+  void Shutdown(void);
+
+  // Called by the receive thread
+  bool PushSpoke(SpokeBearing angle, SpokeBearing bearing, const UINT8 *data, size_t len, int range_meters, wxLongLong time,
+                 double lat, double lon);
+  void SpokesPushed() { m_spokes_ready.Post(); }
+
+  SpokeQueue m_queue;
+  volatile bool m_is_shutdown;
+
+ private:
+  br24radar_pi *m_pi;
+  RadarInfo *m_ri;
+
+  wxSemaphore m_spokes_ready;  // Posted by the receive thread after each frame
+  volatile bool m_stop;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _SPOKEQUEUE_H_ */
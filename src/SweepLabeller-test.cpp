@@ -0,0 +1,274 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include <algorithm>
+#include <iostream>
+
+#include "SweepLabeller.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define TEST_LAG (450)  // 3 * SCAN_MARGIN
+
+static UINT8 image[LINES_PER_ROTATION][RETURNS_PER_LINE];
+static int label[LINES_PER_ROTATION][RETURNS_PER_LINE];
+
+static unsigned int seed = 1;
+
+static unsigned int Random() {
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) & 0x7fff;
+}
+
+static void SetRect(int angle, int r, int spokes, int returns) {
+  for (int a = angle; a < angle + spokes; a++) {
+    for (int i = r; i < r + returns; i++) {
+      image[a % LINES_PER_ROTATION][i] = 192;
+    }
+  }
+}
+
+// Feed one rotation starting at 'start' and then enough empty spokes to complete all blobs
+static void Sweep(SweepLabeller &labeller, int start, int min_contour_length, vector<SweepBlob> &blobs) {
+  UINT8 empty[RETURNS_PER_LINE];
+
+  CLEAR_STRUCT(empty);
+  labeller.Reset();
+  for (int i = 0; i < LINES_PER_ROTATION; i++) {
+    int angle = (start + i) % LINES_PER_ROTATION;
+    labeller.ProcessSpoke(angle, image[angle], min_contour_length);
+  }
+  for (int i = 0; i <= TEST_LAG; i++) {
+    labeller.ProcessSpoke((start + i) % LINES_PER_ROTATION, empty, min_contour_length);
+  }
+  labeller.TakeBlobs(TEST_LAG, blobs);
+}
+
+// Same as Sweep, but take the blobs every 'step' spokes like the ARPA thread does, and check
+// that each blob is taken as soon as the beam is TEST_LAG spokes past it, and not before.
+static int SweepInSteps(SweepLabeller &labeller, int step, int min_contour_length, vector<SweepBlob> &blobs) {
+  UINT8 empty[RETURNS_PER_LINE];
+  int errors = 0;
+
+  CLEAR_STRUCT(empty);
+  labeller.Reset();
+  for (int i = 0; i <= LINES_PER_ROTATION + TEST_LAG; i++) {
+    int angle = i % LINES_PER_ROTATION;
+    labeller.ProcessSpoke(angle, i < LINES_PER_ROTATION ? image[angle] : empty, min_contour_length);
+    if (i % step == 0) {
+      size_t taken = blobs.size();
+      labeller.TakeBlobs(TEST_LAG, blobs);
+      for (size_t b = taken; b < blobs.size(); b++) {
+        int behind = i - blobs[b].max_angle;
+        if (behind < TEST_LAG || behind >= TEST_LAG + step) {
+          errors++;
+        }
+      }
+    }
+  }
+  return errors;
+}
+
+// Label the image with a flood fill, returns the area of each blob
+static vector<int> FloodFill(int first_angle, int last_angle) {
+  vector<int> areas;
+  vector<pair<int, int> > stack;
+
+  for (int a = 0; a < LINES_PER_ROTATION; a++) {
+    for (int r = 0; r < RETURNS_PER_LINE; r++) {
+      label[a][r] = 0;
+    }
+  }
+  for (int a = first_angle; a <= last_angle; a++) {
+    for (int r = 2; r <= RETURNS_PER_LINE - 2; r++) {
+      if (!(image[a][r] & 128) || label[a][r]) {
+        continue;
+      }
+      int area = 0;
+      areas.push_back(0);
+      stack.push_back(make_pair(a, r));
+      label[a][r] = (int)areas.size();
+      while (!stack.empty()) {
+        int pa = stack.back().first;
+        int pr = stack.back().second;
+        stack.pop_back();
+        area++;
+        int na[4] = {pa - 1, pa + 1, pa, pa};
+        int nr[4] = {pr, pr, pr - 1, pr + 1};
+        for (int n = 0; n < 4; n++) {
+          if (na[n] < first_angle || na[n] > last_angle || nr[n] < 2 || nr[n] > RETURNS_PER_LINE - 2) {
+            continue;
+          }
+          if ((image[na[n]][nr[n]] & 128) && !label[na[n]][nr[n]]) {
+            label[na[n]][nr[n]] = (int)areas.size();
+            stack.push_back(make_pair(na[n], nr[n]));
+          }
+        }
+      }
+      areas.back() = area;
+    }
+  }
+  return areas;
+}
+
+int main() {
+  int ret = 0;
+  SweepLabeller labeller;
+  vector<SweepBlob> blobs;
+
+  // A 5 spoke by 4 return rectangle
+  CLEAR_STRUCT(image);
+  SetRect(100, 50, 5, 4);
+  Sweep(labeller, 0, 0, blobs);
+  if (blobs.size() != 1) {
+    cout << "ERROR: rectangle found as " << blobs.size() << " blobs\n";
+    ret = 1;
+  } else {
+    SweepBlob *b = &blobs[0];
+    if (b->min_angle != 100 || b->max_angle != 104 || b->min_r != 50 || b->max_r != 53 || b->area != 20 ||
+        b->contour_length != 14 || b->centroid_angle != 102. || b->centroid_r != 51.5 || b->seed_angle != 100 || b->seed_r != 50) {
+      cout << "INFO: angle " << b->min_angle << ".." << b->max_angle << " r " << b->min_r << ".." << b->max_r << " area " << b->area
+           << " contour " << b->contour_length << " centroid " << b->centroid_angle << "," << b->centroid_r << "\n";
+      cout << "ERROR: rectangle has wrong properties\n";
+      ret = 1;
+    }
+  }
+
+  // The same rectangle is not reported when the minimum contour length is 14
+  blobs.clear();
+  Sweep(labeller, 0, 14, blobs);
+  if (blobs.size() != 0) {
+    cout << "ERROR: rectangle with a short contour was reported\n";
+    ret = 1;
+  }
+
+  // A blob that crosses north
+  CLEAR_STRUCT(image);
+  SetRect(LINES_PER_ROTATION - 3, 200, 6, 2);
+  blobs.clear();
+  Sweep(labeller, 1000, 0, blobs);
+  if (blobs.size() != 1 || blobs[0].min_angle != LINES_PER_ROTATION - 3 || blobs[0].max_angle != LINES_PER_ROTATION + 2 ||
+      blobs[0].area != 12) {
+    cout << "ERROR: blob crossing north not found as one blob, found " << blobs.size() << " blobs\n";
+    ret = 1;
+  }
+
+  // A U that is only found to be one blob at its bottom
+  CLEAR_STRUCT(image);
+  SetRect(300, 100, 10, 2);
+  SetRect(300, 120, 10, 2);
+  SetRect(310, 100, 2, 22);
+  blobs.clear();
+  Sweep(labeller, 0, 0, blobs);
+  if (blobs.size() != 1 || blobs[0].area != 84 || blobs[0].min_r != 100 || blobs[0].max_r != 121) {
+    cout << "ERROR: U shape not merged into one blob, found " << blobs.size() << " blobs\n";
+    ret = 1;
+  }
+
+  // The bearing steps back 10 spokes in the middle of the rectangle: the watermark stays
+  // where it was and the rectangle is still found once, whole
+  CLEAR_STRUCT(image);
+  SetRect(100, 50, 5, 4);
+  blobs.clear();
+  labeller.Reset();
+  for (int angle = 0; angle <= 103; angle++) {
+    labeller.ProcessSpoke(angle, image[angle], 0);
+  }
+  uint32_t watermark = labeller.Watermark(TEST_LAG);
+  for (int angle = 93; angle < LINES_PER_ROTATION + TEST_LAG; angle++) {
+    labeller.ProcessSpoke(angle % LINES_PER_ROTATION, image[angle % LINES_PER_ROTATION], 0);
+    if (angle == 103) {
+      labeller.TakeBlobs(TEST_LAG, blobs);
+      if (labeller.Watermark(TEST_LAG) != watermark || !blobs.empty()) {
+        cout << "ERROR: step back moved the watermark by " << (int)(labeller.Watermark(TEST_LAG) - watermark) << "\n";
+        ret = 1;
+      }
+    }
+  }
+  labeller.TakeBlobs(TEST_LAG, blobs);
+  if (blobs.size() != 1 || blobs[0].area != 20 || blobs[0].min_angle != 100 || blobs[0].max_angle != 104) {
+    cout << "ERROR: rectangle with a step back found as " << blobs.size() << " blobs\n";
+    ret = 1;
+  }
+
+  // Random returns, compare with a flood fill. The area is kept small enough to stay
+  // below the number of blobs the labeller keeps.
+  for (int round = 0; round < 5; round++) {
+    CLEAR_STRUCT(image);
+    for (int a = 100; a < 160; a++) {
+      for (int r = 0; r < RETURNS_PER_LINE; r++) {
+        if (Random() % 100 < 20 + round * 10u) {
+          image[a][r] = 192;
+        }
+      }
+    }
+    vector<int> expected = FloodFill(100, 159);
+    blobs.clear();
+    Sweep(labeller, 0, -1, blobs);
+    vector<int> found;
+    for (size_t i = 0; i < blobs.size(); i++) {
+      found.push_back(blobs[i].area);
+    }
+    sort(expected.begin(), expected.end());
+    sort(found.begin(), found.end());
+    if (expected != found) {
+      cout << "ERROR: round " << round << " found " << found.size() << " blobs, flood fill found " << expected.size() << "\n";
+      ret = 1;
+    } else {
+      cout << "INFO: round " << round << " found " << found.size() << " blobs like the flood fill\n";
+    }
+
+    blobs.clear();
+    int early_or_late = SweepInSteps(labeller, 32, -1, blobs);
+    found.clear();
+    for (size_t i = 0; i < blobs.size(); i++) {
+      found.push_back(blobs[i].area);
+    }
+    sort(found.begin(), found.end());
+    if (expected != found || early_or_late) {
+      cout << "ERROR: round " << round << " taken in steps found " << found.size() << " blobs, " << early_or_late
+           << " of them taken too early or too late\n";
+      ret = 1;
+    }
+  }
+
+  if (ret == 0) {
+    cout << "INFO: TEST PASSED\n";
+  } else {
+    cout << "ERROR: TEST FAILED\n";
+  }
+  exit(ret);
+}
+
+PLUGIN_END_NAMESPACE
+
+int main() { br24::main(); }
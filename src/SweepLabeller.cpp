@@ -0,0 +1,255 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#include "SweepLabeller.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+void SweepLabeller::Reset() {
+  m_started = false;
+  m_last_angle = 0;
+  m_position = 0;
+  m_base_angle = 0;
+  m_previous.clear();
+  m_current.clear();
+  m_blobs.clear();
+  m_free_blobs.clear();
+  m_completed.clear();
+  m_completed_head = 0;
+}
+
+int SweepLabeller::NewBlob(int r) {
+  int b;
+
+  if (m_free_blobs.empty()) {
+    b = (int)m_blobs.size();
+    m_blobs.push_back(Blob());
+  } else {
+    b = m_free_blobs.back();
+    m_free_blobs.pop_back();
+  }
+
+  Blob *blob = &m_blobs[b];
+  blob->in_use = true;
+  blob->first = m_position;
+  blob->last = m_position;
+  blob->min_r = r;
+  blob->max_r = r;
+  blob->area = 0;
+  blob->edges = 0;
+  blob->sum_position = 0.;
+  blob->sum_r = 0.;
+  blob->seed_r = r;
+  return b;
+}
+
+// A run touches two blobs, so they are one. All runs of 'from' are relabelled.
+void SweepLabeller::MergeBlobs(int into, int from) {
+  Blob *a = &m_blobs[into];
+  Blob *b = &m_blobs[from];
+
+  // Keep the seed of the blob that started first
+  if ((int32_t)(b->first - a->first) < 0) {
+    a->seed_r = b->seed_r;
+    a->sum_position += (double)(a->first - b->first) * a->area;
+    a->first = b->first;
+    a->sum_position += b->sum_position;
+  } else {
+    a->sum_position += b->sum_position + (double)(b->first - a->first) * b->area;
+  }
+  if ((int32_t)(b->last - a->last) > 0) {
+    a->last = b->last;
+  }
+  a->min_r = MIN(a->min_r, b->min_r);
+  a->max_r = MAX(a->max_r, b->max_r);
+  a->area += b->area;
+  a->edges += b->edges;
+  a->sum_r += b->sum_r;
+
+  for (size_t i = 0; i < m_previous.size(); i++) {
+    if (m_previous[i].blob == from) {
+      m_previous[i].blob = into;
+    }
+  }
+  for (size_t i = 0; i < m_current.size(); i++) {
+    if (m_current[i].blob == from) {
+      m_current[i].blob = into;
+    }
+  }
+  b->in_use = false;
+  m_free_blobs.push_back(from);
+}
+
+void SweepLabeller::FinishBlob(int b, int min_contour_length) {
+  Blob *blob = &m_blobs[b];
+
+  blob->in_use = false;
+  m_free_blobs.push_back(b);
+
+  // The outer boundary of a blob without holes has four edges more than the number of
+  // steps the tracer takes along it: a w x h rectangle has 2 (w + h) edges and
+  // 2 (w + h) - 4 steps, a single return has 4 edges and no steps.
+  int contour_length = blob->edges - 4;
+  uint32_t spokes = blob->last - blob->first + 1;
+  if (contour_length <= min_contour_length || spokes >= LINES_PER_ROTATION) {
+    return;  // too small to be a target, or it goes all around the ship
+  }
+  if (m_completed.size() - m_completed_head >= MAX_COMPLETED_BLOBS) {
+    return;  // nobody is taking the blobs
+  }
+
+  CompletedBlob completed;
+  SweepBlob *s = &completed.blob;
+  s->min_angle = (int)((m_base_angle + blob->first) % LINES_PER_ROTATION);
+  s->max_angle = s->min_angle + (int)spokes - 1;
+  s->min_r = blob->min_r;
+  s->max_r = blob->max_r;
+  s->area = blob->area;
+  s->contour_length = contour_length;
+  s->centroid_angle = fmod(s->min_angle + blob->sum_position / blob->area, (double)LINES_PER_ROTATION);
+  s->centroid_r = blob->sum_r / blob->area;
+  s->seed_angle = s->min_angle;
+  s->seed_r = blob->seed_r;
+  completed.last = blob->last;
+  m_completed.push_back(completed);
+}
+
+void SweepLabeller::ProcessSpoke(int angle, const UINT8 *line, int min_contour_length) {
+  if (!m_started) {
+    m_started = true;
+    m_position = 0;
+    m_base_angle = (uint32_t)angle;
+  } else {
+    int delta = (angle - m_last_angle + LINES_PER_ROTATION) % LINES_PER_ROTATION;
+    if (delta == 0) {
+      return;  // Same spoke again, it is already labelled
+    }
+    if (delta > LINES_PER_ROTATION / 2) {
+      // The bearing stepped back, as when the heading decreases with heading up stabilisation.
+      // These spokes have been labelled, so keep the position until the beam is past them again.
+      return;
+    }
+    m_position += delta;
+    if (delta > 1) {
+      // Missing spokes, so nothing in the previous spoke continues
+      for (size_t i = 0; i < m_previous.size(); i++) {
+        if (m_blobs[m_previous[i].blob].in_use) {
+          FinishBlob(m_previous[i].blob, min_contour_length);
+        }
+      }
+      m_previous.clear();
+    }
+  }
+  m_last_angle = angle;
+
+  // Split the spoke into runs
+  m_current.clear();
+  for (int r = FIRST_RADIUS; r <= LAST_RADIUS; r++) {
+    if (line[r] & 128) {
+      Run run;
+      run.r1 = r;
+      while (r < LAST_RADIUS && (line[r + 1] & 128)) {
+        r++;
+      }
+      run.r2 = r;
+      run.blob = -1;
+      m_current.push_back(run);
+    }
+  }
+
+  // Connect each run to the runs of the previous spoke that share a radius with it.
+  // Both lists are sorted on radius, so this is a single merge pass.
+  size_t first = 0;
+  for (size_t i = 0; i < m_current.size(); i++) {
+    Run *run = &m_current[i];
+
+    while (first < m_previous.size() && m_previous[first].r2 < run->r1) {
+      first++;
+    }
+    int shared = 0;
+    for (size_t j = first; j < m_previous.size() && m_previous[j].r1 <= run->r2; j++) {
+      int b = m_previous[j].blob;
+      shared += MIN(run->r2, m_previous[j].r2) - MAX(run->r1, m_previous[j].r1) + 1;
+      if (run->blob == -1) {
+        run->blob = b;
+      } else if (run->blob != b) {
+        MergeBlobs(run->blob, b);
+      }
+    }
+    if (run->blob == -1) {
+      run->blob = NewBlob(run->r1);
+    }
+
+    Blob *blob = &m_blobs[run->blob];
+    int len = run->r2 - run->r1 + 1;
+    blob->last = m_position;
+    blob->min_r = MIN(blob->min_r, run->r1);
+    blob->max_r = MAX(blob->max_r, run->r2);
+    blob->area += len;
+    blob->edges += 2 * len + 2 - 2 * shared;  // every shared radius hides an edge of both runs
+    blob->sum_position += (double)(m_position - blob->first) * len;
+    blob->sum_r += len * (run->r1 + run->r2) / 2.;
+  }
+
+  // The blobs of the previous spoke that did not get a run in this one are complete
+  for (size_t i = 0; i < m_previous.size(); i++) {
+    Blob *blob = &m_blobs[m_previous[i].blob];
+    if (blob->in_use && blob->last != m_position) {
+      FinishBlob(m_previous[i].blob, min_contour_length);
+    }
+  }
+
+  m_previous.swap(m_current);
+}
+
+void SweepLabeller::TakeBlobs(int lag, vector<SweepBlob> &blobs) {
+  uint32_t watermark = Watermark(lag);
+
+  // A blob is complete on the first spoke after its last one, so FinishBlob adds them in the
+  // order of their last spoke and the blobs that can be taken are all at the head.
+  size_t i = m_completed_head;
+  while (i < m_completed.size() && (int32_t)(watermark - m_completed[i].last) >= 0) {
+    blobs.push_back(m_completed[i].blob);
+    i++;
+  }
+  m_completed_head = i;
+
+  if (m_completed_head == m_completed.size()) {
+    m_completed.clear();
+    m_completed_head = 0;
+  } else if (m_completed_head >= MAX_COMPLETED_BLOBS / 2) {
+    m_completed.erase(m_completed.begin(), m_completed.begin() + m_completed_head);
+    m_completed_head = 0;
+  }
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,135 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+#ifndef _SWEEPLABELLER_H_
+#define _SWEEPLABELLER_H_
+
+#include <vector>
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+/*
+ * Finds the blobs of returns in m_history while the spokes come in, so that ARPA can
+ * look for new targets in a table instead of probing every pixel of a guard zone.
+ *
+ * Each spoke is split into runs of returns that have the ARPA bit (128) set. A run
+ * belongs to the same blob as the runs of the previous spoke it shares a radius with
+ * (4-connectivity, the same as the contour tracer in RadarMarpa.cpp). When a spoke
+ * comes in that does not continue a blob, that blob is complete. The sweep is labelled
+ * as one endless strip, so blobs that cross north are simply found as one blob.
+ */
+
+struct SweepBlob {
+  int min_angle;  // 0 .. LINES_PER_ROTATION - 1
+  int max_angle;  // >= min_angle, so >= LINES_PER_ROTATION when the blob crosses north
+  int min_r;
+  int max_r;
+  int area;            // number of returns
+  int contour_length;  // number of steps the contour tracer takes around the blob, if it has no holes
+  double centroid_angle;  // 0 .. LINES_PER_ROTATION
+  double centroid_r;
+  int seed_angle;  // a return of the blob: the first return of its first run
+  int seed_r;
+};
+
+class SweepLabeller {
+ public:
+  SweepLabeller() { Reset(); }
+
+  void Reset();
+
+  // Label the ARPA bits of a history line. Blobs with a contour of no more than
+  // min_contour_length steps are too small to be a target and are not reported.
+  // Spokes up to half a rotation behind the last one are ignored.
+  void ProcessSpoke(int angle, const UINT8 *line, int min_contour_length);
+
+  // The sweep watermark: the sweep position of the newest spoke that the beam has passed
+  // by at least lag spokes. It goes up by one per spoke, like m_position.
+  uint32_t Watermark(int lag) { return m_position - (uint32_t)lag; }
+
+  // Append the blobs whose last spoke is at or before the watermark to blobs, and forget
+  // about them. Only the blobs that became eligible since the previous call are looked at.
+  void TakeBlobs(int lag, vector<SweepBlob> &blobs);
+
+  bool IsIdle() { return !m_started; }
+
+ private:
+  static const int FIRST_RADIUS = 2;                    // RadarArpa::Pix ignores the center...
+  static const int LAST_RADIUS = RETURNS_PER_LINE - 2;  // ... and the range ring
+  static const size_t MAX_COMPLETED_BLOBS = 4096;
+
+  struct Run {
+    int r1;  // first return
+    int r2;  // last return
+    int blob;
+  };
+
+  struct Blob {
+    bool in_use;
+    uint32_t first;  // sweep position of the first and last spoke
+    uint32_t last;
+    int min_r;
+    int max_r;
+    int area;
+    int edges;  // number of pixel edges on the boundary
+    double sum_position;
+    double sum_r;
+    int seed_r;
+  };
+
+  struct CompletedBlob {
+    SweepBlob blob;
+    uint32_t last;
+  };
+
+  bool m_started;
+  int m_last_angle;
+  uint32_t m_position;    // Sweep position of the last spoke; goes up by one per spoke and doesn't wrap at north
+  uint32_t m_base_angle;  // Angle of sweep position 0
+
+  vector<Run> m_previous;  // Runs of the spoke at m_position - 1
+  vector<Run> m_current;
+  vector<Blob> m_blobs;
+  vector<int> m_free_blobs;
+  vector<CompletedBlob> m_completed;  // in the order of their last spoke
+  size_t m_completed_head;            // the blobs before this one have been taken
+
+  int NewBlob(int r);
+  void MergeBlobs(int into, int from);
+  void FinishBlob(int b, int min_contour_length);
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _SWEEPLABELLER_H_ */
@@ -0,0 +1,247 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+
+/*
+ * Micro-benchmark of the AIS targets that ARPA compares its targets with.
+ *
+ * Feeds a synthetic stream of AIS positions, 300 per second, from 200, 1000 and 3000
+ * ships around own ship, to an AisIndex and to the vector with linear search that
+ * br24radar_pi used before. Ships drop out of the stream over time so that targets
+ * expire as well. After every 100 messages an ARPA refresh asks for the AIS targets
+ * near 50 positions. Both must give the same answers.
+ */
+
+#include <wx/stopwatch.h>
+#include <vector>
+
+#include "AisIndex.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define BENCH_MIN_MILLIS (300)      // run each variant at least this long
+#define BENCH_MESSAGES (60000)      // 200 seconds of AIS, longer than the expiry time
+#define BENCH_PER_SECOND (300)      // AIS messages per second
+#define BENCH_QUERY_EVERY (100)     // messages between ARPA refreshes
+#define BENCH_QUERIES (50)          // ARPA targets per refresh
+#define BENCH_MAX_AGE (3 * 60)      // as in br24radar_pi::SetPluginMessage
+#define BENCH_OWN_LAT (52.)
+#define BENCH_OWN_LON (4.)
+
+struct Message {
+  long mmsi;
+  double lat;
+  double lon;
+  time_t time;
+};
+
+struct Query {
+  double lat;
+  double lon;
+  double offset;
+};
+
+// How br24radar_pi kept the AIS targets before
+struct ScanTarget {
+  long mmsi;
+  time_t time;
+  double lat;
+  double lon;
+};
+
+class ScanIndex {
+ public:
+  void Update(const Message &m) {
+    for (size_t i = 0; i < m_targets.size(); i++) {
+      if (m_targets[i].mmsi == m.mmsi) {
+        m_targets[i].time = m.time;
+        m_targets[i].lat = m.lat;
+        m_targets[i].lon = m.lon;
+        return;
+      }
+    }
+    ScanTarget t = {m.mmsi, m.time, m.lat, m.lon};
+    m_targets.push_back(t);
+  }
+
+  void Expire(time_t now) {
+    for (size_t i = 0; i < m_targets.size();) {
+      if (now - m_targets[i].time > BENCH_MAX_AGE) {
+        m_targets.erase(m_targets.begin() + i);
+      } else {
+        i++;
+      }
+    }
+  }
+
+  bool FindNear(const Query &q) const {
+    for (size_t i = 0; i < m_targets.size(); i++) {
+      if (q.lat + q.offset > m_targets[i].lat && q.lat - q.offset < m_targets[i].lat && q.lon + (q.offset * 1.75) > m_targets[i].lon &&
+          q.lon - (q.offset * 1.75) < m_targets[i].lon) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  size_t Size() const { return m_targets.size(); }
+
+ private:
+  vector<ScanTarget> m_targets;
+};
+
+static double Random() { return rand() / (RAND_MAX + 1.); }
+
+static void MakeStream(int ships, vector<Message> &messages, vector<Query> &queries) {
+  vector<double> lat(ships * 4);
+  vector<double> lon(ships * 4);
+
+  for (size_t i = 0; i < lat.size(); i++) {
+    lat[i] = BENCH_OWN_LAT + (Random() - 0.5) * 0.4;
+    lon[i] = BENCH_OWN_LON + (Random() - 0.5) * 0.8;
+  }
+  for (int i = 0; i < BENCH_MESSAGES; i++) {
+    // the ships that are sending slide along, so the first ones stop and expire
+    int ship = i * ships * 2 / BENCH_MESSAGES + rand() % ships;
+    lat[ship] += (Random() - 0.5) * 0.0002;
+    lon[ship] += (Random() - 0.5) * 0.0004;
+    Message m = {200000001 + ship * 7919L, lat[ship], lon[ship], 1500000000 + i / BENCH_PER_SECOND};
+    messages.push_back(m);
+
+    if (i % BENCH_QUERY_EVERY == 0) {
+      for (int j = 0; j < BENCH_QUERIES; j++) {
+        Query q;
+        q.offset = (40. + Random() * 1800.) / 1852. / 60.;
+        if (j & 1) {  // a target that is also seen by AIS
+          q.lat = m.lat + (Random() - 0.5) * q.offset;
+          q.lon = m.lon + (Random() - 0.5) * q.offset;
+        } else {
+          q.lat = BENCH_OWN_LAT + (Random() - 0.5) * 0.4;
+          q.lon = BENCH_OWN_LON + (Random() - 0.5) * 0.8;
+        }
+        queries.push_back(q);
+      }
+    }
+  }
+}
+
+static void Update(AisIndex &index, const Message &m) {
+  index.Update(m.mmsi, m.lat, m.lon, m.time);
+  index.Expire(m.time, BENCH_MAX_AGE);
+}
+
+static bool FindNear(const AisIndex &index, const Query &q) { return index.FindNear(q.lat, q.lon, q.offset, q.offset * 1.75); }
+
+static void Update(ScanIndex &index, const Message &m) {
+  index.Update(m);
+  index.Expire(m.time);
+}
+
+static bool FindNear(const ScanIndex &index, const Query &q) { return index.FindNear(q); }
+
+// Runs the stream through index, as SetPluginMessage and the ARPA threads do; returns the number of hits
+template <typename I>
+static long Run(I &index, const vector<Message> &messages, const vector<Query> &queries, vector<bool> *answers) {
+  long hits = 0;
+  size_t q = 0;
+
+  for (size_t i = 0; i < messages.size(); i++) {
+    Update(index, messages[i]);
+    if (i % BENCH_QUERY_EVERY == 0) {
+      for (int j = 0; j < BENCH_QUERIES; j++, q++) {
+        bool hit = FindNear(index, queries[q]);
+        hits += hit;
+        if (answers) {
+          answers->push_back(hit);
+        }
+      }
+    }
+  }
+  return hits;
+}
+
+// Run the stream through a new I until BENCH_MIN_MILLIS have passed, return ns per message
+template <typename I>
+static double Measure(const vector<Message> &messages, const vector<Query> &queries) {
+  wxStopWatch sw;
+  long n = 0;
+  long hits = 0;
+
+  do {
+    I index;
+    hits += Run(index, messages, queries, 0);
+    n += messages.size();
+  } while (sw.Time() < BENCH_MIN_MILLIS);
+  if (hits == 42) {
+    cout << "";  // keep the loop
+  }
+  return sw.Time() * 1e6 / n;
+}
+
+int main(int argc, char *argv[]) {
+  static const int sizes[] = {200, 1000, 3000};
+  int errors = 0;
+
+  srand(1);
+  printf("ships  targets   scan ns/msg  index ns/msg   hits\n");
+  for (size_t s = 0; s < ARRAY_SIZE(sizes); s++) {
+    vector<Message> messages;
+    vector<Query> queries;
+    MakeStream(sizes[s], messages, queries);
+
+    // Check the answers of one run of each
+    vector<bool> scan_answers;
+    vector<bool> index_answers;
+    ScanIndex scan_check;
+    AisIndex index_check;
+    long hits = Run(scan_check, messages, queries, &scan_answers);
+    Run(index_check, messages, queries, &index_answers);
+    if (scan_answers != index_answers || scan_check.Size() != index_check.Size()) {
+      cout << "ERROR: " << sizes[s] << " ships: index has " << index_check.Size() << " targets, scan " << scan_check.Size() << "\n";
+      errors++;
+    }
+
+    double scan_ns = Measure<ScanIndex>(messages, queries);
+    double index_ns = Measure<AisIndex>(messages, queries);
+    printf("%5d  %7d  %12.1f  %12.1f  %5ld\n", sizes[s], (int)index_check.Size(), scan_ns, index_ns, hits);
+  }
+  if (errors) {
+    cout << "ERROR: the answers of the index differ from a scan\n";
+    return 1;
+  }
+  cout << "INFO: TEST PASSED\n";
+  return 0;
+}
+
+PLUGIN_END_NAMESPACE
+
+int main(int argc, char *argv[]) { return br24::main(argc, argv); }
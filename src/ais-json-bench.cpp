@@ -0,0 +1,184 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+
+/*
+ * Benchmark of reading the AIS plugin messages that OpenCPN sends.
+ *
+ * Replays the bodies of AIS messages, from a file with one message per line or from a
+ * generated set in the layout that OpenCPN's wxJSONWriter uses, through ParseAisJson and
+ * through wxJSONReader as br24radar_pi::SetPluginMessage did before, and reports messages
+ * per second for each. The MMSI and position of the two must agree.
+ */
+
+#include <wx/stopwatch.h>
+#include <vector>
+
+#include "AisJson.h"
+#include "jsonreader.h"
+#include "jsonval.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define BENCH_MIN_MILLIS (500)  // run each variant at least this long
+#define BENCH_MESSAGES (1000)
+
+static vector<wxString> messages;
+
+static bool ReadMessages(const char *name) {
+  FILE *f = fopen(name, "r");
+  char line[4096];
+
+  if (!f) {
+    return false;
+  }
+  while (fgets(line, sizeof(line), f)) {
+    wxString body = wxString::FromUTF8(line).Trim();
+    if (!body.IsEmpty()) {
+      messages.push_back(body);
+    }
+  }
+  fclose(f);
+  return !messages.empty();
+}
+
+static void MakeMessages() {
+  static const char *names[] = {"VOLHARDING 1", "STENA BRITANNICA", "Z\\u00e9landia", "NOORDZEE \\\"2\\\""};
+
+  srand(1);
+  for (int i = 0; i < BENCH_MESSAGES; i++) {
+    char body[1024];
+    long mmsi = 244000000 + rand() % 1000000;
+    if (i % 50 == 0) {
+      mmsi = 111244000 + i;  // SAR aircraft
+    }
+    snprintf(body, sizeof(body),
+             "{\n   \"Source\" : \"AIS_Decoder\",\n   \"Type\" : \"Information\",\n   \"Msg\" : \"AIS Target\",\n"
+             "   \"MsgId\" : \"Mon Oct 16 10:%02d:%02d 2017\",\n   \"lat\" : %.10g,\n   \"lon\" : %.10g,\n   \"sog\" : %.10g,\n"
+             "   \"cog\" : %.10g,\n   \"hdg\" : %d,\n   \"mmsi\" : %ld,\n   \"class\" : %d,\n   \"ownship\" : false,\n"
+             "   \"active\" : true,\n   \"lost\" : false,\n   \"ais_version\" : 0,\n   \"ais_imo\" : %d,\n"
+             "   \"ais_callsign\" : \"PD%04d\",\n   \"ais_shipname\" : \"%s\",\n   \"ais_shiptype\" : %d,\n"
+             "   \"ais_destination\" : \"ROTTERDAM\"\n}\n",
+             i / 60 % 60, i % 60, 51.5 + rand() / (RAND_MAX + 1.), 3.5 + rand() / (RAND_MAX + 1.), rand() % 200 / 10.,
+             rand() % 3600 / 10., rand() % 360, mmsi, i % 3 ? 0 : 1, 9000000 + i, i % 10000, names[i % ARRAY_SIZE(names)],
+             70 + i % 20);
+    messages.push_back(wxString::FromUTF8(body));
+  }
+}
+
+// As SetPluginMessage did it before, returns false if the message is not JSON
+static bool ReadWithTree(const wxString &body, long *mmsi, double *lat, double *lon) {
+  wxJSONReader reader;
+  wxJSONValue message;
+
+  if (reader.Parse(body, &message)) {
+    return false;
+  }
+  wxJSONValue defaultValue(999);
+  *mmsi = message.Get(_T("mmsi"), defaultValue).AsLong();
+  wxJSONValue defaultPosition("90.0");
+  *lat = wxAtof(message.Get(_T("lat"), defaultPosition).AsString());
+  *lon = wxAtof(message.Get(_T("lon"), defaultPosition).AsString());
+  return true;
+}
+
+// As SetPluginMessage does it now
+static bool ReadFast(const wxString &body, long *mmsi, double *lat, double *lon) {
+  return ParseAisJson(body.wc_str(), mmsi, lat, lon) || ReadWithTree(body, mmsi, lat, lon);
+}
+
+// Read all messages until BENCH_MIN_MILLIS have passed, return messages per second
+static double Measure(bool (*read)(const wxString &, long *, double *, double *)) {
+  wxStopWatch sw;
+  long n = 0;
+  double sum = 0.;
+
+  do {
+    for (size_t i = 0; i < messages.size(); i++) {
+      long mmsi;
+      double lat, lon;
+      if (read(messages[i], &mmsi, &lat, &lon)) {
+        sum += mmsi + lat + lon;
+      }
+    }
+    n += messages.size();
+  } while (sw.Time() < BENCH_MIN_MILLIS);
+  if (sum == 42.) {
+    cout << "";  // keep the loop
+  }
+  return n * 1000. / sw.Time();
+}
+
+int main(int argc, char *argv[]) {
+  int errors = 0;
+  int fast = 0;
+
+  if (argc > 1) {
+    if (!ReadMessages(argv[1])) {
+      cout << "ERROR: cannot read AIS messages from " << argv[1] << "\n";
+      return 1;
+    }
+  } else {
+    MakeMessages();
+  }
+
+  for (size_t i = 0; i < messages.size(); i++) {
+    long tree_mmsi, fast_mmsi;
+    double tree_lat, tree_lon, fast_lat, fast_lon;
+    bool tree = ReadWithTree(messages[i], &tree_mmsi, &tree_lat, &tree_lon);
+    if (ParseAisJson(messages[i].wc_str(), &fast_mmsi, &fast_lat, &fast_lon)) {
+      fast++;
+      // wxJSONValue::AsString prints the position with fewer digits than it was sent with
+      if (!tree || tree_mmsi != fast_mmsi || fabs(tree_lat - fast_lat) > 1e-6 || fabs(tree_lon - fast_lon) > 1e-6) {
+        if (errors++ < 10) {
+          cout << "ERROR: message " << i << " mmsi " << fast_mmsi << " lat " << fast_lat << " lon " << fast_lon
+               << " but wxJSONReader gives " << tree_mmsi << " " << tree_lat << " " << tree_lon << "\n";
+        }
+      }
+    }
+  }
+
+  double tree = Measure(ReadWithTree);
+  double parse = Measure(ReadFast);
+  printf("%d messages, %d read without wxJSONReader\n", (int)messages.size(), fast);
+  printf("wxJSONReader    %10.0f messages/s\nParseAisJson    %10.0f messages/s\n", tree, parse);
+  if (errors) {
+    cout << "ERROR: " << errors << " messages are read differently\n";
+    return 1;
+  }
+  cout << "INFO: TEST PASSED\n";
+  return 0;
+}
+
+PLUGIN_END_NAMESPACE
+
+int main(int argc, char *argv[]) { return br24::main(argc, argv); }
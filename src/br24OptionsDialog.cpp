@@ -98,6 +98,24 @@ br24OptionsDialog::br24OptionsDialog(wxWindow *parent, PersistentSettings &setti
                               this);
   m_GuardZoneTimeout->SetValue(wxString::Format(wxT("%d"), m_settings.guard_zone_timeout));
 
+  wxStaticText *cpaAlarm = new wxStaticText(this, wxID_ANY, _("ARPA CPA alarm (NM, 0 = off)"), wxDefaultPosition, wxDefaultSize, 0);
+  guardZoneSizer->Add(cpaAlarm, 0, wxALIGN_CENTER_HORIZONTAL | wxALL, border_size);
+
+  m_CpaAlarm = new wxTextCtrl(this, wxID_ANY);
+  guardZoneSizer->Add(m_CpaAlarm, 1, wxALIGN_CENTER_HORIZONTAL | wxALL, border_size);
+  m_CpaAlarm->Connect(wxEVT_COMMAND_TEXT_UPDATED, wxCommandEventHandler(br24OptionsDialog::OnCpaAlarmClick), NULL, this);
+  m_CpaAlarm->SetValue(wxString::Format(wxT("%g"), m_settings.cpa_alarm_nm));
+
+  wxStaticText *cpaAlarmMinutes =
+      new wxStaticText(this, wxID_ANY, _("ARPA CPA alarm within (min)"), wxDefaultPosition, wxDefaultSize, 0);
+  guardZoneSizer->Add(cpaAlarmMinutes, 0, wxALIGN_CENTER_HORIZONTAL | wxALL, border_size);
+
+  m_CpaAlarmMinutes = new wxTextCtrl(this, wxID_ANY);
+  guardZoneSizer->Add(m_CpaAlarmMinutes, 1, wxALIGN_CENTER_HORIZONTAL | wxALL, border_size);
+  m_CpaAlarmMinutes->Connect(wxEVT_COMMAND_TEXT_UPDATED, wxCommandEventHandler(br24OptionsDialog::OnCpaAlarmMinutesClick), NULL,
+                             this);
+  m_CpaAlarmMinutes->SetValue(wxString::Format(wxT("%g"), m_settings.tcpa_alarm_minutes));
+
   // Drawing Method
 
   wxStaticBox *drawingMethodBox = new wxStaticBox(this, wxID_ANY, _("GPU drawing method"));
@@ -344,6 +362,24 @@ void br24OptionsDialog::OnGuardZoneTimeoutClick(wxCommandEvent &event) {
   m_settings.guard_zone_timeout = strtol(temp.c_str(), 0, 0);
 }
 
+void br24OptionsDialog::OnCpaAlarmClick(wxCommandEvent &event) {
+  wxString temp = m_CpaAlarm->GetValue();
+  double t;
+
+  if (temp.ToDouble(&t)) {
+    m_settings.cpa_alarm_nm = wxMax(t, 0.0);
+  }
+}
+
+void br24OptionsDialog::OnCpaAlarmMinutesClick(wxCommandEvent &event) {
+  wxString temp = m_CpaAlarmMinutes->GetValue();
+  double t;
+
+  if (temp.ToDouble(&t)) {
+    m_settings.tcpa_alarm_minutes = wxMax(t, 0.0);
+  }
+}
+
 void br24OptionsDialog::OnEnableCOGHeadingClick(wxCommandEvent &event) { m_settings.enable_cog_heading = m_COGHeading->GetValue(); }
 
 void br24OptionsDialog::OnEnableDualRadarClick(wxCommandEvent &event) {
@@ -50,6 +50,8 @@ class br24OptionsDialog : public wxDialog {
   void OnGuardZoneStyleClick(wxCommandEvent& event);
   void OnGuardZoneOnOverlayClick(wxCommandEvent& event);
   void OnGuardZoneTimeoutClick(wxCommandEvent& event);
+  void OnCpaAlarmClick(wxCommandEvent& event);
+  void OnCpaAlarmMinutesClick(wxCommandEvent& event);
   void OnShowExtremeRangeClick(wxCommandEvent& event);
   void OnTrailsOnOverlayClick(wxCommandEvent& event);
   void OnTrailStartColourClick(wxCommandEvent& event);
@@ -79,6 +81,8 @@ class br24OptionsDialog : public wxDialog {
   wxRadioBox* m_DisplayMode;
   wxRadioBox* m_GuardZoneStyle;
   wxTextCtrl* m_GuardZoneTimeout;
+  wxTextCtrl* m_CpaAlarm;
+  wxTextCtrl* m_CpaAlarmMinutes;
   wxColourPickerCtrl* m_TrailStartColour;
   wxColourPickerCtrl* m_TrailEndColour;
   wxColourPickerCtrl* m_WeakColour;
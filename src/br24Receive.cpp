@@ -31,7 +31,17 @@
  */
 
 #include "br24Receive.h"
+#ifdef BR24_HAVE_ZLIB
+#include "PcapReader.h"
+#endif
 #include "RadarMarpa.h"
+#include "SpokeQueue.h"
+#include "drawutil.h"
+
+#if defined(__linux__)
+#include <sys/socket.h>
+#define HAVE_RECVMMSG
+#endif
 
 PLUGIN_BEGIN_NAMESPACE
 
@@ -44,6 +54,10 @@ PLUGIN_BEGIN_NAMESPACE
 #define MILLIS_PER_SELECT 250
 #define SECONDS_SELECT(x) ((x)*MILLISECONDS_PER_SECOND / MILLIS_PER_SELECT)
 
+// How many frames we pull off the data socket in one go. A 4G sends 64+ frames/s per radar, so
+// at the 250 ms select interval there is rarely more than this pending.
+#define FRAMES_PER_BATCH 16
+
 // There are two radars in every 4G radome. They send and listen on different addresses
 
 struct ListenAddress {
@@ -152,6 +166,121 @@ void br24Receive::logBinaryData(const wxString &what, const UINT8 *data, int siz
   LOG_RECEIVE(explain);
 }
 
+// ReceiveDataFrames
+// -----------------
+// Drain every datagram that is pending on the data socket into the preallocated frame slots,
+// then process them in the order they arrived. On Linux this is a single recvmmsg() call,
+// elsewhere we loop on a non-blocking recv() or, failing that, read just the one frame that
+// select() promised us.
+// Returns the number of frames received, or -1 when the socket failed.
+//
+int br24Receive::ReceiveDataFrames(SOCKET socket, UINT8 *frames) {
+  radar_frame_pkt *slot = (radar_frame_pkt *)frames;
+  int len[FRAMES_PER_BATCH];
+  int n = 0;
+
+#if defined(HAVE_RECVMMSG)
+  struct mmsghdr msgs[FRAMES_PER_BATCH];
+  struct iovec iov[FRAMES_PER_BATCH];
+
+  CLEAR_STRUCT(msgs);
+  for (int i = 0; i < FRAMES_PER_BATCH; i++) {
+    iov[i].iov_base = &slot[i];
+    iov[i].iov_len = sizeof(radar_frame_pkt);
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  // select() said there is at least one frame, MSG_DONTWAIT stops us from waiting for more.
+  n = recvmmsg(socket, msgs, FRAMES_PER_BATCH, MSG_DONTWAIT, 0);
+  if (n <= 0) {
+    return -1;
+  }
+  for (int i = 0; i < n; i++) {
+    len[i] = (int)msgs[i].msg_len;
+  }
+#elif defined(MSG_DONTWAIT)
+  while (n < FRAMES_PER_BATCH) {
+    int r = recv(socket, (char *)&slot[n], sizeof(radar_frame_pkt), MSG_DONTWAIT);
+    if (r <= 0) {
+      break;
+    }
+    len[n++] = r;
+  }
+  if (n == 0) {
+    return -1;
+  }
+#else
+  int r = recv(socket, (char *)&slot[0], sizeof(radar_frame_pkt), 0);
+  if (r <= 0) {
+    return -1;
+  }
+  len[n++] = r;
+#endif
+
+  {
+    wxCriticalSectionLocker lock(m_ri->m_statistics_lock);
+
+    m_ri->m_statistics.batches++;
+    m_ri->m_statistics.max_batch = MAX(m_ri->m_statistics.max_batch, n);
+  }
+
+  for (int i = 0; i < n; i++) {
+    ProcessFrame((UINT8 *)&slot[i], len[i]);
+  }
+  return n;
+}
+
+// GetSpokeCount
+// -------------
+// Return the number of spokes in a frame of `len` bytes, or -1 if it is too short to be a frame.
+//
+int br24Receive::GetSpokeCount(int len) {
+  if (len < (int)sizeof(((radar_frame_pkt *)0)->frame_hdr)) {
+    return -1;
+  }
+  return (len - sizeof(((radar_frame_pkt *)0)->frame_hdr)) / sizeof(radar_line);
+}
+
+// DecodeSpoke
+// -----------
+// Decode the header of spoke `scanline` of a frame, without changing any state. The caller
+// must make sure that the frame contains this spoke, see GetSpokeCount().
+// Returns a pointer to the RETURNS_PER_LINE bytes of spoke data.
+//
+const UINT8 *br24Receive::DecodeSpoke(const UINT8 *frame, int scanline, SpokeHeader *header) {
+  const radar_line *line = &((const radar_frame_pkt *)frame)->line[scanline];
+
+  header->header_len = line->common.headerLen;
+  header->status = line->common.status;
+  header->spoke = line->common.scan_number[0] | (line->common.scan_number[1] << 8);
+  header->heading_raw = (line->common.heading[1] << 8) | line->common.heading[0];
+
+  if (memcmp(line->br24.mark, BR24MARK, sizeof(BR24MARK)) == 0) {
+    // BR24 and 3G mode
+    header->type = RT_BR24;
+    header->range_raw = ((line->br24.range[2] & 0xff) << 16 | (line->br24.range[1] & 0xff) << 8 | (line->br24.range[0] & 0xff));
+    header->angle_raw = (line->br24.angle[1] << 8) | line->br24.angle[0];
+    header->range_meters = (int)((double)header->range_raw * 10.0 / sqrt(2.0));
+  } else {
+    // 4G mode
+    short int large_range = (line->br4g.largerange[1] << 8) | line->br4g.largerange[0];
+    short int small_range = (line->br4g.smallrange[1] << 8) | line->br4g.smallrange[0];
+    header->type = RT_4G;
+    header->angle_raw = (line->br4g.angle[1] << 8) | line->br4g.angle[0];
+    if (large_range == 0x80) {
+      if (small_range == -1) {
+        header->range_raw = 0;  // Invalid range received
+      } else {
+        header->range_raw = small_range;
+      }
+    } else {
+      header->range_raw = large_range * 256;
+    }
+    header->range_meters = header->range_raw / 4;
+  }
+  return line->data;
+}
+
 // ProcessFrame
 // ------------
 // Process one radar frame packet, which can contain up to 32 'spokes' or lines extending outwards
@@ -160,77 +289,97 @@ void br24Receive::logBinaryData(const wxString &what, const UINT8 *data, int siz
 void br24Receive::ProcessFrame(const UINT8 *data, int len) {
   time_t now = time(0);
 
-  double lat;
-  double lon;
+  double lat = nan("");  // stays so if we don't know where we are
+  double lon = nan("");
 
   m_pi->GetRadarPosition(&lat, &lon);
 
   // log_line.time_rec = wxGetUTCTimeMillis();
   wxLongLong time_rec = wxGetUTCTimeMillis();
 
-  radar_frame_pkt *packet = (radar_frame_pkt *)data;
+  // The heading from NMEA or OpenCPN is updated much less frequently than the data from
+  // the radar (which is accurate 10x per second), likely once per second. Interpolate it
+  // at the time the spokes were received, without taking the plugin lock.
+  double frame_hdt;
+  if (!m_pi->GetHeadingTrueAt(time_rec, &frame_hdt)) {
+    frame_hdt = m_pi->GetHeadingTrue();
+  }
+  double variation = m_pi->GetVariation();
+  bool use_radar_heading = !m_pi->m_settings.ignore_radar_heading;
+  double radar_heading = nan("");
+  bool radar_heading_true = false;
+  bool have_spokes = false;
 
-  wxCriticalSectionLocker lock(m_ri->m_exclusive);
+  radar_frame_pkt *packet = (radar_frame_pkt *)data;
+  receive_statistics stats;
 
+  // Nothing here takes m_ri->m_exclusive, so a slow paint or spoke can't hold up the socket.
+  // The timeouts are only written by this thread and the report thread, m_state has its own lock.
   m_ri->m_radar_timeout = now + WATCHDOG_TIMEOUT;
   m_ri->m_data_timeout = now + DATA_TIMEOUT;
   m_ri->m_state.Update(RADAR_TRANSMIT);
 
-  m_ri->m_statistics.packets++;
-  if (len < (int)sizeof(packet->frame_hdr)) {
+  CLEAR_STRUCT(stats);
+  stats.packets++;
+  int scanlines_in_packet = GetSpokeCount(len);
+  if (scanlines_in_packet < 0) {
     // The packet is so small it contains no scan_lines, quit!
-    m_ri->m_statistics.broken_packets++;
+    stats.broken_packets++;
+    AddStatistics(stats);
     return;
   }
-  int scanlines_in_packet = (len - sizeof(packet->frame_hdr)) / sizeof(radar_line);
   if (scanlines_in_packet != 32) {
-    m_ri->m_statistics.broken_packets++;
+    stats.broken_packets++;
   }
 
   if (g_first_receive) {
     g_first_receive = false;
     wxLongLong startup_elapsed = wxGetUTCTimeMillis() - m_pi->GetBootMillis();
     LOG_INFO(wxT("BR24radar_pi: First radar spoke received after %llu ms\n"), startup_elapsed);
+    wxLongLong lookup_millis = GetPolarToCartesianLookupBuildMillis();
+    if (lookup_millis >= 0) {
+      LOG_INFO(wxT("BR24radar_pi: Polar to cartesian lookup table was built in %llu ms\n"), lookup_millis);
+    } else {
+      LOG_INFO(wxT("BR24radar_pi: Polar to cartesian lookup table is still being built\n"));
+    }
   }
 
   for (int scanline = 0; scanline < scanlines_in_packet; scanline++) {
     radar_line *line = &packet->line[scanline];
+    SpokeHeader header;
+
+    DecodeSpoke(data, scanline, &header);
 
     // Validate the spoke
-    int spoke = line->common.scan_number[0] | (line->common.scan_number[1] << 8);
-    m_ri->m_statistics.spokes++;
-    if (line->common.headerLen != 0x18) {
-      LOG_RECEIVE(wxT("BR24radar_pi: strange header length %d"), line->common.headerLen);
+    int spoke = header.spoke;
+    stats.spokes++;
+    if (header.header_len != 0x18) {
+      LOG_RECEIVE(wxT("BR24radar_pi: strange header length %d"), header.header_len);
       // Do not draw something with this...
-      m_ri->m_statistics.missing_spokes++;
+      stats.missing_spokes++;
       m_next_spoke = (spoke + 1) % SPOKES;
       continue;
     }
-    if (line->common.status != 0x02 && line->common.status != 0x12) {
-      LOG_RECEIVE(wxT("BR24radar_pi: strange status %02x"), line->common.status);
-      m_ri->m_statistics.broken_spokes++;
+    if (header.status != 0x02 && header.status != 0x12) {
+      LOG_RECEIVE(wxT("BR24radar_pi: strange status %02x"), header.status);
+      stats.broken_spokes++;
     }
     if (m_next_spoke >= 0 && spoke != m_next_spoke) {
       if (spoke > m_next_spoke) {
-        m_ri->m_statistics.missing_spokes += spoke - m_next_spoke;
+        stats.missing_spokes += spoke - m_next_spoke;
       } else {
-        m_ri->m_statistics.missing_spokes += SPOKES + spoke - m_next_spoke;
+        stats.missing_spokes += SPOKES + spoke - m_next_spoke;
       }
     }
     m_next_spoke = (spoke + 1) % SPOKES;
 
-    int range_raw = 0;
-    int angle_raw = 0;
-    short int heading_raw = 0;
-    int range_meters = 0;
-
-    heading_raw = (line->common.heading[1] << 8) | line->common.heading[0];
+    int range_raw = header.range_raw;
+    int angle_raw = header.angle_raw;
+    short int heading_raw = header.heading_raw;
+    int range_meters = header.range_meters;
 
-    if (memcmp(line->br24.mark, BR24MARK, sizeof(BR24MARK)) == 0) {
+    if (header.type == RT_BR24) {
       // BR24 and 3G mode
-      range_raw = ((line->br24.range[2] & 0xff) << 16 | (line->br24.range[1] & 0xff) << 8 | (line->br24.range[0] & 0xff));
-      angle_raw = (line->br24.angle[1] << 8) | line->br24.angle[0];
-      range_meters = (int)((double)range_raw * 10.0 / sqrt(2.0));
       if (m_ri->m_radar_type == RT_UNKNOWN) {
         LOG_INFO(wxT("BR24radar_pi: %s is Navico type BR24 or 3G"), m_ri->m_name.c_str());
         m_ri->m_radar_type = RT_BR24;
@@ -238,19 +387,6 @@ void br24Receive::ProcessFrame(const UINT8 *data, int len) {
       }
     } else {
       // 4G mode
-      short int large_range = (line->br4g.largerange[1] << 8) | line->br4g.largerange[0];
-      short int small_range = (line->br4g.smallrange[1] << 8) | line->br4g.smallrange[0];
-      angle_raw = (line->br4g.angle[1] << 8) | line->br4g.angle[0];
-      if (large_range == 0x80) {
-        if (small_range == -1) {
-          range_raw = 0;  // Invalid range received
-        } else {
-          range_raw = small_range;
-        }
-      } else {
-        range_raw = large_range * 256;
-      }
-      range_meters = range_raw / 4;
       if (m_ri->m_radar_type != RT_4G) {
         LOG_INFO(wxT("BR24radar_pi: %s is Navico type 4G"), m_ri->m_name.c_str());
         m_ri->m_radar_type = RT_4G;
@@ -265,27 +401,72 @@ void br24Receive::ProcessFrame(const UINT8 *data, int len) {
                               (uint8_t *)&line->br24, sizeof(line->br24)));
     }
 
-    bool radar_heading_valid = HEADING_VALID(heading_raw);
-    bool radar_heading_true = (heading_raw & HEADING_TRUE_FLAG) != 0;
-    double heading;
-    int bearing_raw;
-
-    if (radar_heading_valid && !m_pi->m_settings.ignore_radar_heading) {
-      heading = MOD_DEGREES(SCALE_RAW_TO_DEGREES(MOD_ROTATION(heading_raw)));
-      m_pi->SetRadarHeading(heading, radar_heading_true);
+    // A heading from the radar itself is used for the spoke it came with
+    double hdt = frame_hdt;
+    have_spokes = true;
+    if (HEADING_VALID(heading_raw) && use_radar_heading) {
+      radar_heading = MOD_DEGREES(SCALE_RAW_TO_DEGREES(MOD_ROTATION(heading_raw)));
+      radar_heading_true = (heading_raw & HEADING_TRUE_FLAG) != 0;
+      hdt = radar_heading_true ? radar_heading : radar_heading + variation;
     } else {
-      m_pi->SetRadarHeading();
+      radar_heading = nan("");
     }
-    // Guess the heading for the spoke. This is updated much less frequently than the
-    // data from the radar (which is accurate 10x per second), likely once per second.
-    heading_raw = SCALE_DEGREES_TO_RAW(m_pi->GetHeadingTrue());  // include variation
-    bearing_raw = angle_raw + heading_raw;
+    heading_raw = SCALE_DEGREES_TO_RAW(hdt);  // include variation
+    int bearing_raw = angle_raw + heading_raw;
     // until here all is based on 4096 (SPOKES) scanlines
 
     SpokeBearing a = MOD_ROTATION2048(angle_raw / 2);    // divide by 2 to map on 2048 scanlines
     SpokeBearing b = MOD_ROTATION2048(bearing_raw / 2);  // divide by 2 to map on 2048 scanlines
-    m_ri->ProcessRadarSpoke(a, b, line->data, RETURNS_PER_LINE, range_meters, time_rec, lat, lon);
+    QueueSpoke(a, b, line->data, RETURNS_PER_LINE, range_meters, time_rec, lat, lon, &stats);
+  }
+  if (have_spokes) {
+    // Once per frame, with the heading of the last spoke, instead of locking the plugin per spoke
+    m_pi->SetRadarHeading(radar_heading, radar_heading_true);
+  }
+  AddStatistics(stats);
+  if (m_ri->m_process) {
+    m_ri->m_process->SpokesPushed();
+  }
+}
+
+// QueueSpoke
+// ----------
+// Hand a decoded spoke to the spoke process thread. The queue and overflow counts go into stats.
+// Only when there is no process thread is m_ri->m_exclusive taken, to process the spoke directly.
+//
+void br24Receive::QueueSpoke(SpokeBearing angle, SpokeBearing bearing, UINT8 *data, size_t len, int range_meters,
+                             wxLongLong time_rec, double lat, double lon, receive_statistics *stats) {
+  SpokeProcessThread *process = m_ri->m_process;
+
+  if (!process) {
+    wxCriticalSectionLocker lock(m_ri->m_exclusive);
+
+    m_ri->ProcessRadarSpoke(angle, bearing, data, len, range_meters, time_rec, lat, lon);
+    return;
+  }
+  if (!process->PushSpoke(angle, bearing, data, len, range_meters, time_rec, lat, lon)) {
+    stats->queue_overflows++;
+    return;
   }
+  stats->queue_depth = MAX(stats->queue_depth, (int)process->m_queue.Depth());
+}
+
+// AddStatistics
+// -------------
+// Add the counts of a frame to m_ri->m_statistics, under its own small lock.
+//
+void br24Receive::AddStatistics(const receive_statistics &stats) {
+  wxCriticalSectionLocker lock(m_ri->m_statistics_lock);
+
+  m_ri->m_statistics.packets += stats.packets;
+  m_ri->m_statistics.broken_packets += stats.broken_packets;
+  m_ri->m_statistics.spokes += stats.spokes;
+  m_ri->m_statistics.broken_spokes += stats.broken_spokes;
+  m_ri->m_statistics.missing_spokes += stats.missing_spokes;
+  m_ri->m_statistics.batches += stats.batches;
+  m_ri->m_statistics.max_batch = MAX(m_ri->m_statistics.max_batch, stats.max_batch);
+  m_ri->m_statistics.queue_depth = MAX(m_ri->m_statistics.queue_depth, stats.queue_depth);
+  m_ri->m_statistics.queue_overflows += stats.queue_overflows;
 }
 
 /*
@@ -298,6 +479,7 @@ void br24Receive::ProcessFrame(const UINT8 *data, int len) {
 void br24Receive::EmulateFakeBuffer(void) {
   time_t now = time(0);
   UINT8 data[RETURNS_PER_LINE];
+  receive_statistics stats;
 
   m_ri->m_radar_timeout = now + WATCHDOG_TIMEOUT;
 
@@ -310,7 +492,8 @@ void br24Receive::EmulateFakeBuffer(void) {
     return;
   }
 
-  m_ri->m_statistics.packets++;
+  CLEAR_STRUCT(stats);
+  stats.packets++;
   m_ri->m_data_timeout = now + WATCHDOG_TIMEOUT;
 
   m_next_rotation = (m_next_rotation + 1) % SPOKES;
@@ -323,10 +506,12 @@ void br24Receive::EmulateFakeBuffer(void) {
   m_pi->m_pMessageBox->SetRadarType(RT_4G);
   m_ri->m_range.Update(display_range_meters);
 
+  int hdt_raw = SCALE_DEGREES_TO_RAW(m_pi->GetHeadingTrue());
+
   for (int scanline = 0; scanline < scanlines_in_packet; scanline++) {
     int angle_raw = m_next_spoke;
     m_next_spoke = (m_next_spoke + 1) % SPOKES;
-    m_ri->m_statistics.spokes++;
+    stats.spokes++;
 
     // Invent a pattern. Outermost ring, then a square pattern
     for (size_t range = 0; range < sizeof(data); range++) {
@@ -342,7 +527,6 @@ void br24Receive::EmulateFakeBuffer(void) {
       }
     }
 
-    int hdt_raw = SCALE_DEGREES_TO_RAW(m_pi->GetHeadingTrue());
     int bearing_raw = angle_raw + hdt_raw;
     bearing_raw += SCALE_DEGREES_TO_RAW(270);  // Compensate openGL rotation compared to North UP
 
@@ -351,12 +535,106 @@ void br24Receive::EmulateFakeBuffer(void) {
     wxLongLong time_rec;
     double lat = 0.;
     double lon = 0.;
-    m_ri->ProcessRadarSpoke(a, b, data, sizeof(data), range_meters, time_rec, lat, lon);
+    QueueSpoke(a, b, data, sizeof(data), range_meters, time_rec, lat, lon, &stats);
+  }
+  AddStatistics(stats);
+  if (m_ri->m_process) {
+    m_ri->m_process->SpokesPushed();
   }
 
   LOG_VERBOSE(wxT("BR24radar_pi: emulating %d spokes at range %d with %d spots"), scanlines_in_packet, range_meters, spots);
 }
 
+// StopRequested
+// -------------
+// Wait up to `millis` ms for the main thread to tell us to stop.
+//
+bool br24Receive::StopRequested(int millis) {
+  if (m_receive_socket == INVALID_SOCKET) {
+    if (millis > 0) {
+      wxMilliSleep(millis);
+    }
+    return false;
+  }
+
+  struct timeval tv = {(long)(millis / MILLISECONDS_PER_SECOND), (long)((millis % MILLISECONDS_PER_SECOND) * 1000)};
+  fd_set fdin;
+  FD_ZERO(&fdin);
+  FD_SET(m_receive_socket, &fdin);
+
+  if (select(m_receive_socket + 1, &fdin, 0, 0, &tv) > 0) {
+    char data[16];
+    if (recv(m_receive_socket, data, sizeof(data), 0) > 0) {
+      LOG_VERBOSE(wxT("BR24radar_pi: %s received stop instruction"), m_ri->m_name.c_str());
+      return true;
+    }
+  }
+  return false;
+}
+
+#ifdef BR24_HAVE_ZLIB
+// ReplayCapture
+// -------------
+// Instead of listening to the network, feed the data, report and command datagrams for this
+// radar from a pcap or pcapng capture (gzip compressed or not) into ProcessFrame, ProcessReport
+// and ProcessCommand. With speed 1 the data is replayed at the recorded rate, with N at N
+// times that rate and with 0 as fast as possible. The capture is repeated until we are told
+// to stop.
+// Returns true when asked to stop, false when the file could not be read.
+//
+bool br24Receive::ReplayCapture(const wxString &filename, double speed) {
+  PcapReader reader;
+  PcapPacket packet;
+  int radar = m_ri->m_radar;
+  int packets = 0;
+
+  LOG_INFO(wxT("BR24radar_pi: %s replaying %s at speed %g"), m_ri->m_name.c_str(), filename.c_str(), speed);
+
+  while (true) {
+    if (!reader.Open(filename.mb_str())) {
+      wxLogError(wxT("BR24radar_pi: %s cannot replay capture file %s"), m_ri->m_name.c_str(), filename.c_str());
+      return false;
+    }
+
+    int64_t first_us = -1;
+    int64_t start_ms = wxGetUTCTimeMillis().GetValue();
+
+    while (reader.NextUDP(&packet)) {
+      int wait_ms = 0;
+
+      if (first_us < 0) {
+        first_us = packet.time_us;
+      }
+      if (speed > 0.) {
+        int64_t due_ms = start_ms + (int64_t)((packet.time_us - first_us) / 1000 / speed);
+        wait_ms = (int)MAX(due_ms - wxGetUTCTimeMillis().GetValue(), 0);
+      }
+      // Look for a stop request whenever we have to wait anyway, and regularly when we are behind
+      if ((wait_ms > 0 || (++packets & 63) == 0) && StopRequested(wait_ms)) {
+        return true;
+      }
+
+      if (packet.dst_port == LISTEN_DATA[radar].port) {
+        ProcessFrame(packet.data, packet.len);
+      } else if (packet.dst_port == LISTEN_REPORT[radar].port) {
+        ProcessReport(packet.data, packet.len);
+      } else if (packet.dst_port == LISTEN_COMMAND[radar].port) {
+        UINT8 *a = (UINT8 *)&packet.src_addr;
+        wxString addr;
+        addr.Printf(wxT("%u.%u.%u.%u"), a[0], a[1], a[2], a[3]);
+        ProcessCommand(addr, packet.data, packet.len);
+      }
+    }
+
+    if (first_us < 0) {
+      wxLogError(wxT("BR24radar_pi: %s capture file %s contains no UDP data"), m_ri->m_name.c_str(), filename.c_str());
+      return false;
+    }
+    LOG_VERBOSE(wxT("BR24radar_pi: %s end of capture file, restarting replay"), m_ri->m_name.c_str());
+  }
+}
+#endif
+
 SOCKET br24Receive::PickNextEthernetCard() {
   SOCKET socket = INVALID_SOCKET;
   m_mcast_addr = 0;
@@ -467,6 +745,7 @@ void *br24Receive::Entry(void) {
   UINT8 *a = (UINT8 *)&rx_addr.ipv4.sin_addr;  // sin_addr is in network layout
 
   UINT8 data[sizeof(radar_frame_pkt)];
+  UINT8 *frames = (UINT8 *)malloc(FRAMES_PER_BATCH * sizeof(radar_frame_pkt));
   m_interface_array = 0;
   m_interface = 0;
   struct sockaddr_in radarFoundAddr;
@@ -478,11 +757,26 @@ void *br24Receive::Entry(void) {
 
   LOG_VERBOSE(wxT("BR24radar_pi: br24Receive thread %s starting"), m_ri->m_name.c_str());
 
-  if (m_mcast_addr) {
+  if (!frames) {
+    wxLogError(wxT("BR24radar_pi: Out of memory"));
+    m_is_shutdown = true;
+    return 0;
+  }
+
+  bool stop = false;
+  if (m_pi->m_settings.replay_file.length() > 0) {
+#ifdef BR24_HAVE_ZLIB
+    stop = ReplayCapture(m_pi->m_settings.replay_file, m_pi->m_settings.replay_speed);
+#else
+    wxLogError(wxT("BR24radar_pi: %s cannot replay capture files, this build has no zlib"), m_ri->m_name.c_str());
+#endif
+  }
+
+  if (m_mcast_addr && !stop) {
     reportSocket = GetNewReportSocket();
   }
 
-  while (true) {
+  while (!stop) {
     if (!m_pi->m_settings.emulator_on) {
       if (reportSocket == INVALID_SOCKET) {
         reportSocket = PickNextEthernetCard();
@@ -556,10 +850,8 @@ void *br24Receive::Entry(void) {
       }
 
       if (dataSocket != INVALID_SOCKET && FD_ISSET(dataSocket, &fdin)) {
-        rx_len = sizeof(rx_addr);
-        r = recvfrom(dataSocket, (char *)data, sizeof(data), 0, (struct sockaddr *)&rx_addr, &rx_len);
+        r = ReceiveDataFrames(dataSocket, frames);
         if (r > 0) {
-          ProcessFrame(data, r);
           no_data_timeout = -15;
           no_spoke_timeout = -5;
         } else {
@@ -634,6 +926,7 @@ void *br24Receive::Entry(void) {
 
       if (no_spoke_timeout >= SECONDS_SELECT(2)) {
         no_spoke_timeout = 0;
+        wxCriticalSectionLocker lock(m_ri->m_exclusive);
         m_ri->ResetRadarImage();
       } else {
         no_spoke_timeout++;
@@ -674,6 +967,7 @@ void *br24Receive::Entry(void) {
   if (m_interface_array) {
     freeifaddrs(m_interface_array);
   }
+  free(frames);
 
 #ifdef TEST_THREAD_RACES
   LOG_VERBOSE(wxT("BR24radar_pi: %s receive thread sleeping"), m_ri->m_name.c_str());
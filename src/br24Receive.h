@@ -38,6 +38,18 @@
 
 PLUGIN_BEGIN_NAMESPACE
 
+// The decoded header of a single spoke in a radar frame
+struct SpokeHeader {
+  int header_len;
+  int status;
+  int spoke;          // Sequence number, 0 .. SPOKES - 1
+  int angle_raw;      // Angle relative to the boat, 0 .. SPOKES - 1
+  short heading_raw;  // Heading sent by the radar, see HEADING_VALID
+  int range_raw;
+  int range_meters;
+  RadarType type;  // RT_BR24 (also for 3G) or RT_4G
+};
+
 class br24Receive : public wxThread {
  public:
   br24Receive(br24radar_pi *pi, RadarInfo *ri) : wxThread(wxTHREAD_JOINABLE), m_pi(pi), m_ri(ri) {
@@ -87,6 +99,10 @@ class br24Receive : public wxThread {
   void *Entry(void);
   void Shutdown(void);
 
+  // Frame layout, also used by radar-bench to read spokes from a capture file
+  static int GetSpokeCount(int len);
+  static const UINT8 *DecodeSpoke(const UINT8 *frame, int scanline, SpokeHeader *header);
+
   sockaddr_in m_initial_mcast_addr;
   sockaddr_in *m_mcast_addr;
   wxIPV4address m_ip_addr;
@@ -98,11 +114,19 @@ class br24Receive : public wxThread {
  private:
   void logBinaryData(const wxString &what, const UINT8 *data, int size);
 
+  int ReceiveDataFrames(SOCKET socket, UINT8 *frames);
   void ProcessFrame(const UINT8 *data, int len);
+  void QueueSpoke(SpokeBearing angle, SpokeBearing bearing, UINT8 *data, size_t len, int range_meters, wxLongLong time_rec,
+                  double lat, double lon, receive_statistics *stats);
+  void AddStatistics(const receive_statistics &stats);
   bool ProcessReport(const UINT8 *data, int len);
   void ProcessCommand(wxString &addr, const UINT8 *data, int len);
 
   void EmulateFakeBuffer(void);
+#ifdef BR24_HAVE_ZLIB
+  bool ReplayCapture(const wxString &filename, double speed);
+#endif
+  bool StopRequested(int millis);
   SOCKET PickNextEthernetCard();
   SOCKET GetNewReportSocket();
   SOCKET GetNewDataSocket();
@@ -33,6 +33,7 @@
 #include "GuardZoneBogey.h"
 #include "Kalman.h"
 #include "RadarMarpa.h"
+#include "drawutil.h"
 #include "icons.h"
 #include "nmea0183/nmea0183.h"
 
@@ -130,6 +131,7 @@ br24radar_pi::br24radar_pi(void *ppimgr) : opencpn_plugin_114(ppimgr) {
   m_opencpn_gl_context_broken = false;
 
   m_timer = 0;
+  m_lookup_thread = 0;
 
   m_first_init = true;
 }
@@ -202,6 +204,9 @@ int br24radar_pi::Init(void) {
   m_hdm_timeout = now + WATCHDOG_TIMEOUT;
   m_var_timeout = now + WATCHDOG_TIMEOUT;
   m_cog_timeout = now;
+  m_sog = 0.;
+  m_sog_cog = 0.;
+  m_sog_timeout = 0;
   m_idle_standby = 0;
   m_idle_transmit = 0;
   m_heading_source = HEADING_NONE;
@@ -228,6 +233,16 @@ int br24radar_pi::Init(void) {
   m_pMessageBox = new br24MessageBox;
   m_pMessageBox->Create(m_parent_window, this);
 
+  // The polar lookup table is needed as soon as the first spoke arrives, build it while we start up
+  if (!m_lookup_thread) {
+    m_lookup_thread = new PolarLookupThread;
+    if (m_lookup_thread->Run() != wxTHREAD_NO_ERROR) {
+      LOG_INFO(wxT("BR24radar_pi: unable to start lookup table thread, table will be built on first use."));
+      delete m_lookup_thread;
+      m_lookup_thread = 0;
+    }
+  }
+
   // Create objects before config, so config can set data in it
   // This does not start any threads or generate any UI.
   for (int r = 0; r < RADARS; r++) {
@@ -351,6 +366,12 @@ bool br24radar_pi::DeInit(void) {
 
   SaveConfig();
 
+  if (m_lookup_thread) {
+    m_lookup_thread->Wait();
+    delete m_lookup_thread;
+    m_lookup_thread = 0;
+  }
+
   // Delete the RadarInfo objects. This will call their destructor and delete all data.
   for (int r = 0; r < RADARS; r++) {
     delete m_radar[r];
@@ -667,6 +688,18 @@ wxString br24radar_pi::GetGuardZoneText(RadarInfo *ri) {
       }
     }
   }
+  for (size_t z = 0; z < ri->m_polygon_zones.Size(); z++) {
+    int bogeys = ri->m_polygon_zones.GetBogeyCount(z);
+    if (ri->m_polygon_zones.Zone(z).alarm_on && (bogeys > 0 || (m_guard_bogey_confirmed && bogeys == 0))) {
+      if (text.length() > 0) {
+        text << wxT("\n");
+      }
+      text << _("Polygon") << wxT(" ") << (int)z + 1 << wxT(": ") << bogeys;
+      if (m_guard_bogey_confirmed) {
+        text << wxT(" ") << _("(Confirmed)");
+      }
+    }
+  }
 
   return text;
 }
@@ -707,6 +740,38 @@ void br24radar_pi::CheckGuardZoneBogeys(void) {
         }
         text << wxT("\n");
       }
+
+      for (size_t z = 0; z < m_radar[r]->m_polygon_zones.Size(); z++) {
+        if (!m_radar[r]->m_polygon_zones.Zone(z).alarm_on) {
+          continue;
+        }
+        int bogeys = m_radar[r]->m_polygon_zones.GetBogeyCount(z);
+        if (bogeys > m_settings.guard_zone_threshold) {
+          bogeys_found = true;
+          bogeys_found_this_radar = true;
+          m_settings.timed_idle = 0;  // reset timed idle to off
+        }
+        text << _(" Polygon") << wxT(" ") << (int)z + 1 << wxT(": ");
+        if (bogeys > m_settings.guard_zone_threshold) {
+          text << bogeys;
+        } else if (bogeys >= 0) {
+          text << wxT("(") << bogeys << wxT(")");
+        } else {
+          text << wxT("-");
+        }
+        text << wxT("\n");
+      }
+
+      // ARPA targets on a collision course count as bogeys too
+      if (m_settings.cpa_alarm_nm > 0. && m_radar[r]->m_arpa) {
+        int dangerous = m_radar[r]->m_arpa->GetCpaAlarmCount();
+        if (dangerous > 0) {
+          bogeys_found = true;
+          bogeys_found_this_radar = true;
+          m_settings.timed_idle = 0;  // reset timed idle to off
+          text << _(" CPA") << wxT(": ") << dangerous << wxT("\n");
+        }
+      }
       LOG_GUARD(wxT("BR24radar_pi: Radar %c: CheckGuardZoneBogeys found=%d confirmed=%d"), r + 'A', bogeys_found_this_radar,
                 m_guard_bogey_confirmed);
     }
@@ -787,6 +852,12 @@ void br24radar_pi::CheckTimedTransmit(RadarState state) {
   }
 }
 
+// Must be called with m_exclusive held, which also keeps the heading history to one writer
+void br24radar_pi::SetHeadingTrue(double hdt) {
+  m_hdt = hdt;
+  m_heading_history.Add(wxGetUTCTimeMillis().ToDouble(), hdt);
+}
+
 void br24radar_pi::SetRadarHeading(double heading, bool isTrue) {
   wxCriticalSectionLocker lock(m_exclusive);
   m_radar_heading = heading;
@@ -798,7 +869,7 @@ void br24radar_pi::SetRadarHeading(double heading, bool isTrue) {
         m_heading_source = HEADING_RADAR_HDT;
       }
       if (m_heading_source == HEADING_RADAR_HDT) {
-        m_hdt = m_radar_heading;
+        SetHeadingTrue(m_radar_heading);
         m_hdt_timeout = now + HEADING_TIMEOUT;
       }
     } else {
@@ -807,7 +878,7 @@ void br24radar_pi::SetRadarHeading(double heading, bool isTrue) {
       }
       if (m_heading_source == HEADING_RADAR_HDM) {
         m_hdm = m_radar_heading;
-        m_hdt = m_radar_heading + m_var;
+        SetHeadingTrue(m_radar_heading + m_var);
         m_hdm_timeout = now + HEADING_TIMEOUT;
       }
     }
@@ -970,12 +1041,14 @@ void br24radar_pi::TimedControlUpdate() {
     wxString t;
     for (size_t r = 0; r < RADARS; r++) {
       if (m_radar[r]->m_state.GetValue() != RADAR_OFF) {
-        wxCriticalSectionLocker lock(m_radar[r]->m_exclusive);
-
-        t << wxString::Format(wxT("%s\npackets %d/%d\nspokes %d/%d/%d\n"), m_radar[r]->m_name.c_str(),
-                              m_radar[r]->m_statistics.packets, m_radar[r]->m_statistics.broken_packets,
-                              m_radar[r]->m_statistics.spokes, m_radar[r]->m_statistics.broken_spokes,
-                              m_radar[r]->m_statistics.missing_spokes);
+        wxCriticalSectionLocker lock(m_radar[r]->m_statistics_lock);
+
+        t << wxString::Format(wxT("%s\npackets %d/%d\nbatches %d/%d\nspokes %d/%d/%d\nqueue %d/%d\n"),
+                              m_radar[r]->m_name.c_str(), m_radar[r]->m_statistics.packets,
+                              m_radar[r]->m_statistics.broken_packets, m_radar[r]->m_statistics.batches,
+                              m_radar[r]->m_statistics.max_batch, m_radar[r]->m_statistics.spokes,
+                              m_radar[r]->m_statistics.broken_spokes, m_radar[r]->m_statistics.missing_spokes,
+                              m_radar[r]->m_statistics.queue_depth, m_radar[r]->m_statistics.queue_overflows);
       }
     }
     m_pMessageBox->SetStatisticsInfo(t);
@@ -987,13 +1060,17 @@ void br24radar_pi::TimedControlUpdate() {
 
   // Always reset the counters, so they don't show huge numbers after IsShown changes
   for (int r = 0; r < RADARS; r++) {
-    wxCriticalSectionLocker lock(m_radar[r]->m_exclusive);
+    wxCriticalSectionLocker lock(m_radar[r]->m_statistics_lock);
 
     m_radar[r]->m_statistics.broken_packets = 0;
     m_radar[r]->m_statistics.broken_spokes = 0;
     m_radar[r]->m_statistics.missing_spokes = 0;
     m_radar[r]->m_statistics.packets = 0;
     m_radar[r]->m_statistics.spokes = 0;
+    m_radar[r]->m_statistics.batches = 0;
+    m_radar[r]->m_statistics.max_batch = 0;
+    m_radar[r]->m_statistics.queue_depth = 0;
+    m_radar[r]->m_statistics.queue_overflows = 0;
   }
 
   wxString info;
@@ -1261,6 +1338,22 @@ bool br24radar_pi::LoadConfig(void) {
           pConf->Read(wxString::Format(wxT("Radar%dZone%dArpaOn"), r, i), &m_radar[r]->m_guard_zone[i]->m_arpa_on, 0);
           m_radar[r]->m_guard_zone[i]->SetType((GuardZoneType)v);
         }
+        m_radar[r]->m_polygon_zones.Clear();
+        for (int i = 0; i < POLYGON_ZONES; i++) {
+          wxString points;
+          if (!pConf->Read(wxString::Format(wxT("Radar%dPolygon%dPoints"), r, i), &points)) {
+            break;
+          }
+          PolygonZone zone;
+          if (!ParsePolygonPoints(points.mb_str(), &zone.points)) {
+            LOG_INFO(wxT("BR24radar_pi: LoadConfig: Radar%dPolygon%dPoints '%s' is not lat,lon;lat,lon;lat,lon..."), r, i,
+                     points.c_str());
+            continue;
+          }
+          pConf->Read(wxString::Format(wxT("Radar%dPolygon%dAlarmOn"), r, i), &zone.alarm_on, true);
+          pConf->Read(wxString::Format(wxT("Radar%dPolygon%dArpaOn"), r, i), &zone.arpa_on, false);
+          m_radar[r]->m_polygon_zones.Add(zone);
+        }
       }
       pConf->Read(wxT("AlarmPosX"), &x, 25);
       pConf->Read(wxT("AlarmPosY"), &y, 175);
@@ -1270,8 +1363,11 @@ bool br24radar_pi::LoadConfig(void) {
       if (m_settings.AISatARPAoffset < 10 || m_settings.AISatARPAoffset > 200) m_settings.AISatARPAoffset = 40;
     }
 
+    pConf->Read(wxT("ArpaSendTLL"), &m_settings.arpa_send_tll, false);
     pConf->Read(wxT("AlertAudioFile"), &m_settings.alert_audio_file, m_shareLocn + wxT("alarm.wav"));
     pConf->Read(wxT("ChartOverlay"), &m_settings.chart_overlay, 0);
+    pConf->Read(wxT("CpaAlarm"), &m_settings.cpa_alarm_nm, 0.0);
+    pConf->Read(wxT("CpaAlarmMinutes"), &m_settings.tcpa_alarm_minutes, 6.0);
     pConf->Read(wxT("ColourStrong"), &s, "red");
     m_settings.strong_colour = wxColour(s);
     pConf->Read(wxT("ColourIntermediate"), &s, "green");
@@ -1302,6 +1398,8 @@ bool br24radar_pi::LoadConfig(void) {
     pConf->Read(wxT("PassHeadingToOCPN"), &m_settings.pass_heading_to_opencpn, false);
     pConf->Read(wxT("RadarInterface"), &m_settings.mcast_address);
     pConf->Read(wxT("Refreshrate"), &m_settings.refreshrate, 3);
+    pConf->Read(wxT("ReplayFile"), &m_settings.replay_file, wxT(""));
+    pConf->Read(wxT("ReplaySpeed"), &m_settings.replay_speed, 1.0);
     pConf->Read(wxT("ReverseZoom"), &m_settings.reverse_zoom, false);
     pConf->Read(wxT("ScanMaxAge"), &m_settings.max_age, 6);
     pConf->Read(wxT("Show"), &m_settings.show, true);
@@ -1320,6 +1418,9 @@ bool br24radar_pi::LoadConfig(void) {
 
     m_settings.max_age = wxMax(wxMin(m_settings.max_age, MAX_AGE), MIN_AGE);
     m_settings.refreshrate = wxMax(wxMin(m_settings.refreshrate, 5), 1);
+    m_settings.replay_speed = wxMax(m_settings.replay_speed, 0.0);
+    m_settings.cpa_alarm_nm = wxMax(m_settings.cpa_alarm_nm, 0.0);
+    m_settings.tcpa_alarm_minutes = wxMax(m_settings.tcpa_alarm_minutes, 0.0);
 
     SaveConfig();
     return true;
@@ -1337,7 +1438,10 @@ bool br24radar_pi::SaveConfig(void) {
     pConf->Write(wxT("AlarmPosX"), m_settings.alarm_pos.x);
     pConf->Write(wxT("AlarmPosY"), m_settings.alarm_pos.y);
     pConf->Write(wxT("AlertAudioFile"), m_settings.alert_audio_file);
+    pConf->Write(wxT("ArpaSendTLL"), m_settings.arpa_send_tll);
     pConf->Write(wxT("ChartOverlay"), m_settings.chart_overlay);
+    pConf->Write(wxT("CpaAlarm"), m_settings.cpa_alarm_nm);
+    pConf->Write(wxT("CpaAlarmMinutes"), m_settings.tcpa_alarm_minutes);
     pConf->Write(wxT("DeveloperMode"), m_settings.developer_mode);
     pConf->Write(wxT("DrawingMethod"), m_settings.drawing_method);
     pConf->Write(wxT("EmulatorOn"), m_settings.emulator_on);
@@ -1358,6 +1462,8 @@ bool br24radar_pi::SaveConfig(void) {
     pConf->Write(wxT("RadarInterface"), m_settings.mcast_address);
     pConf->Write(wxT("RangeUnits"), (int)m_settings.range_units);
     pConf->Write(wxT("Refreshrate"), m_settings.refreshrate);
+    pConf->Write(wxT("ReplayFile"), m_settings.replay_file);
+    pConf->Write(wxT("ReplaySpeed"), m_settings.replay_speed);
     pConf->Write(wxT("ReverseZoom"), m_settings.reverse_zoom);
     pConf->Write(wxT("RunTimeOnIdle"), m_settings.idle_run_time);
     pConf->Write(wxT("ScanMaxAge"), m_settings.max_age);
@@ -1404,6 +1510,20 @@ bool br24radar_pi::SaveConfig(void) {
         pConf->Write(wxString::Format(wxT("Radar%dZone%dAlarmOn"), r, i), m_radar[r]->m_guard_zone[i]->m_alarm_on);
         pConf->Write(wxString::Format(wxT("Radar%dZone%dArpaOn"), r, i), m_radar[r]->m_guard_zone[i]->m_arpa_on);
       }
+      // The zones are written from 0 up, but LoadConfig skips malformed ones, so remove the old
+      // entries first; otherwise a stale entry above the last zone would be loaded again.
+      for (int i = 0; i < POLYGON_ZONES; i++) {
+        pConf->DeleteEntry(wxString::Format(wxT("Radar%dPolygon%dPoints"), r, i));
+        pConf->DeleteEntry(wxString::Format(wxT("Radar%dPolygon%dAlarmOn"), r, i));
+        pConf->DeleteEntry(wxString::Format(wxT("Radar%dPolygon%dArpaOn"), r, i));
+      }
+      for (size_t i = 0; i < m_radar[r]->m_polygon_zones.Size(); i++) {
+        const PolygonZone &zone = m_radar[r]->m_polygon_zones.Zone(i);
+        pConf->Write(wxString::Format(wxT("Radar%dPolygon%dPoints"), r, (int)i),
+                     wxString::FromAscii(FormatPolygonPoints(zone.points).c_str()));
+        pConf->Write(wxString::Format(wxT("Radar%dPolygon%dAlarmOn"), r, (int)i), zone.alarm_on);
+        pConf->Write(wxString::Format(wxT("Radar%dPolygon%dArpaOn"), r, (int)i), zone.arpa_on);
+      }
     }
 
     pConf->Flush();
@@ -1453,7 +1573,7 @@ void br24radar_pi::SetPositionFixEx(PlugIn_Position_Fix_Ex &pfix) {
       m_heading_source = HEADING_FIX_HDT;
     }
     if (m_heading_source == HEADING_FIX_HDT) {
-      m_hdt = pfix.Hdt;
+      SetHeadingTrue(pfix.Hdt);
       m_hdt_timeout = now + HEADING_TIMEOUT;
     }
   } else if (!wxIsNaN(pfix.Hdm) && NOT_TIMED_OUT(now, m_var_timeout)) {
@@ -1463,7 +1583,7 @@ void br24radar_pi::SetPositionFixEx(PlugIn_Position_Fix_Ex &pfix) {
     }
     if (m_heading_source == HEADING_FIX_HDM) {
       m_hdm = pfix.Hdm;
-      m_hdt = pfix.Hdm + m_var;
+      SetHeadingTrue(pfix.Hdm + m_var);
       m_hdm_timeout = now + HEADING_TIMEOUT;
     }
   } else if (!wxIsNaN(pfix.Cog) && m_settings.enable_cog_heading) {
@@ -1472,7 +1592,7 @@ void br24radar_pi::SetPositionFixEx(PlugIn_Position_Fix_Ex &pfix) {
       m_heading_source = HEADING_FIX_COG;
     }
     if (m_heading_source == HEADING_FIX_COG) {
-      m_hdt = pfix.Cog;
+      SetHeadingTrue(pfix.Cog);
       m_hdt_timeout = now + HEADING_TIMEOUT;
     }
   }
@@ -1491,6 +1611,11 @@ void br24radar_pi::SetPositionFixEx(PlugIn_Position_Fix_Ex &pfix) {
   if (!wxIsNaN(pfix.Cog)) {
     UpdateCOGAvg(pfix.Cog);
   }
+  if (!wxIsNaN(pfix.Cog) && !wxIsNaN(pfix.Sog)) {
+    m_sog = pfix.Sog;
+    m_sog_cog = pfix.Cog;
+    m_sog_timeout = now + WATCHDOG_TIMEOUT;
+  }
   if (TIMED_OUT(now, m_cog_timeout)) {
     m_cog_timeout = now + m_COGAvgSec;
     m_cog = m_COGAvg;
@@ -1562,7 +1687,7 @@ void br24radar_pi::SetPluginMessage(wxString &message_id, wxString &message_body
         }
       }
     }
-  } else if (message_id == wxS("AIS") || m_ais_in_arpa_zone.size() > 0) {
+  } else if (message_id == wxS("AIS") || m_ais_in_arpa_zone.Size() > 0) {
     // Check if any Radar and ARPA zone is active
     double ArpaMaxRange = 0.0;
     bool ArpaGuardOn = false;
@@ -1581,66 +1706,49 @@ void br24radar_pi::SetPluginMessage(wxString &message_id, wxString &message_body
       }
     }
     if (ArpaGuardOn) {
-      wxJSONReader reader;
-      wxJSONValue message;
-      if (!reader.Parse(message_body, &message)) {
-        wxJSONValue defaultValue(999);
-        long json_ais_mmsi = message.Get(_T("mmsi"), defaultValue).AsLong();
-        if (json_ais_mmsi > 200000000) {  // Neither ARPA targets nor SAR_aircraft
-          wxJSONValue defaultValue("90.0");
-          double f_AISLat = wxAtof(message.Get(_T("lat"), defaultValue).AsString());
-          double f_AISLon = wxAtof(message.Get(_T("lon"), defaultValue).AsString());
-          // Rectangle around own ship to look for AIS targets.
-          double d_side = ArpaMaxRange / 1852.0 / 60.0;
-          if (f_AISLat < (m_radar_lat + d_side) && f_AISLat > (m_radar_lat - d_side) && f_AISLon < (m_radar_lon + d_side * 2) &&
-              f_AISLon > (m_radar_lon - d_side * 2)) {
-            bool updated = false;
-            for (size_t i = 0; i < m_ais_in_arpa_zone.size(); i++) {  // Check for existing mmsi
-              if (m_ais_in_arpa_zone[i].ais_mmsi == json_ais_mmsi) {
-                m_ais_in_arpa_zone[i].ais_time_upd = time(0);
-                m_ais_in_arpa_zone[i].ais_lat = f_AISLat;
-                m_ais_in_arpa_zone[i].ais_lon = f_AISLon;
-                updated = true;
-                break;
-              }
-            }
-            if (!updated) {  // Add a new target
-              AisArpa m_new_ais_target;
-              m_new_ais_target.ais_mmsi = json_ais_mmsi;
-              m_new_ais_target.ais_time_upd = time(0);
-              m_new_ais_target.ais_lat = f_AISLat;
-              m_new_ais_target.ais_lon = f_AISLon;
-              m_ais_in_arpa_zone.push_back(m_new_ais_target);
-            }
-          }
+      long json_ais_mmsi;
+      double f_AISLat;
+      double f_AISLon;
+      // The AIS messages of OpenCPN are read without wxJSONReader, anything else falls back to it
+      bool parsed = ParseAisJson(message_body.wc_str(), &json_ais_mmsi, &f_AISLat, &f_AISLon);
+      if (!parsed) {
+        wxJSONReader reader;
+        wxJSONValue message;
+        if (!reader.Parse(message_body, &message)) {
+          wxJSONValue defaultValue(999);
+          json_ais_mmsi = message.Get(_T("mmsi"), defaultValue).AsLong();
+          wxJSONValue defaultPosition("90.0");
+          f_AISLat = wxAtof(message.Get(_T("lat"), defaultPosition).AsString());
+          f_AISLon = wxAtof(message.Get(_T("lon"), defaultPosition).AsString());
+          parsed = true;
+        }
+      }
+      if (parsed && json_ais_mmsi > 200000000) {  // Neither ARPA targets nor SAR_aircraft
+        // Rectangle around own ship to look for AIS targets.
+        double d_side = ArpaMaxRange / 1852.0 / 60.0;
+        if (f_AISLat < (m_radar_lat + d_side) && f_AISLat > (m_radar_lat - d_side) && f_AISLon < (m_radar_lon + d_side * 2) &&
+            f_AISLon > (m_radar_lon - d_side * 2)) {
+          wxCriticalSectionLocker lock(m_ais_lock);
+          m_ais_in_arpa_zone.Update(json_ais_mmsi, f_AISLat, f_AISLon, time(0));
         }
       }
     }
     // Delete > 3 min old AIS items or at once if neither active ARPA zone nor Radar
-    if (m_ais_in_arpa_zone.size() > 0) {
-      for (size_t i = 0; i < m_ais_in_arpa_zone.size(); i++) {
-        if (m_ais_in_arpa_zone[i].ais_mmsi > 0 && ((time(0) - m_ais_in_arpa_zone[i].ais_time_upd) > (3 * 60) || !ArpaGuardOn)) {
-          m_ais_in_arpa_zone.erase(m_ais_in_arpa_zone.begin() + i);
-        }
+    if (m_ais_in_arpa_zone.Size() > 0) {
+      wxCriticalSectionLocker lock(m_ais_lock);
+      if (ArpaGuardOn) {
+        m_ais_in_arpa_zone.Expire(time(0), 3 * 60);
+      } else {
+        m_ais_in_arpa_zone.Clear();
       }
     }
   }
 }
 
 bool br24radar_pi::FindAIS_at_arpaPos(const double &lat, const double &lon, const double &dist) {
-  if (m_ais_in_arpa_zone.size() < 1) return false;
-  bool hit = false;
+  wxCriticalSectionLocker lock(m_ais_lock);
   double offset = dist / 1852. / 60.;
-  for (size_t i = 0; i < m_ais_in_arpa_zone.size(); i++) {
-    if (m_ais_in_arpa_zone[i].ais_mmsi != 0) {  // Avtive post
-      if (lat + offset > m_ais_in_arpa_zone[i].ais_lat && lat - offset < m_ais_in_arpa_zone[i].ais_lat &&
-          lon + (offset * 1.75) > m_ais_in_arpa_zone[i].ais_lon && lon - (offset * 1.75) < m_ais_in_arpa_zone[i].ais_lon) {
-        hit = true;
-        break;
-      }
-    }
-  }
-  return hit;
+  return m_ais_in_arpa_zone.FindNear(lat, lon, offset, offset * 1.75);
 }
 
 bool br24radar_pi::SetControlValue(int radar, ControlType controlType, int value,
@@ -1800,6 +1908,8 @@ void br24radar_pi::SetNMEASentence(wxString &sentence) {
     }
   }
 
+  wxCriticalSectionLocker lock(m_exclusive);  // the radar receive threads also set the heading
+
   if (!wxIsNaN(hdt)) {
     if (m_heading_source < HEADING_NMEA_HDT) {
       //   LOG_INFO(wxT("BR24radar_pi: Heading source is now HDT %d from NMEA %s (%d->%d)"), m_hdt, sentence.c_str(),
@@ -1808,7 +1918,7 @@ void br24radar_pi::SetNMEASentence(wxString &sentence) {
       m_heading_source = HEADING_NMEA_HDT;
     }
     if (m_heading_source == HEADING_NMEA_HDT) {
-      m_hdt = hdt;
+      SetHeadingTrue(hdt);
       m_hdt_timeout = now + HEADING_TIMEOUT;
     }
   } else if (!wxIsNaN(hdm) && NOT_TIMED_OUT(now, m_var_timeout)) {
@@ -1819,7 +1929,7 @@ void br24radar_pi::SetNMEASentence(wxString &sentence) {
     }
     if (m_heading_source == HEADING_NMEA_HDM) {
       m_hdm = hdm;
-      m_hdt = hdm + m_var;
+      SetHeadingTrue(hdm + m_var);
       m_hdm_timeout = now + HEADING_TIMEOUT;
     }
   }
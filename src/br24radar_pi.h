@@ -36,6 +36,9 @@
 #define MY_API_VERSION_MINOR 14  // Needed for PluginAISDrawGL().
 
 #include <vector>
+#include "AisIndex.h"
+#include "AisJson.h"
+#include "HeadingHistory.h"
 #include "jsonreader.h"
 #include "nmea0183/nmea0183.h"
 #include "pi_common.h"
@@ -68,6 +71,9 @@ class br24Transmit;
 class br24radar_pi;
 class GuardZoneBogey;
 class RadarArpa;
+class SpokeProcessThread;
+class ArpaThread;
+class PolarLookupThread;
 
 #define RADARS (2)         // Number of radars supported by this PI. 2 since 4G supports 2. More work
                            // needed if you intend to add multiple radomes to network!
@@ -147,6 +153,10 @@ struct receive_statistics {
   int spokes;
   int broken_spokes;
   int missing_spokes;
+  int batches;    // # of times the data socket was drained
+  int max_batch;  // Largest # of frames received in a single batch
+  int queue_depth;      // Highest # of spokes waiting to be processed
+  int queue_overflows;  // # of spokes dropped because the spoke queue was full
 };
 
 // WARNING
@@ -316,6 +326,8 @@ struct PersistentSettings {
   bool enable_cog_heading;          // Allow COG as heading. Should be taken out back and shot.
   bool enable_dual_radar;           // Should the dual radar be enabled for 4G?
   bool emulator_on;                 // Emulator, useful when debugging without radar
+  wxString replay_file;             // Replay this pcap(.gz) capture instead of listening to the network
+  double replay_speed;              // 1 = as recorded, N = N times faster, 0 = as fast as possible
   bool ignore_radar_heading;        // For testing purposes
   bool reverse_zoom;                // false = normal, true = reverse
   bool show_extreme_range;          // Show red ring at extreme range and center
@@ -328,6 +340,9 @@ struct PersistentSettings {
   int antenna_forward;              // Ofsett of radar antenne forward of GPS antenna
   int type_detection_method;        // 0 = default, 1 = ignore reports
   int AISatARPAoffset;              // Rectangle side where to search AIS targets at ARPA position
+  double cpa_alarm_nm;              // Alarm when an ARPA target comes closer than this, 0 = off
+  double tcpa_alarm_minutes;        // ... within this many minutes
+  bool arpa_send_tll;               // Also pass ARPA targets to OpenCPN as TLL (position) sentences
   wxPoint control_pos[RADARS];      // Saved position of control menu windows
   wxPoint window_pos[RADARS];       // Saved position of radar windows, when floating and not docked
   wxPoint alarm_pos;                // Saved position of alarm window
@@ -354,16 +369,6 @@ struct scan_line {
   // a 1 is added in the rightmost position, if below threshold, a 0.
 };
 
-// Table for AIS targets inside ARPA zone
-struct AisArpa {
-  long ais_mmsi;
-  time_t ais_time_upd;
-  double ais_lat;
-  double ais_lon;
-
-  AisArpa() : ais_mmsi(0), ais_time_upd(), ais_lat(), ais_lon() {}
-};
-
 //----------------------------------------------------------------------------------------------------------
 //    The PlugIn Class Definition
 //----------------------------------------------------------------------------------------------------------
@@ -449,6 +454,12 @@ class br24radar_pi : public opencpn_plugin_114, public wxEvtHandler {
     wxCriticalSectionLocker lock(m_exclusive);
     return m_hdt;
   }
+  // Heading true at the time a spoke was received, without taking the lock
+  bool GetHeadingTrueAt(wxLongLong time, double *hdt) { return m_heading_history.HeadingAt(time.ToDouble(), hdt); }
+  double GetVariation() {
+    wxCriticalSectionLocker lock(m_exclusive);
+    return m_var;
+  }
   time_t GetHeadingTrueTimeout() {
     wxCriticalSectionLocker lock(m_exclusive);
     return m_hdt_timeout;
@@ -465,6 +476,16 @@ class br24radar_pi : public opencpn_plugin_114, public wxEvtHandler {
     wxCriticalSectionLocker lock(m_exclusive);
     return m_cog;
   }
+  bool GetOwnShipMotion(double *sog, double *cog) {
+    wxCriticalSectionLocker lock(m_exclusive);
+
+    if (TIMED_OUT(time(0), m_sog_timeout)) {
+      return false;
+    }
+    *sog = m_sog;
+    *cog = m_sog_cog;
+    return true;
+  }
   bool GetRadarPosition(double *lat, double *lon) {
     wxCriticalSectionLocker lock(m_exclusive);
 
@@ -492,10 +513,15 @@ class br24radar_pi : public opencpn_plugin_114, public wxEvtHandler {
   wxWindow *m_parent_window;
 
   // Check for AIS targets inside ARPA zone
-  vector<AisArpa> m_ais_in_arpa_zone;  // Array for AIS targets in ARPA zone(s)
+  AisIndex m_ais_in_arpa_zone;         // AIS targets in ARPA zone(s)
+  wxCriticalSection m_ais_lock;        // Only changed by the GUI thread, but read by the ARPA threads
   bool FindAIS_at_arpaPos(const double &lat, const double &lon, const double &dist);
 
  private:
+#ifdef BR24_STAGE_TIMING
+  friend class RadarBench;  // Sets a fixed heading and position
+#endif
+  void SetHeadingTrue(double hdt);
   void RadarSendState(void);
   void UpdateState(void);
   void UpdateHeadingPositionState(void);
@@ -521,6 +547,7 @@ class br24radar_pi : public opencpn_plugin_114, public wxEvtHandler {
   double m_hdt;                    // this is the heading that the pi is using for all heading operations, in degrees.
                                    // m_hdt will come from the radar if available else from the NMEA stream.
   time_t m_hdt_timeout;            // When we consider heading is lost
+  HeadingHistory m_heading_history;  // m_hdt over the last seconds, read without lock by the receive threads
   double m_hdm;                    // Last magnetic heading obtained
   time_t m_hdm_timeout;            // When we consider heading is lost
   double m_radar_heading;          // Last heading obtained from radar, or nan if none
@@ -582,6 +609,9 @@ class br24radar_pi : public opencpn_plugin_114, public wxEvtHandler {
   double m_COGAvg;       // Average COG over m_COGTable
   double m_cog;          // Value of m_COGAvg at rotation time
   time_t m_cog_timeout;  // When m_cog will be set again
+  double m_sog;          // Last speed over ground, knots
+  double m_sog_cog;      // Last course over ground, not averaged
+  time_t m_sog_timeout;  // When m_sog and m_sog_cog are no longer valid
   double m_vp_rotation;  // Last seen vp->rotation
 
   // Keep last state of ContextMenu state sent, to avoid redraws
@@ -608,6 +638,7 @@ class br24radar_pi : public opencpn_plugin_114, public wxEvtHandler {
   bool m_opencpn_gl_context_broken;
 
   wxTimer *m_timer;
+  PolarLookupThread *m_lookup_thread;
 
   DECLARE_EVENT_TABLE()
 };
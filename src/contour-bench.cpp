@@ -0,0 +1,320 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+/*
+ * Micro-benchmark of the ARPA contour tracer.
+ *
+ * Traces every blob edge in one rotation of history lines with each output policy of
+ * TraceContour, and with a copy of the tracer as it was before it became a template,
+ * which tests the history bit at run time for every pixel. The results must agree.
+ *
+ * The history lines are read from a file written by `radar-bench --history FILE`, or
+ * generated when no file is given.
+ */
+
+#include <wx/stopwatch.h>
+#include <vector>
+
+#include "ContourTracer.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define BENCH_MIN_MILLIS (500)     // run each variant at least this long
+#define BENCH_MIN_CONTOUR (80)     // same as the default minimum contour length of a target
+#define BENCH_MAX_CONTOUR (601)    // MAX_CONTOUR_LENGTH
+
+struct HistoryLine {
+  UINT8 line[RETURNS_PER_LINE];
+};
+
+struct ContourPoint {
+  int angle;
+  int r;
+};
+
+struct Seed {
+  int angle;
+  int r;
+};
+
+static HistoryLine history[LINES_PER_ROTATION];
+static ContourPoint contour[BENCH_MAX_CONTOUR + 1];
+
+static unsigned int seed = 1;
+
+static unsigned int Random() {
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) & 0x7fff;
+}
+
+// Boats of various sizes, some of them claimed by a target, plus single pixel clutter
+static void MakeSyntheticHistory() {
+  for (int n = 0; n < 400; n++) {
+    int angle = Random() % LINES_PER_ROTATION;
+    int r = 10 + Random() % (RETURNS_PER_LINE - 60);
+    int spokes = 1 + Random() % 30;
+    int returns = 1 + Random() % 40;
+    UINT8 bits = (n % 4 == 0) ? HISTORY_RETURN : HISTORY_UNCLAIMED | HISTORY_RETURN;
+
+    for (int a = angle; a < angle + spokes; a++) {
+      for (int i = r; i < r + returns; i++) {
+        history[a % LINES_PER_ROTATION].line[i] = bits;
+      }
+    }
+  }
+  for (int n = 0; n < 20000; n++) {
+    history[Random() % LINES_PER_ROTATION].line[Random() % RETURNS_PER_LINE] |= HISTORY_UNCLAIMED | HISTORY_RETURN;
+  }
+}
+
+static bool ReadHistory(const char *name) {
+  FILE *f = fopen(name, "rb");
+  size_t n = 0;
+
+  if (!f) {
+    return false;
+  }
+  for (int a = 0; a < LINES_PER_ROTATION; a++) {
+    n += fread(history[a].line, 1, RETURNS_PER_LINE, f);
+  }
+  fclose(f);
+  return n == LINES_PER_ROTATION * RETURNS_PER_LINE;
+}
+
+/*
+ * The tracer as ArpaTarget had it, with the bit chosen at run time, reduced to the
+ * count-only case.
+ */
+class LegacyTracer {
+ public:
+  bool m_check_for_duplicate;
+
+  bool Pix(int ang, int rad) {
+    if (rad <= 1 || rad >= RETURNS_PER_LINE - 1) {
+      return false;
+    }
+    if (m_check_for_duplicate) {
+      return (history[ang & (LINES_PER_ROTATION - 1)].line[rad] & HISTORY_RETURN) != 0;
+    } else {
+      return (history[ang & (LINES_PER_ROTATION - 1)].line[rad] & HISTORY_UNCLAIMED) != 0;
+    }
+  }
+
+  int Count(int ang, int rad, int length) {  // -1 if no contour, else its length up to length + 1
+    static const int transl_angle[4] = {0, 1, 0, -1};
+    static const int transl_r[4] = {1, 0, -1, 0};
+    int count = 0;
+    int aa = ang;
+    int rr = rad;
+    int index = 0;
+    bool succes = false;
+
+    for (int i = 0; i < 4; i++) {
+      index = i;
+      succes = !Pix(ang + transl_angle[index], rad + transl_r[index]);
+      if (succes) break;
+    }
+    if (!succes) {
+      return -1;
+    }
+    index += 1;
+    if (index > 3) index -= 4;
+    while (aa != ang || rr != rad || count == 0) {
+      int na = 0;
+      int nr = 0;
+
+      index += 3;
+      for (int i = 0; i < 4; i++) {
+        if (index > 3) index -= 4;
+        na = aa + transl_angle[index];
+        nr = rr + transl_r[index];
+        succes = Pix(na, nr);
+        if (succes) break;
+        index += 1;
+      }
+      if (!succes) {
+        return -1;
+      }
+      aa = na;
+      rr = nr;
+      if (count >= length) {
+        return count + 1;
+      }
+      count++;
+    }
+    return count;
+  }
+};
+
+// Seeds are the set pixels whose previous spoke is not set, as FindContourFromInside makes them
+template <UINT8 bit>
+static void FindSeeds(vector<Seed> &seeds) {
+  HistoryPixel<HistoryLine, bit> pix(history);
+
+  for (int a = 0; a < LINES_PER_ROTATION; a++) {
+    for (int r = 3; r < RETURNS_PER_LINE - 1; r++) {
+      if (pix(a, r) && !pix(a - 1, r)) {
+        Seed s = {a, r};
+        seeds.push_back(s);
+      }
+    }
+  }
+}
+
+static int ResultOf(ContourResult result, int count) {
+  if (result == CONTOUR_STOPPED) {
+    return count + 1;
+  }
+  return result == CONTOUR_CLOSED ? count : -1;
+}
+
+template <UINT8 bit>
+static int CheckAgainstLegacy(const vector<Seed> &seeds) {
+  HistoryPixel<HistoryLine, bit> pix(history);
+  LegacyTracer legacy;
+  int errors = 0;
+
+  legacy.m_check_for_duplicate = (bit == HISTORY_RETURN);
+  for (size_t i = 0; i < seeds.size(); i++) {
+    ContourBounds bounds(BENCH_MIN_CONTOUR);
+    ContourRecorder<ContourPoint> recorder(contour, BENCH_MAX_CONTOUR);
+    int expect = legacy.Count(seeds[i].angle, seeds[i].r, BENCH_MIN_CONTOUR);
+    ContourResult result = TraceContour(pix, seeds[i].angle, seeds[i].r, bounds);
+    int got = ResultOf(result, bounds.m_count);
+    ContourResult full = TraceContour(pix, seeds[i].angle, seeds[i].r, recorder);
+
+    if (got != expect || (expect > 0 && expect <= BENCH_MIN_CONTOUR && recorder.m_count != expect) ||
+        (expect < 0) != (full == CONTOUR_NOT_ON_EDGE || full == CONTOUR_NO_NEXT_POINT)) {
+      if (errors++ < 10) {
+        cout << "ERROR: seed " << seeds[i].angle << "," << seeds[i].r << " legacy " << expect << " template " << got
+             << " recorded " << recorder.m_count << "\n";
+      }
+    }
+  }
+  return errors;
+}
+
+// Run f over all seeds until BENCH_MIN_MILLIS have passed, return ns per trace
+template <typename F>
+static double Measure(const char *name, const vector<Seed> &seeds, F f) {
+  wxStopWatch sw;
+  long traces = 0;
+  long checksum = 0;
+
+  do {
+    for (size_t i = 0; i < seeds.size(); i++) {
+      checksum += f(seeds[i]);
+    }
+    traces += seeds.size();
+  } while (sw.Time() < BENCH_MIN_MILLIS);
+
+  double ns = sw.Time() * 1e6 / traces;
+  printf("%-22s %8.1f ns/trace (checksum %ld)\n", name, ns, checksum / (traces / seeds.size()));
+  return ns;
+}
+
+struct LegacyCount {
+  LegacyTracer *legacy;
+  int operator()(const Seed &s) const { return legacy->Count(s.angle, s.r, BENCH_MIN_CONTOUR); }
+};
+
+template <UINT8 bit, typename Output>
+struct TemplateTrace {
+  int operator()(const Seed &s) const {
+    HistoryPixel<HistoryLine, bit> pix(history);
+    Output out = MakeOutput();
+    ContourResult result = TraceContour(pix, s.angle, s.r, out);
+    return ResultOf(result, out.m_count);
+  }
+  static Output MakeOutput();
+};
+
+template <>
+ContourCount TemplateTrace<HISTORY_UNCLAIMED, ContourCount>::MakeOutput() {
+  return ContourCount(BENCH_MIN_CONTOUR);
+}
+
+template <>
+ContourBounds TemplateTrace<HISTORY_UNCLAIMED, ContourBounds>::MakeOutput() {
+  return ContourBounds(BENCH_MIN_CONTOUR);
+}
+
+template <>
+ContourRecorder<ContourPoint> TemplateTrace<HISTORY_UNCLAIMED, ContourRecorder<ContourPoint> >::MakeOutput() {
+  return ContourRecorder<ContourPoint>(contour, BENCH_MAX_CONTOUR);
+}
+
+int main(int argc, char *argv[]) {
+  vector<Seed> seeds;
+  vector<Seed> duplicate_seeds;
+  LegacyTracer legacy;
+  int errors = 0;
+
+  if (argc > 1) {
+    if (!ReadHistory(argv[1])) {
+      cout << "ERROR: cannot read " << LINES_PER_ROTATION << " history lines from " << argv[1] << "\n";
+      return 1;
+    }
+  } else {
+    MakeSyntheticHistory();
+  }
+
+  FindSeeds<HISTORY_UNCLAIMED>(seeds);
+  FindSeeds<HISTORY_RETURN>(duplicate_seeds);
+  cout << "INFO: " << seeds.size() << " blob edges, " << duplicate_seeds.size() << " including claimed blobs\n";
+  if (seeds.empty()) {
+    cout << "ERROR: no blobs in the history\n";
+    return 1;
+  }
+
+  errors += CheckAgainstLegacy<HISTORY_UNCLAIMED>(seeds);
+  errors += CheckAgainstLegacy<HISTORY_RETURN>(duplicate_seeds);
+  if (errors) {
+    cout << "ERROR: " << errors << " contours differ from the legacy tracer\n";
+    return 1;
+  }
+
+  legacy.m_check_for_duplicate = false;
+  LegacyCount legacy_count = {&legacy};
+  double before = Measure("legacy (run-time bit)", seeds, legacy_count);
+  double count = Measure("count", seeds, TemplateTrace<HISTORY_UNCLAIMED, ContourCount>());
+  Measure("bounding box", seeds, TemplateTrace<HISTORY_UNCLAIMED, ContourBounds>());
+  Measure("full contour", seeds, TemplateTrace<HISTORY_UNCLAIMED, ContourRecorder<ContourPoint> >());
+  printf("count speedup          %8.2fx\n", before / count);
+
+  cout << "INFO: TEST PASSED\n";
+  return 0;
+}
+
+PLUGIN_END_NAMESPACE
+
+int main(int argc, char *argv[]) { return br24::main(argc, argv); }
@@ -161,30 +161,60 @@ void CheckOpenGLError(const wxString& after) {
   }
 }
 
-PolarToCartesianLookupTable* lookupTable = 0;
+#if defined(__GNUC__)
+#define LOAD_LOOKUP_TABLE() __atomic_load_n(&lookupTable, __ATOMIC_ACQUIRE)
+#define STORE_LOOKUP_TABLE(v) __atomic_store_n(&lookupTable, v, __ATOMIC_RELEASE)
+#else
+// MSVC gives volatile accesses acquire/release semantics
+#define LOAD_LOOKUP_TABLE() (lookupTable)
+#define STORE_LOOKUP_TABLE(v) (lookupTable = (v))
+#endif
+
+static PolarToCartesianLookupTable* volatile lookupTable = 0;
+static wxCriticalSection lookupTableLock;  // held while the table is built
+static wxLongLong lookupTableBuildMillis = -1;
 
 PolarToCartesianLookupTable* GetPolarToCartesianLookupTable() {
-  if (!lookupTable) {
-    lookupTable = (PolarToCartesianLookupTable*)malloc(sizeof(PolarToCartesianLookupTable));
+  PolarToCartesianLookupTable* table = LOAD_LOOKUP_TABLE();
+  if (table) {
+    return table;
+  }
 
-    if (!lookupTable) {
-      wxLogError(wxT("BR24radar_pi: Out Of Memory, fatal!"));
-      wxAbort();
-    }
+  // Not built yet, or PolarLookupThread is building it right now, in which case we wait for it
+  wxCriticalSectionLocker lock(lookupTableLock);
+  if (lookupTable) {
+    return lookupTable;
+  }
 
-    // initialise polar_to_cart_y[arc + 1][radius] arrays
-    for (int arc = 0; arc < LINES_PER_ROTATION + 1; arc++) {
-      GLfloat sine = sinf((GLfloat)arc * PI * 2 / LINES_PER_ROTATION);
-      GLfloat cosine = cosf((GLfloat)arc * PI * 2 / LINES_PER_ROTATION);
-      for (int radius = 0; radius < RETURNS_PER_LINE + 1; radius++) {
-        lookupTable->x[arc][radius] = (GLfloat)radius * cosine;
-        lookupTable->y[arc][radius] = (GLfloat)radius * sine;
-        lookupTable->intx[arc][radius] = (int)lookupTable->x[arc][radius];
-        lookupTable->inty[arc][radius] = (int)lookupTable->y[arc][radius];
-      }
+  wxLongLong start = wxGetUTCTimeMillis();
+  table = (PolarToCartesianLookupTable*)malloc(sizeof(PolarToCartesianLookupTable));
+
+  if (!table) {
+    wxLogError(wxT("BR24radar_pi: Out Of Memory, fatal!"));
+    wxAbort();
+  }
+
+  // initialise polar_to_cart_y[arc + 1][radius] arrays
+  for (int arc = 0; arc < LINES_PER_ROTATION + 1; arc++) {
+    GLfloat sine = sinf((GLfloat)arc * PI * 2 / LINES_PER_ROTATION);
+    GLfloat cosine = cosf((GLfloat)arc * PI * 2 / LINES_PER_ROTATION);
+    table->cosine[arc] = cosine;
+    table->sine[arc] = sine;
+    for (int radius = 0; radius < RETURNS_PER_LINE + 1; radius++) {
+      table->intx[arc][radius] = (int16_t)table->GetX(arc, radius);
+      table->inty[arc][radius] = (int16_t)table->GetY(arc, radius);
     }
   }
-  return lookupTable;
+  lookupTableBuildMillis = wxGetUTCTimeMillis() - start;
+  STORE_LOOKUP_TABLE(table);
+  return table;
+}
+
+wxLongLong GetPolarToCartesianLookupBuildMillis() {
+  if (!LOAD_LOOKUP_TABLE()) {
+    return -1;
+  }
+  return lookupTableBuildMillis;
 }
 
 typedef struct {
@@ -41,14 +41,31 @@ extern void DrawOutlineArc(double r1, double r2, double a1, double a2, bool stip
 extern void DrawFilledArc(double r1, double r2, double a1, double a2);
 extern void CheckOpenGLError(const wxString& after);
 
+// The floating point coordinates are computed from the sine and cosine, which gives exactly
+// the same result as storing them. The integer coordinates fit in 16 bits.
 struct PolarToCartesianLookupTable {
-  GLfloat x[LINES_PER_ROTATION + 1][RETURNS_PER_LINE + 1];
-  GLfloat y[LINES_PER_ROTATION + 1][RETURNS_PER_LINE + 1];
-  int intx[LINES_PER_ROTATION + 1][RETURNS_PER_LINE + 1];
-  int inty[LINES_PER_ROTATION + 1][RETURNS_PER_LINE + 1];
+  GLfloat cosine[LINES_PER_ROTATION + 1];
+  GLfloat sine[LINES_PER_ROTATION + 1];
+  int16_t intx[LINES_PER_ROTATION + 1][RETURNS_PER_LINE + 1];
+  int16_t inty[LINES_PER_ROTATION + 1][RETURNS_PER_LINE + 1];
+
+  GLfloat GetX(int arc, int radius) { return (GLfloat)radius * cosine[arc]; }
+  GLfloat GetY(int arc, int radius) { return (GLfloat)radius * sine[arc]; }
 };
 
 extern PolarToCartesianLookupTable* GetPolarToCartesianLookupTable();
+extern wxLongLong GetPolarToCartesianLookupBuildMillis();  // -1 while not built yet
+
+// Builds the lookup table at startup, so the first spoke doesn't have to wait for it
+class PolarLookupThread : public wxThread {
+ public:
+  PolarLookupThread() : wxThread(wxTHREAD_JOINABLE) { Create(1024 * 1024); }  // Stack size, be liberal
+
+  void* Entry(void) {
+    GetPolarToCartesianLookupTable();
+    return 0;
+  }
+};
 
 extern void DrawRoundRect(float x, float y, float width, float height, float radius = 0.0);
 
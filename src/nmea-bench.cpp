@@ -0,0 +1,209 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+/*
+ * Micro-benchmark of the ARPA NMEA sentences.
+ *
+ * Formats TTM sentences for a set of targets with NmeaBuilder, and the way
+ * ArpaTarget::PassARPAtoOCPN did before: every field printed into a string on its own,
+ * then the sentence with snprintf and the checksum in a separate loop. The numbers in
+ * the two must agree, and the checksums of NmeaBuilder must be right.
+ */
+
+#include <wx/stopwatch.h>
+#include <vector>
+
+#include "ArpaNmea.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define BENCH_MIN_MILLIS (500)  // run each variant at least this long
+#define BENCH_TARGETS (500)
+
+static int Legacy(const ArpaReport &r, char *out, size_t size) {
+  char id[16], speed[16], course[16], distance[32], bearing[32], name[16], cpa[16], tcpa[16];
+  char sentence[200];
+  char checksum = 0;
+
+  snprintf(id, sizeof(id), "%4i", r.target_id);
+  snprintf(speed, sizeof(speed), "%4.2f", r.speed_kn);
+  snprintf(course, sizeof(course), "%3.1f", r.course);
+  snprintf(name, sizeof(name), r.automatic ? "ARPA%4i" : "MARPA%4i", r.target_id);
+  snprintf(distance, sizeof(distance), "%f", r.distance_nm);
+  snprintf(bearing, sizeof(bearing), "%f", r.bearing);
+  snprintf(cpa, sizeof(cpa), "%.2f", r.cpa_nm);
+  snprintf(tcpa, sizeof(tcpa), "%.1f", r.tcpa_min);
+  snprintf(sentence, sizeof(sentence), "RATTM,%2s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%c, ", id, distance, bearing, "", speed, course,
+           "T", cpa, tcpa, "N", name, r.status);
+  for (char *p = sentence; *p; p++) {
+    checksum ^= *p;
+  }
+  return snprintf(out, size, "$%s*%02X\r\n", sentence, (unsigned)(UINT8)checksum);
+}
+
+// Split a sentence in its fields, and check the checksum
+static bool Parse(const char *s, vector<string> &fields) {
+  unsigned checksum = 0;
+  string field;
+
+  fields.clear();
+  if (*s++ != '$') {
+    return false;
+  }
+  for (; *s && *s != '*'; s++) {
+    checksum ^= (UINT8)*s;
+    if (*s == ',') {
+      fields.push_back(field);
+      field.clear();
+    } else {
+      field += *s;
+    }
+  }
+  fields.push_back(field);
+  unsigned given = 0;
+  return *s == '*' && sscanf(s + 1, "%2X", &given) == 1 && given == checksum;
+}
+
+static int Check(const vector<ArpaReport> &reports) {
+  static const int numbers[] = {1, 2, 3, 5, 6, 8, 9};  // fields with a number
+  NmeaBuilder b;
+  char legacy[NMEA_MAX_SENTENCE * 2];
+  vector<string> got;
+  vector<string> expect;
+  int errors = 0;
+
+  for (size_t i = 0; i < reports.size(); i++) {
+    const char *s = FormatTTM(&b, reports[i]);
+    Legacy(reports[i], legacy, sizeof(legacy));
+    if (!Parse(s, got) || !Parse(legacy, expect) || got.size() != 16) {
+      if (errors++ < 10) {
+        cout << "ERROR: bad sentence " << s;
+      }
+      continue;
+    }
+    for (size_t n = 0; n < ARRAY_SIZE(numbers); n++) {
+      int f = numbers[n];
+      double rounding = (f == 2) ? 0.0005 : (f == 5 || f == 8) ? 0.005 : 0.05;
+      if (fabs(atof(got[f].c_str()) - atof(expect[f].c_str())) > rounding + 1e-9) {
+        if (errors++ < 10) {
+          cout << "ERROR: field " << f << " is " << got[f] << " and was " << expect[f] << "\n";
+        }
+      }
+    }
+    if (got[11] != expect[11] || got[12] != expect[12]) {
+      if (errors++ < 10) {
+        cout << "ERROR: name or status " << got[11] << " " << got[12] << " was " << expect[11] << " " << expect[12] << "\n";
+      }
+    }
+
+    s = FormatTLL(&b, reports[i]);
+    double lat = 0.;
+    if (!Parse(s, got) || got.size() != 10) {
+      if (errors++ < 10) {
+        cout << "ERROR: bad sentence " << s;
+      }
+      continue;
+    }
+    lat = atoi(got[2].substr(0, 2).c_str()) + atof(got[2].substr(2).c_str()) / 60.;
+    if (got[3] == "S") {
+      lat = -lat;
+    }
+    if (fabs(lat - reports[i].lat) > 1e-6) {
+      if (errors++ < 10) {
+        cout << "ERROR: TLL latitude " << got[2] << got[3] << " for " << reports[i].lat << "\n";
+      }
+    }
+  }
+  return errors;
+}
+
+int main(int argc, char *argv[]) {
+  vector<ArpaReport> reports;
+  NmeaBuilder b;
+  char legacy[NMEA_MAX_SENTENCE * 2];
+
+  srand(1);
+  for (int i = 0; i < BENCH_TARGETS; i++) {
+    ArpaReport r;
+    r.target_id = 1 + rand() % 9999;
+    r.automatic = (i % 4) != 0;
+    r.status = "QTL"[i % 3];
+    r.distance_nm = (rand() % 240000) / 10000.;
+    r.bearing = (rand() % 36000) / 100.;
+    r.speed_kn = (rand() % 4000) / 100.;
+    r.course = (rand() % 3600) / 10.;
+    r.has_cpa = true;
+    r.cpa_nm = (rand() % 1000) / 100.;
+    r.tcpa_min = (rand() % 1200) / 10. - 60.;
+    r.lat = (rand() % 1800000) / 10000. - 90.;
+    r.lon = (rand() % 3600000) / 10000. - 180.;
+    r.time_of_day_ms = rand() % 86400000;
+    reports.push_back(r);
+  }
+
+  int errors = Check(reports);
+  if (errors) {
+    cout << "ERROR: " << errors << " sentences differ\n";
+    return 1;
+  }
+
+  wxStopWatch sw;
+  long n = 0;
+  size_t length = 0;
+  do {
+    for (size_t i = 0; i < reports.size(); i++) {
+      length += Legacy(reports[i], legacy, sizeof(legacy));
+    }
+    n += reports.size();
+  } while (sw.Time() < BENCH_MIN_MILLIS);
+  double legacy_ns = sw.Time() * 1e6 / n;
+
+  sw.Start();
+  n = 0;
+  do {
+    for (size_t i = 0; i < reports.size(); i++) {
+      FormatTTM(&b, reports[i]);
+      length += b.Length();
+    }
+    n += reports.size();
+  } while (sw.Time() < BENCH_MIN_MILLIS);
+  double builder_ns = sw.Time() * 1e6 / n;
+
+  printf("TTM with printf  %8.1f ns/sentence\n", legacy_ns);
+  printf("TTM with builder %8.1f ns/sentence (%.2fx, %lu characters)\n", builder_ns, legacy_ns / builder_ns, (unsigned long)length);
+  cout << "INFO: TEST PASSED\n";
+  return 0;
+}
+
+PLUGIN_END_NAMESPACE
+
+int main(int argc, char *argv[]) { return br24::main(argc, argv); }
@@ -0,0 +1,215 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+/*
+ * Micro-benchmark of the ARPA target index.
+ *
+ * Places 100, 500 and 2000 targets at random in the radar image and times, per target,
+ * what a sweep asks of the index: moving the target, checking whether a new blob is
+ * within DISTANCE_BETWEEN_TARGETS of a target and finding the target nearest to a
+ * deletion click. Both queries are also done with a scan of all targets, which is how
+ * RadarArpa did it before, and the answers must agree.
+ */
+
+#include <wx/stopwatch.h>
+#include <vector>
+
+#include "PolarGrid.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define BENCH_MIN_MILLIS (300)  // run each variant at least this long
+#define BENCH_WITHIN (4 + 6)    // DISTANCE_BETWEEN_TARGETS plus half a typical blob
+
+struct Point {
+  int angle;
+  int r;
+  float x;
+  float y;
+};
+
+static Point MakePoint(int angle, int r) {
+  double a = angle * 2. * PI / LINES_PER_ROTATION;
+  Point p = {angle, r, (float)(r * sin(a)), (float)(r * cos(a))};
+  return p;
+}
+
+static float Distance2(const Point &p, const Point &q) {
+  float dx = p.x - q.x;
+  float dy = p.y - q.y;
+  return dx * dx + dy * dy;
+}
+
+static int ScanNearest(const vector<Point> &targets, const Point &p, int skip) {
+  float best_d2 = 0;
+  int best = -1;
+
+  for (size_t i = 0; i < targets.size(); i++) {
+    float d2 = Distance2(targets[i], p);
+    if ((int)i != skip && (best < 0 || d2 < best_d2)) {
+      best_d2 = d2;
+      best = (int)i;
+    }
+  }
+  return best;
+}
+
+static int ScanWithin(const vector<Point> &targets, const Point &p, int dist) {
+  for (size_t i = 0; i < targets.size(); i++) {
+    if (Distance2(targets[i], p) <= (float)dist * dist) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+static Point RandomPoint() { return MakePoint(rand() % LINES_PER_ROTATION, 10 + rand() % (RETURNS_PER_LINE - 20)); }
+
+static int Check(PolarGrid &grid, const vector<Point> &targets, const vector<Point> &queries) {
+  int errors = 0;
+
+  for (size_t i = 0; i < queries.size(); i++) {
+    const Point &q = queries[i];
+    int scan = ScanNearest(targets, q, 0);
+    int found = grid.Nearest(q.angle, q.r, 0);
+    if (found < 0 || Distance2(targets[found], q) != Distance2(targets[scan], q)) {
+      if (errors++ < 10) {
+        cout << "ERROR: nearest to " << q.angle << "," << q.r << " is " << scan << " but index says " << found << "\n";
+      }
+    }
+    scan = ScanWithin(targets, q, BENCH_WITHIN);
+    found = grid.FindWithin(q.angle, q.r, BENCH_WITHIN);
+    if ((scan < 0) != (found < 0) || (found >= 0 && Distance2(targets[found], q) > (float)BENCH_WITHIN * BENCH_WITHIN)) {
+      if (errors++ < 10) {
+        cout << "ERROR: within " << BENCH_WITHIN << " of " << q.angle << "," << q.r << " scan " << scan << " index " << found
+             << "\n";
+      }
+    }
+  }
+  return errors;
+}
+
+// Run f over all queries until BENCH_MIN_MILLIS have passed, return ns per query
+template <typename F>
+static double Measure(const vector<Point> &queries, F f) {
+  wxStopWatch sw;
+  long n = 0;
+  long checksum = 0;
+
+  do {
+    for (size_t i = 0; i < queries.size(); i++) {
+      checksum += f(queries[i]);
+    }
+    n += queries.size();
+  } while (sw.Time() < BENCH_MIN_MILLIS);
+  if (checksum == 42) {
+    cout << "";  // keep the loop
+  }
+  return sw.Time() * 1e6 / n;
+}
+
+struct ScanNearestQuery {
+  const vector<Point> *targets;
+  int operator()(const Point &p) const { return ScanNearest(*targets, p, -1); }
+};
+
+struct ScanWithinQuery {
+  const vector<Point> *targets;
+  int operator()(const Point &p) const { return ScanWithin(*targets, p, BENCH_WITHIN); }
+};
+
+struct GridNearestQuery {
+  PolarGrid *grid;
+  int operator()(const Point &p) const { return grid->Nearest(p.angle, p.r); }
+};
+
+struct GridWithinQuery {
+  PolarGrid *grid;
+  int operator()(const Point &p) const { return grid->FindWithin(p.angle, p.r, BENCH_WITHIN); }
+};
+
+// Moves every target by a few spokes and returns, as a refresh does
+struct GridMove {
+  PolarGrid *grid;
+  mutable int key;
+  int operator()(const Point &p) const {
+    int k = key++ % (int)grid->Size();
+    grid->Set(k, p.angle + (k & 3), p.r + (k & 1));
+    return k;
+  }
+};
+
+int main(int argc, char *argv[]) {
+  static const int sizes[] = {100, 500, 2000};
+  int errors = 0;
+
+  srand(1);
+  printf("targets  move ns   within: scan ns  index ns   nearest: scan ns  index ns\n");
+  for (size_t s = 0; s < ARRAY_SIZE(sizes); s++) {
+    vector<Point> targets;
+    vector<Point> queries;
+    PolarGrid grid;
+
+    for (int i = 0; i < sizes[s]; i++) {
+      targets.push_back(RandomPoint());
+      grid.Set(i, targets[i].angle, targets[i].r);
+    }
+    // half of the queries at a target, as when a blob is found again, half anywhere
+    for (int i = 0; i < 1000; i++) {
+      Point p = (i & 1) ? RandomPoint() : targets[rand() % targets.size()];
+      queries.push_back(MakePoint(p.angle + rand() % 5 - 2, p.r + rand() % 5 - 2));
+    }
+    errors += Check(grid, targets, queries);
+
+    ScanNearestQuery scan_nearest = {&targets};
+    ScanWithinQuery scan_within = {&targets};
+    GridNearestQuery grid_nearest = {&grid};
+    GridWithinQuery grid_within = {&grid};
+    GridMove grid_move = {&grid, 0};
+    double sw = Measure(queries, scan_within);
+    double gw = Measure(queries, grid_within);
+    double sn = Measure(queries, scan_nearest);
+    double gn = Measure(queries, grid_nearest);
+    double m = Measure(targets, grid_move);
+    printf("%7d  %7.1f   %15.1f  %8.1f   %16.1f  %8.1f\n", sizes[s], m, sw, gw, sn, gn);
+  }
+  if (errors) {
+    cout << "ERROR: " << errors << " answers of the index differ from a scan\n";
+    return 1;
+  }
+  cout << "INFO: TEST PASSED\n";
+  return 0;
+}
+
+PLUGIN_END_NAMESPACE
+
+int main(int argc, char *argv[]) { return br24::main(argc, argv); }
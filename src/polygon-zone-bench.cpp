@@ -0,0 +1,269 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/*
+ * Micro-benchmark of the polygon guard zones, with 16 and 64 zones.
+ *
+ * Generates random polygons around own ship and a rotation of spokes with random returns,
+ * and times per spoke what ProcessSpoke costs: counting the bogeys with the masks, making the
+ * masks of a spoke again after own ship moved, and looking up whether a blob is in a zone with
+ * ARPA on. The counts and lookups are also done the obvious way, testing each strong return
+ * against each polygon, and the answers must agree.
+ */
+
+#include <wx/stopwatch.h>
+#include <vector>
+
+#include "PolygonZone.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define BENCH_LAT (52.)
+#define BENCH_LON (4.)
+#define BENCH_RANGE_METERS (3000)
+#define BENCH_THRESHOLD (200)  // about one in five returns is strong
+#define BENCH_MIN_MILLIS (300)
+
+struct Polygon {
+  vector<double> x;  // meters east of own ship
+  vector<double> y;  // meters north of own ship
+};
+
+static double Random(double from, double to) { return from + (to - from) * rand() / RAND_MAX; }
+
+// A star shaped polygon, so it can be concave, around a centre dist meters away
+static Polygon RandomPolygon(double dist, double radius) {
+  Polygon p;
+  double a = Random(0., 2. * PI);
+  double cx = dist * sin(a);
+  double cy = dist * cos(a);
+  int corners = 4 + rand() % 9;
+
+  for (int i = 0; i < corners; i++) {
+    double b = (i + Random(0., 0.8)) * 2. * PI / corners;
+    double r = radius * Random(0.4, 1.);
+    p.x.push_back(cx + r * sin(b));
+    p.y.push_back(cy + r * cos(b));
+  }
+  return p;
+}
+
+// The usual even-odd test
+static bool Inside(const Polygon &p, double x, double y) {
+  bool inside = false;
+  size_t n = p.x.size();
+
+  for (size_t i = 0, j = n - 1; i < n; j = i++) {
+    if ((p.y[i] > y) != (p.y[j] > y) && x < (p.x[j] - p.x[i]) * (y - p.y[i]) / (p.y[j] - p.y[i]) + p.x[i]) {
+      inside = !inside;
+    }
+  }
+  return inside;
+}
+
+static void ReturnPosition(int bearing, int r, double *x, double *y) {
+  double a = bearing * 2. * PI / LINES_PER_ROTATION;
+  double d = r * (double)BENCH_RANGE_METERS / RETURNS_PER_LINE;
+  *x = d * sin(a);
+  *y = d * cos(a);
+}
+
+// Count the strong returns of a spoke per polygon by testing each of them
+static void CountByPolygon(const vector<Polygon> &polygons, int bearing, const UINT8 *line, vector<int> *count) {
+  for (int r = 0; r < RETURNS_PER_LINE; r++) {
+    if (line[r] >= BENCH_THRESHOLD) {
+      double x, y;
+      ReturnPosition(bearing, r, &x, &y);
+      for (size_t z = 0; z < polygons.size(); z++) {
+        if (Inside(polygons[z], x, y)) {
+          (*count)[z]++;
+        }
+      }
+    }
+  }
+}
+
+static bool InAnyPolygon(const vector<Polygon> &polygons, int bearing, int r) {
+  double x, y;
+  ReturnPosition(bearing, r, &x, &y);
+  for (size_t z = 0; z < polygons.size(); z++) {
+    if (Inside(polygons[z], x, y)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static int Run(int zones, const vector<UINT8> &image, const vector<uint64_t> &strong) {
+  int errors = 0;
+  vector<Polygon> polygons;
+  PolygonZones pz;
+  double meters_per_lon = 60. * 1852. * cos(deg2rad(BENCH_LAT));
+
+  for (int z = 0; z < zones; z++) {
+    // The first zone is around own ship, so the spokes start inside it
+    Polygon p = z ? RandomPolygon(Random(200., 2800.), Random(50., 400.)) : RandomPolygon(50., 300.);
+    PolygonZone zone;
+    for (size_t i = 0; i < p.x.size(); i++) {
+      PolygonPoint point = {BENCH_LAT + p.y[i] / (60. * 1852.), BENCH_LON + p.x[i] / meters_per_lon};
+      zone.points.push_back(point);
+    }
+    zone.alarm_on = true;
+    zone.arpa_on = true;
+    pz.Add(zone);
+    polygons.push_back(p);
+  }
+
+  // Two rotations, the second completes at the first spoke of the third
+  vector<int> expected(zones);
+  for (int rotation = 0; rotation < 2; rotation++) {
+    for (int b = 0; b < LINES_PER_ROTATION; b++) {
+      pz.ProcessSpoke(b, &strong[b * STRONG_WORDS], BENCH_RANGE_METERS, BENCH_LAT, BENCH_LON);
+    }
+  }
+  pz.ProcessSpoke(0, &strong[0], BENCH_RANGE_METERS, BENCH_LAT, BENCH_LON);
+  for (int b = 0; b < LINES_PER_ROTATION; b++) {
+    CountByPolygon(polygons, b, &image[b * RETURNS_PER_LINE], &expected);
+  }
+  for (int z = 0; z < zones; z++) {
+    if (pz.GetBogeyCount(z) != expected[z]) {
+      if (errors++ < 10) {
+        cout << "ERROR: zone " << z << " has " << pz.GetBogeyCount(z) << " bogeys, polygon test says " << expected[z] << "\n";
+      }
+    }
+  }
+
+  // Blob lookups at random places
+  vector<int> lookups;
+  for (int i = 0; i < 10000; i++) {
+    lookups.push_back(rand() % (LINES_PER_ROTATION * RETURNS_PER_LINE));
+  }
+  for (size_t i = 0; i < lookups.size(); i++) {
+    int b = lookups[i] / RETURNS_PER_LINE;
+    int r = lookups[i] % RETURNS_PER_LINE;
+    if (pz.InArpaZone(b, r) != InAnyPolygon(polygons, b, r)) {
+      if (errors++ < 10) {
+        cout << "ERROR: return " << b << "," << r << " in zone differs from polygon test\n";
+      }
+    }
+  }
+
+  // Counting with the masks
+  wxStopWatch sw;
+  long spokes = 0;
+  do {
+    for (int b = 0; b < LINES_PER_ROTATION; b++) {
+      pz.ProcessSpoke(b, &strong[b * STRONG_WORDS], BENCH_RANGE_METERS, BENCH_LAT, BENCH_LON);
+    }
+    spokes += LINES_PER_ROTATION;
+  } while (sw.Time() < BENCH_MIN_MILLIS);
+  double count_ns = sw.Time() * 1e6 / spokes;
+
+  // Counting by testing each return
+  sw.Start();
+  spokes = 0;
+  do {
+    for (int b = 0; b < LINES_PER_ROTATION; b += 16) {
+      CountByPolygon(polygons, b, &image[b * RETURNS_PER_LINE], &expected);
+    }
+    spokes += LINES_PER_ROTATION / 16;
+  } while (sw.Time() < BENCH_MIN_MILLIS);
+  double polygon_ns = sw.Time() * 1e6 / spokes;
+
+  // Moving one return north each rotation, so every spoke makes its masks again
+  sw.Start();
+  spokes = 0;
+  do {
+    double lat = BENCH_LAT + (spokes / LINES_PER_ROTATION % 2) * 2. * BENCH_RANGE_METERS / RETURNS_PER_LINE / (60. * 1852.);
+    for (int b = 0; b < LINES_PER_ROTATION; b++) {
+      pz.ProcessSpoke(b, &strong[b * STRONG_WORDS], BENCH_RANGE_METERS, lat, BENCH_LON);
+    }
+    spokes += LINES_PER_ROTATION;
+  } while (sw.Time() < BENCH_MIN_MILLIS);
+  double raster_ns = sw.Time() * 1e6 / spokes;
+
+  sw.Start();
+  long n = 0;
+  long found = 0;
+  do {
+    for (size_t i = 0; i < lookups.size(); i++) {
+      found += pz.InArpaZone(lookups[i] / RETURNS_PER_LINE, lookups[i] % RETURNS_PER_LINE);
+    }
+    n += lookups.size();
+  } while (sw.Time() < BENCH_MIN_MILLIS);
+  double mask_lookup_ns = sw.Time() * 1e6 / n;
+
+  sw.Start();
+  n = 0;
+  do {
+    for (size_t i = 0; i < lookups.size(); i++) {
+      found += InAnyPolygon(polygons, lookups[i] / RETURNS_PER_LINE, lookups[i] % RETURNS_PER_LINE);
+    }
+    n += lookups.size();
+  } while (sw.Time() < BENCH_MIN_MILLIS);
+  double polygon_lookup_ns = sw.Time() * 1e6 / n;
+
+  printf("%5d  %13.1f  %11.1f  %12.1f   %13.1f  %11.1f%s\n", zones, count_ns, polygon_ns, raster_ns, mask_lookup_ns,
+         polygon_lookup_ns, found == 42 ? " " : "");
+  return errors;
+}
+
+int main() {
+  static const int zones[] = {16, 64};
+  const StrongKernel strong_kernel = GetSpokeKernels()->strong;
+  vector<UINT8> image(LINES_PER_ROTATION * RETURNS_PER_LINE);
+  vector<uint64_t> strong(LINES_PER_ROTATION * STRONG_WORDS);
+  int errors = 0;
+
+  srand(1);
+  for (size_t i = 0; i < image.size(); i++) {
+    image[i] = rand() & 255;
+  }
+  for (int b = 0; b < LINES_PER_ROTATION; b++) {
+    strong_kernel(&image[b * RETURNS_PER_LINE], RETURNS_PER_LINE, BENCH_THRESHOLD, &strong[b * STRONG_WORDS]);
+  }
+
+  printf("                 ns per spoke                        ns per lookup\n");
+  printf("zones  count: masks  per return  moved: masks   ARPA: masks  per return\n");
+  for (size_t i = 0; i < ARRAY_SIZE(zones); i++) {
+    errors += Run(zones[i], image, strong);
+  }
+  if (errors) {
+    cout << "ERROR: " << errors << " answers of the masks differ from testing the polygons\n";
+    return 1;
+  }
+  cout << "INFO: TEST PASSED\n";
+  return 0;
+}
+
+PLUGIN_END_NAMESPACE
+
+int main() { return br24::main(); }
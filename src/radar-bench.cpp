@@ -0,0 +1,413 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Navico BR24 Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+
+/*
+ * radar-bench: run the spoke processing pipeline of the plugin outside OpenCPN.
+ *
+ * Feeds spokes, either synthetic or read from a network capture, through
+ * RadarInfo::ProcessRadarSpoke with guard zones, target trails and a RadarDraw
+ * implementation active, and reports the throughput, the time spent per stage
+ * and the peak memory use. Nothing is drawn on screen; only the per spoke
+ * preparation work that the receive thread does is measured.
+ */
+
+#include <ctype.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <vector>
+
+#include "GuardZone.h"
+#ifdef BR24_HAVE_ZLIB
+#include "PcapReader.h"
+#endif
+#include "RadarDraw.h"
+#include "RadarInfo.h"
+#include "br24Receive.h"
+#include "br24radar_pi.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define BENCH_RANGE_METERS (1852)
+#define BENCH_ROTATION_MILLIS (2500)  // 24 RPM
+#define BENCH_SPEED_KNOTS (10.)
+
+static const int DATA_PORT[2] = {6678, 6657};  // Same as LISTEN_DATA in br24Receive.cpp
+// The --draw names, for RadarDraw::make_Draw methods -1 (none) .. 3
+static const char *DRAW_NAME[] = {"none", "vertex", "shader", "buffer", "palette"};
+static const char *STAGE_NAME[SPOKE_STAGES] = {"history", "guard_zone", "true_trails", "relative_trails", "draw"};
+
+int64_t GetStageClock() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+struct BenchSpoke {
+  SpokeBearing angle;
+  SpokeBearing bearing;
+  int range_meters;
+  UINT8 data[RETURNS_PER_LINE];
+};
+
+class RadarBench {
+ public:
+  RadarBench() {
+    m_spokes = LINES_PER_ROTATION * 100;
+    m_radar = 0;
+    m_draw_method = 0;
+    m_motion = TARGET_MOTION_TRUE;
+    m_guard = true;
+    m_json = false;
+    m_capture = 0;
+    m_history = 0;
+  }
+
+  bool ParseArguments(int argc, char *argv[]);
+  bool LoadSpokes();
+  int Run();
+
+ private:
+  int m_spokes;
+  int m_radar;
+  int m_draw_method;  // -1 = none, else see RadarDraw::make_Draw
+  int m_motion;
+  bool m_guard;
+  bool m_json;
+  const char *m_capture;
+  const char *m_history;  // file to write the history lines to, for contour-bench
+
+  std::vector<BenchSpoke> m_input;
+
+  void MakeSyntheticRotation();
+#ifdef BR24_HAVE_ZLIB
+  bool ReadCapture();
+#endif
+  void Report(RadarInfo *ri, int spokes, int64_t elapsed_ns);
+  bool WriteHistory(RadarInfo *ri);
+};
+
+// Reading captures needs zlib, like br24Receive::ReplayCapture
+#ifdef BR24_HAVE_ZLIB
+#define CAPTURE_USAGE " [--capture FILE]"
+#else
+#define CAPTURE_USAGE ""
+#endif
+
+static void Usage() {
+  fprintf(stderr,
+          "Usage: radar-bench [--spokes N]" CAPTURE_USAGE " [--radar 0|1] [--draw vertex|shader|buffer|palette|none]\n"
+          "                   [--motion off|relative|true] [--no-guard] [--json]\n"
+          "                   [--history FILE]\n");
+}
+
+bool RadarBench::ParseArguments(int argc, char *argv[]) {
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = (i + 1 < argc) ? argv[i + 1] : 0;
+
+    if (!strcmp(arg, "--json")) {
+      m_json = true;
+    } else if (!strcmp(arg, "--no-guard")) {
+      m_guard = false;
+    } else if (!value) {
+      Usage();
+      return false;
+    } else if (!strcmp(arg, "--spokes")) {
+      m_spokes = atoi(value);
+      i++;
+#ifdef BR24_HAVE_ZLIB
+    } else if (!strcmp(arg, "--capture")) {
+      m_capture = value;
+      i++;
+#endif
+    } else if (!strcmp(arg, "--history")) {
+      m_history = value;
+      i++;
+    } else if (!strcmp(arg, "--radar")) {
+      m_radar = atoi(value) ? 1 : 0;
+      i++;
+    } else if (!strcmp(arg, "--draw")) {
+      m_draw_method = -2;
+      for (int m = -1; m < (int)ARRAY_SIZE(DRAW_NAME) - 1; m++) {
+        if (!strcmp(value, DRAW_NAME[m + 1]) || (m >= 0 && atoi(value) == m && isdigit(value[0]))) {
+          m_draw_method = m;
+        }
+      }
+      if (m_draw_method == -2) {
+        Usage();
+        return false;
+      }
+      i++;
+    } else if (!strcmp(arg, "--motion")) {
+      m_motion = !strcmp(value, "off") ? TARGET_MOTION_OFF : !strcmp(value, "relative") ? TARGET_MOTION_RELATIVE : TARGET_MOTION_TRUE;
+      i++;
+    } else {
+      Usage();
+      return false;
+    }
+  }
+  if (m_spokes <= 0) {
+    Usage();
+    return false;
+  }
+  return true;
+}
+
+// A rotation with some land at the edge, a few boats and sea clutter near the center.
+void RadarBench::MakeSyntheticRotation() {
+  unsigned int seed = 1;
+
+  m_input.resize(LINES_PER_ROTATION);
+  for (int angle = 0; angle < LINES_PER_ROTATION; angle++) {
+    BenchSpoke &spoke = m_input[angle];
+
+    spoke.angle = angle;
+    spoke.bearing = angle;
+    spoke.range_meters = BENCH_RANGE_METERS;
+    for (int r = 0; r < RETURNS_PER_LINE; r++) {
+      seed = seed * 1103515245 + 12345;
+      int noise = (seed >> 16) & 0xff;
+      UINT8 v = 0;
+
+      if (r < 60 && noise < 120 - 2 * r) {
+        v = 60 + noise / 2;
+      }
+      if (angle >= 300 && angle < 900 && r >= 400 + (angle % 50)) {
+        v = 200 + (noise & 0x3f);
+      }
+      if ((angle % 256) < 8 && ((r >= 180 && r < 186) || (r >= 300 && r < 306))) {
+        v = 150 + (noise & 0x3f);
+      }
+      spoke.data[r] = v;
+    }
+  }
+}
+
+#ifdef BR24_HAVE_ZLIB
+// Decode the data frames for our radar in the capture file.
+bool RadarBench::ReadCapture() {
+  PcapReader reader;
+  PcapPacket packet;
+
+  if (!reader.Open(m_capture)) {
+    fprintf(stderr, "radar-bench: cannot read capture file %s\n", m_capture);
+    return false;
+  }
+  while (reader.NextUDP(&packet)) {
+    if (packet.dst_port != DATA_PORT[m_radar]) {
+      continue;
+    }
+    int scanlines = br24Receive::GetSpokeCount(packet.len);
+
+    for (int scanline = 0; scanline < scanlines; scanline++) {
+      SpokeHeader header;
+      BenchSpoke spoke;
+      const UINT8 *data = br24Receive::DecodeSpoke(packet.data, scanline, &header);
+
+      if (header.header_len != 0x18 || header.range_meters == 0) {
+        continue;
+      }
+      spoke.angle = MOD_ROTATION2048(header.angle_raw / 2);
+      spoke.bearing = spoke.angle;
+      spoke.range_meters = header.range_meters;
+      memcpy(spoke.data, data, RETURNS_PER_LINE);
+      m_input.push_back(spoke);
+    }
+  }
+  if (m_input.empty()) {
+    fprintf(stderr, "radar-bench: no spokes for radar %d in capture file %s\n", m_radar, m_capture);
+    return false;
+  }
+  return true;
+}
+#endif
+
+bool RadarBench::LoadSpokes() {
+#ifdef BR24_HAVE_ZLIB
+  if (m_capture) {
+    return ReadCapture();
+  }
+#endif
+  MakeSyntheticRotation();
+  return true;
+}
+
+int RadarBench::Run() {
+  br24radar_pi *pi = new br24radar_pi(0);
+
+  pi->m_settings.verbose = 0;
+  pi->m_settings.main_bang_size = 0;
+  pi->m_settings.show_extreme_range = false;
+  pi->m_settings.trails_on_overlay = false;
+  pi->m_settings.overlay_transparency = DEFAULT_OVERLAY_TRANSPARENCY;
+  pi->m_settings.threshold_red = 200;
+  pi->m_settings.threshold_green = 100;
+  pi->m_settings.threshold_blue = 50;
+  pi->m_settings.threshold_multi_sweep = 20;
+  pi->m_settings.max_age = 6;
+  pi->m_settings.strong_colour = *wxRED;
+  pi->m_settings.intermediate_colour = *wxGREEN;
+  pi->m_settings.weak_colour = *wxBLUE;
+  pi->m_settings.trail_start_colour = wxColour(255, 255, 255, 200);
+  pi->m_settings.trail_end_colour = wxColour(63, 63, 63, 10);
+
+  // Fixed heading, and a position that moves north so true trails have to be shifted
+  double lat = 52.;
+  double lon = 4.;
+  pi->m_heading_source = HEADING_FIX_HDT;
+  pi->m_hdt = 0.;
+  pi->m_bpos_set = true;
+  pi->m_radar_lat = lat;
+  pi->m_radar_lon = lon;
+
+  RadarInfo *ri = new RadarInfo(pi, m_radar);
+  ri->m_name = m_radar ? wxT("Radar B") : wxT("Radar A");
+  ri->m_orientation.Update(ORIENTATION_NORTH_UP);
+  ri->m_trails_motion.Update(m_motion);
+  ri->m_target_trails.Update(TRAIL_1MIN);
+  ri->ComputeColourMap();
+  ri->ComputeTargetTrails();
+
+  for (size_t z = 0; z < GUARD_ZONES; z++) {
+    GuardZone *gz = ri->m_guard_zone[z];
+    gz->m_type = GZ_CIRCLE;
+    gz->m_inner_range = z * BENCH_RANGE_METERS / 2;
+    gz->m_outer_range = (z + 1) * BENCH_RANGE_METERS / 2;
+    gz->m_alarm_on = m_guard;
+  }
+
+  if (m_draw_method >= 0) {
+    ri->m_draw_panel.draw = RadarDraw::make_Draw(ri, m_draw_method);
+    ri->m_draw_panel.drawing_method = m_draw_method;
+  }
+
+  size_t n = m_input.size();
+  double lat_per_rotation = BENCH_SPEED_KNOTS / 60. / 3600. * BENCH_ROTATION_MILLIS / MILLISECONDS_PER_SECOND;
+  wxLongLong boot = wxGetUTCTimeMillis();
+  UINT8 data[RETURNS_PER_LINE];
+  int64_t start = 0;
+
+  // The first rotation resets the spokes for the new range; don't count it.
+  int warmup = MIN(LINES_PER_ROTATION, (int)n);
+  for (int i = 0; i < warmup + m_spokes; i++) {
+    const BenchSpoke &spoke = m_input[i % n];
+
+    if (i == warmup) {
+      CLEAR_STRUCT(ri->m_stage_ns);
+      start = GetStageClock();
+    }
+    if (spoke.angle == 0) {
+      lat += lat_per_rotation;
+      wxCriticalSectionLocker lock(pi->m_exclusive);
+      pi->m_radar_lat = lat;
+    }
+    memcpy(data, spoke.data, sizeof(data));  // ProcessRadarSpoke modifies the data
+    wxLongLong now = boot + (wxLongLong)((double)i * BENCH_ROTATION_MILLIS / LINES_PER_ROTATION);
+
+    wxCriticalSectionLocker lock(ri->m_exclusive);
+    ri->ProcessRadarSpoke(spoke.angle, spoke.bearing, data, RETURNS_PER_LINE, spoke.range_meters, now, lat, lon);
+  }
+  Report(ri, m_spokes, GetStageClock() - start);
+  if (m_history && !WriteHistory(ri)) {
+    return 1;
+  }
+  return 0;
+}
+
+// The history bits of the last rotation, one line after the other.
+bool RadarBench::WriteHistory(RadarInfo *ri) {
+  FILE *f = fopen(m_history, "wb");
+  size_t n = 0;
+
+  if (!f) {
+    fprintf(stderr, "radar-bench: cannot write history file %s\n", m_history);
+    return false;
+  }
+  for (int angle = 0; angle < LINES_PER_ROTATION; angle++) {
+    n += fwrite(ri->m_history[angle].line, 1, RETURNS_PER_LINE, f);
+  }
+  fclose(f);
+  return n == LINES_PER_ROTATION * RETURNS_PER_LINE;
+}
+
+void RadarBench::Report(RadarInfo *ri, int spokes, int64_t elapsed_ns) {
+  struct rusage usage;
+  long peak_rss_kb;
+
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  peak_rss_kb = usage.ru_maxrss / 1024;  // in bytes on macOS
+#else
+  peak_rss_kb = usage.ru_maxrss;
+#endif
+
+  double seconds = (double)elapsed_ns / 1e9;
+  double spokes_per_second = seconds > 0. ? spokes / seconds : 0.;
+
+  if (m_json) {
+    printf("{\"spokes\": %d, \"seconds\": %.3f, \"spokes_per_second\": %.0f, \"stage_ns_per_spoke\": {", spokes, seconds,
+           spokes_per_second);
+    for (int s = 0; s < SPOKE_STAGES; s++) {
+      printf("%s\"%s\": %.1f", s ? ", " : "", STAGE_NAME[s], (double)ri->m_stage_ns[s] / spokes);
+    }
+    printf("}, \"peak_rss_kb\": %ld}\n", peak_rss_kb);
+    return;
+  }
+
+  printf("spokes            %d (%s)\n", spokes, m_capture ? m_capture : "synthetic");
+  printf("elapsed           %.3f s\n", seconds);
+  printf("spokes/s          %.0f (%.1f rotations/s)\n", spokes_per_second, spokes_per_second / LINES_PER_ROTATION);
+  for (int s = 0; s < SPOKE_STAGES; s++) {
+    printf("%-17s %.1f ns/spoke\n", STAGE_NAME[s], (double)ri->m_stage_ns[s] / spokes);
+  }
+  printf("peak RSS          %ld kB\n", peak_rss_kb);
+}
+
+int main(int argc, char *argv[]) {
+  wxInitializer initializer;
+  RadarBench bench;
+
+  if (!initializer.IsOk()) {
+    fprintf(stderr, "radar-bench: cannot initialize wxWidgets\n");
+    return 1;
+  }
+  wxInitAllImageHandlers();
+  if (!bench.ParseArguments(argc, argv) || !bench.LoadSpokes()) {
+    return 1;
+  }
+  return bench.Run();
+}
+
+PLUGIN_END_NAMESPACE
+
+int main(int argc, char *argv[]) { return br24::main(argc, argv); }
@@ -51,6 +51,10 @@ typedef __GLXextFuncPtr FunctionPointer;
 #include "shaderutil.inc"
 #undef SHADER_FUNCTION_LIST
 
+#define BUFFER_FUNCTION_LIST(proc, name) proc name;
+#include "bufferutil.inc"
+#undef BUFFER_FUNCTION_LIST
+
 GLboolean ShadersSupported(void) {
   GLboolean ok = 1;
 
@@ -70,6 +74,47 @@ GLboolean ShadersSupported(void) {
   return ok;
 }
 
+// The entry points are looked up once; a partial lookup leaves some of them null, so the
+// callers must test the result and not one of the pointers.
+GLboolean VertexBuffersSupported(void) {
+  static int supported = -1;
+  GLboolean ok = 1;
+
+  if (supported >= 0) {
+    return (GLboolean)supported;
+  }
+
+#define BUFFER_FUNCTION_LIST(proc, name)    \
+  {                                         \
+    union {                                 \
+      proc f;                               \
+      FunctionPointer p;                    \
+    } u;                                    \
+    u.p = SET_FUNCTION_POINTER("gl" #name); \
+    if (!u.p) ok = 0;                       \
+    name = u.f;                             \
+  }
+#include "bufferutil.inc"
+#undef BUFFER_FUNCTION_LIST
+
+  supported = ok;
+  return ok;
+}
+
+GLboolean PixelBuffersSupported(void) {
+  if (!VertexBuffersSupported()) {
+    return 0;
+  }
+
+  const char *version = (const char *)glGetString(GL_VERSION);
+  int major = 0, minor = 0;
+  if (version && sscanf(version, "%d.%d", &major, &minor) == 2 && (major > 2 || (major == 2 && minor >= 1))) {
+    return 1;
+  }
+  const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+  return extensions && strstr(extensions, "GL_ARB_pixel_buffer_object") != 0;
+}
+
 bool CompileShaderText(GLuint *shader, GLenum shaderType, const char *text) {
   GLint stat;
 
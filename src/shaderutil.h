@@ -49,6 +49,18 @@ extern void SetUniformValues(GLuint program, struct uniform_info uniforms[]);
 #include "shaderutil.inc"
 #undef SHADER_FUNCTION_LIST
 
+extern GLboolean VertexBuffersSupported(void);
+
+// Buffer objects can also be used as the source of texture uploads (GL 2.1 or ARB_pixel_buffer_object)
+extern GLboolean PixelBuffersSupported(void);
+
+/*
+ * These pointers are only valid after calling VertexBuffersSupported.
+ */
+#define BUFFER_FUNCTION_LIST(proc, name) extern proc name;
+#include "bufferutil.inc"
+#undef BUFFER_FUNCTION_LIST
+
 PLUGIN_END_NAMESPACE
 
 #endif /* SHADER_UTIL_H */